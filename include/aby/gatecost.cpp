@@ -0,0 +1,119 @@
+/**
+ \file    gatecost.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Attribution of ABY gate counts to circuit builder stages
+*/
+
+#include <algorithm>
+#include <stdexcept>
+#include "abycore/circuit/arithmeticcircuits.h"
+#include "abycore/circuit/booleancircuits.h"
+#include "abycore/sharing/sharing.h"
+#include "gatecost.h"
+
+using namespace std;
+
+namespace sel::aby {
+
+GateCounts& GateCounts::operator+=(const GateCounts& rhs) {
+  and_gates += rhs.and_gates;
+  xor_vals += rhs.xor_vals;
+  mul_gates += rhs.mul_gates;
+  b2a_gates += rhs.b2a_gates;
+  a2y_gates += rhs.a2y_gates;
+  b2y_gates += rhs.b2y_gates;
+  gates += rhs.gates;
+  depth += rhs.depth;
+  return *this;
+}
+
+GateCounts GateCounts::operator-(const GateCounts& rhs) const {
+  return {
+    and_gates - rhs.and_gates,
+    xor_vals - rhs.xor_vals,
+    mul_gates - rhs.mul_gates,
+    b2a_gates - rhs.b2a_gates,
+    a2y_gates - rhs.a2y_gates,
+    b2y_gates - rhs.b2y_gates,
+    gates - rhs.gates,
+    depth - rhs.depth
+  };
+}
+
+GateCostAttribution::GateCostAttribution(BooleanCircuit* bcirc,
+    BooleanCircuit* ccirc, ArithmeticCircuit* acirc) :
+  bcirc{bcirc}, ccirc{ccirc}, acirc{acirc}
+{}
+
+GateCounts GateCostAttribution::snapshot() const {
+  // Only the Yao circuit has A2Y and B2Y gates
+  BooleanCircuit* ycirc = (bcirc->GetContext() == S_YAO) ? bcirc : ccirc;
+  return {
+    static_cast<uint64_t>(bcirc->GetNumANDGates()) + ccirc->GetNumANDGates(),
+    static_cast<uint64_t>(bcirc->GetNumXORVals()) + ccirc->GetNumXORVals(),
+    acirc->GetNumMULGates(),
+    acirc->GetNumCONVGates(),
+    ycirc->GetNumA2YGates(),
+    ycirc->GetNumB2YGates(),
+    static_cast<uint64_t>(bcirc->GetNumGates()) + ccirc->GetNumGates()
+      + acirc->GetNumGates(),
+    max({bcirc->GetMaxDepth(), ccirc->GetMaxDepth(), acirc->GetMaxDepth()})
+  };
+}
+
+void GateCostAttribution::attribute() {
+  const auto now = snapshot();
+  costs[stages.empty() ? Key{"unattributed", ""} : stages.back()] += now - last;
+  last = now;
+}
+
+void GateCostAttribution::enter(const string& stage, const string& field) {
+  attribute();
+  stages.emplace_back(stage, field);
+}
+
+void GateCostAttribution::leave() {
+  if (stages.empty()) {
+    throw logic_error("GateCostAttribution: leaving stage without entering one");
+  }
+  attribute();
+  stages.pop_back();
+}
+
+void GateCostAttribution::reset() {
+  costs.clear();
+  stages.clear();
+  last = {};
+}
+
+map<string, GateCounts> GateCostAttribution::get_stage_costs() const {
+  map<string, GateCounts> stage_costs;
+  for (const auto& [key, cost] : costs) {
+    stage_costs[key.first] += cost;
+  }
+  return stage_costs;
+}
+
+GateCostScope::GateCostScope(GateCostAttribution* attribution,
+    const string& stage, const string& field) :
+  attribution{attribution}
+{
+  if (attribution) attribution->enter(stage, field);
+}
+
+GateCostScope::~GateCostScope() {
+  if (attribution) attribution->leave();
+}
+
+} // namespace sel::aby
@@ -0,0 +1,110 @@
+/**
+ \file    gatecost.h
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Attribution of ABY gate counts to circuit builder stages
+*/
+
+#ifndef SEL_ABY_GATECOST_H_
+#define SEL_ABY_GATECOST_H_
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// forward declarations
+class BooleanCircuit;
+class ArithmeticCircuit;
+
+namespace sel::aby {
+
+/**
+ * Counters of the boolean, conversion and arithmetic circuits
+ *
+ * Same caveats as in StatsPrinter: AND, XOR, MUL and conversion gates are
+ * counted per bit or value, gates per abstract gate. depth is the largest
+ * depth of the three circuits.
+ */
+struct GateCounts {
+  uint64_t and_gates{0}; // both boolean circuits
+  uint64_t xor_vals{0}; // both boolean circuits
+  uint64_t mul_gates{0};
+  uint64_t b2a_gates{0}; // arithmetic conversion gates, i.e., B2A and Y2A
+  uint64_t a2y_gates{0};
+  uint64_t b2y_gates{0};
+  uint64_t gates{0};
+  uint64_t depth{0};
+
+  GateCounts& operator+=(const GateCounts& rhs);
+  GateCounts operator-(const GateCounts& rhs) const;
+};
+
+/**
+ * Attributes the gates added to the circuits to the current builder stage
+ *
+ * Stages nest, gates are attributed exclusively to the innermost stage, so
+ * the costs of all stages sum up to the circuit totals. Gates added outside
+ * of any stage are attributed to stage "unattributed". Depth is the growth of
+ * the circuit depth while a stage was innermost, hence not additive.
+ */
+class GateCostAttribution {
+public:
+  // (stage, field), field is empty for stages not specific to a field
+  using Key = std::pair<std::string, std::string>;
+
+  GateCostAttribution(BooleanCircuit* bcirc, BooleanCircuit* ccirc,
+      ArithmeticCircuit* acirc);
+
+  void enter(const std::string& stage, const std::string& field = "");
+  void leave();
+  // Call after the circuits were reset
+  void reset();
+
+  const std::map<Key, GateCounts>& get_costs() const { return costs; }
+  // Costs summed over all fields of each stage
+  std::map<std::string, GateCounts> get_stage_costs() const;
+
+private:
+  BooleanCircuit* bcirc;
+  BooleanCircuit* ccirc;
+  ArithmeticCircuit* acirc;
+  std::map<Key, GateCounts> costs;
+  std::vector<Key> stages;
+  GateCounts last;
+
+  GateCounts snapshot() const;
+  // Attributes the gates since the last snapshot to the innermost stage
+  void attribute();
+};
+
+/**
+ * Enters a stage for its lifetime, does nothing without an attribution
+ */
+class GateCostScope {
+public:
+  GateCostScope(GateCostAttribution* attribution, const std::string& stage,
+      const std::string& field = "");
+  ~GateCostScope();
+  GateCostScope(const GateCostScope&) = delete;
+  GateCostScope& operator=(const GateCostScope&) = delete;
+
+private:
+  GateCostAttribution* attribution;
+};
+
+} // namespace sel::aby
+
+#endif /* end of include guard: SEL_ABY_GATECOST_H_ */
@@ -24,6 +24,7 @@
 #include "abycore/circuit/booleancircuits.h"
 #include "abycore/sharing/sharing.h"
 #include "statsprinter.h"
+#include "gatecost.h"
 
 auto constexpr SEP = " = ";
 
@@ -128,6 +129,34 @@ void StatsPrinter::print_timings() {
     << endl;
 }
 
+void print_gate_counts(ostream& out, const GateCounts& c) {
+  out << "\nAND" << SEP << c.and_gates
+    << "\nXOR" << SEP << c.xor_vals
+    << "\nMUL" << SEP << c.mul_gates
+    << "\nB2A" << SEP << c.b2a_gates
+    << "\nA2Y" << SEP << c.a2y_gates
+    << "\nB2Y" << SEP << c.b2y_gates
+    << "\ntotal" << SEP << c.gates
+    << "\ndepth" << SEP << c.depth;
+}
+
+void StatsPrinter::print_gate_costs(const GateCostAttribution& costs) {
+  for (const auto& [key, cost] : costs.get_costs()) {
+    *out << "[[gateCosts]]"
+      << "\nstage" << SEP << '"' << key.first << '"'
+      << "\nfield" << SEP << '"' << key.second << '"';
+    print_gate_counts(*out, cost);
+    *out << '\n';
+  }
+  for (const auto& [stage, cost] : costs.get_stage_costs()) {
+    *out << "[[stageCosts]]"
+      << "\nstage" << SEP << '"' << stage << '"';
+    print_gate_counts(*out, cost);
+    *out << '\n';
+  }
+  *out << flush;
+}
+
 void StatsPrinter::print_all() {
   print_baseOTs();
   print_circuit();
@@ -26,6 +26,9 @@
 
 // forward declarations
 class ABYParty;
+namespace sel::aby {
+class GateCostAttribution;
+}
 //namespace std::filesystem {
 //class path;
 //}
@@ -60,6 +63,11 @@ public:
   void print_circuit();
   void print_communication();
   void print_timings();
+  /**
+   * Prints the gate counts attributed to each builder stage and field,
+   * followed by the sums per stage.
+   */
+  void print_gate_costs(const GateCostAttribution& costs);
   void print_all();
   /**
    * Prints BaseOTs, circuit and communication stats only on first call,
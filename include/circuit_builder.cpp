@@ -23,7 +23,9 @@ using fmt::format;
 #include "math.h"
 #include "seltypes.h"
 #include "logger.h"
+#include "tracer.h"
 #include "aby/Share.h"
+#include "aby/gatecost.h"
 #include "aby/quotient_folder.hpp"
 
 using namespace std;
@@ -93,10 +95,12 @@ public:
   }
 
   void set_input(const EpilinkClientInput& input) override {
+    const aby::GateCostScope scope{costs, "input"};
     ins.set(input);
   }
 
   void set_input(const EpilinkServerInput& input) override {
+    const aby::GateCostScope scope{costs, "input"};
     ins.set(input);
   }
 
@@ -111,6 +115,7 @@ public:
     if (!ins.is_input_set()) {
       throw new runtime_error("Set the input first before building the ciruit!");
     }
+    const TraceSpan span{"build linkage circuit", "circuit"};
 
     vector<LinkageOutputShares> output_shares;
     output_shares.reserve(ins.nrecords());
@@ -127,6 +132,7 @@ public:
     if (!ins.is_input_set()) {
       throw new runtime_error("Set the input first before building the ciruit!");
     }
+    const TraceSpan span{"build count circuit", "circuit"};
 
     vector<LinkageShares<MultShare>> linkage_shares;
     linkage_shares.reserve(ins.nrecords());
@@ -144,6 +150,10 @@ public:
     built = false;
   }
 
+  void set_gate_costs(aby::GateCostAttribution* costs_) override {
+    costs = costs_;
+  }
+
 private:
   inline static constexpr bool do_arith_mult = std::is_same_v<MultShare, ArithShare>;
   using QuotientShare = Quotient<MultShare>;
@@ -158,6 +168,7 @@ private:
   CircuitInput<MultShare> ins;
   // State
   bool built{false};
+  aby::GateCostAttribution* costs{nullptr};
 
   // Dynamic converters, dependent on main bool sharing
   BoolShare to_bool(const ArithShare& s) {
@@ -190,11 +201,25 @@ private:
   const A2BConverter to_bool_closure;
   const B2AConverter to_arith_closure;
 
+  // Runs f with all its gates attributed to stage, if attribution is enabled
+  template <class F>
+  auto attributed(const string& stage, const string& field, F&& f) {
+    const aby::GateCostScope scope{costs, stage, field};
+    return f();
+  }
+
+  // Only assembled if attribution is enabled
+  string field_key(const ComparisonIndex& i) const {
+    if (!costs) return {};
+    return (i.left == i.right) ? i.left : i.left + '|' + i.right;
+  }
+
   /*
   * Builds the record linkage component of the circuit
   */
   LinkageShares<MultShare> build_single_linkage_circuit(size_t index) {
     get_logger()->trace("Building linkage circuit component {}...", index);
+    const TraceSpan span{"record component", "circuit"};
 
     // Where we store all group and individual comparison weights
     vector<FieldWeight<MultShare>> field_weights;
@@ -218,22 +243,28 @@ private:
     }
 
     // 2. Sum up all field weights.
-    QuotientShare sum_field_weights = sum(field_weights);
+    QuotientShare sum_field_weights = attributed("sum", "",
+        [&field_weights]{ return sum(field_weights); });
 #ifdef DEBUG_SEL_CIRCUIT
     print_share(sum_field_weights, format("[{}] sum_field_weights", index));
 #endif
 
     // 3. Determine index of max score of all nvals calculations
-    const auto max_fw_and_index = max_index(move(sum_field_weights));
+    const auto max_fw_and_index = attributed("argmax fold", "",
+        [&]{ return max_index(move(sum_field_weights)); });
     const auto max_field_weight = max_fw_and_index.get_selector();
     const auto max_idx = max_fw_and_index.get_targets();
 
     // 4. Set two comparison bits, whether field-weight-sum > (tentative) threshold * weight-sum
-    BoolShare threshold_weight = to_logic_space(ins.const_threshold() * max_field_weight.den);
-    BoolShare tthreshold_weight = to_logic_space(ins.const_tthreshold() * max_field_weight.den);
-    BoolShare b_sum_field_weight = to_logic_space(max_field_weight.num);
-    BoolShare match = threshold_weight < b_sum_field_weight;
-    BoolShare tmatch = tthreshold_weight < b_sum_field_weight;
+    BoolShare threshold_weight, tthreshold_weight, match, tmatch;
+    {
+      const aby::GateCostScope scope{costs, "threshold"};
+      threshold_weight = to_logic_space(ins.const_threshold() * max_field_weight.den);
+      tthreshold_weight = to_logic_space(ins.const_tthreshold() * max_field_weight.den);
+      BoolShare b_sum_field_weight = to_logic_space(max_field_weight.num);
+      match = threshold_weight < b_sum_field_weight;
+      tmatch = tthreshold_weight < b_sum_field_weight;
+    }
 #ifdef DEBUG_SEL_CIRCUIT
     print_share(max_field_weight, format("[{}] best score", index));
     print_share(max_idx[0], format("[{}] index of best score", index));
@@ -254,6 +285,8 @@ private:
   }
 
   LinkageOutputShares to_linkage_output(const LinkageShares<MultShare>& s) {
+    const TraceSpan span{"output conversion", "circuit"};
+    const aby::GateCostScope scope{costs, "output"};
     // Output shares should be XOR, not Yao shares
     auto index = to_gmw(s.index);
     auto match = to_gmw(s.match);
@@ -270,6 +303,7 @@ private:
   }
 
   CountOutputShares sum_linkage_shares(std::vector<LinkageShares<MultShare>> ls) {
+    const aby::GateCostScope scope{costs, "count sum"};
     vector<BoolShare> matches, tmatches;
     const auto n = ls.size();
     matches.reserve(n);
@@ -316,6 +350,8 @@ private:
 
   FieldWeight<MultShare> best_group_weight(size_t index, const IndexSet& group_set) {
     vector<FieldName> group{begin(group_set), end(group_set)};
+    // Gates not attributed to the comparisons are the permutation sums and max
+    const aby::GateCostScope scope{costs, "group max", costs ? format("{}", group) : ""};
     // copy group to store permutations
     vector<FieldName> groupPerm = group;
     size_t size = group.size();
@@ -374,10 +410,12 @@ private:
       return cache_hit->second;
     }
 
-    const auto delta_weight = weight(i);
+    const auto delta_weight = attributed("delta/weight", field_key(i),
+        [this, &i]{ return weight(i); });
     const auto comp = compare(i);
 
-    MultShare field_weight = delta_weight * comp;
+    MultShare field_weight = attributed("field weight", field_key(i),
+        [&delta_weight, &comp]{ return delta_weight * comp; });
 
 #ifdef DEBUG_SEL_CIRCUIT
     //FIXME(SS): Compilation error, if -DDEBUG_SEL_CIRCUIT
@@ -420,6 +458,7 @@ private:
   * Output is a fixed-point number with precision cfg.dice_prec
   */
   MultShare dice_coefficient(const ComparisonIndex& i) {
+    const aby::GateCostScope scope{costs, "dice", field_key(i)};
     const auto [client_entry, server_entry] = ins.get(i);
 
     const BoolShare hw_plus = client_entry.hw + server_entry.hw; // denominator
@@ -446,6 +485,7 @@ private:
   * Binary-compares two shares
   */
   MultShare equality(const ComparisonIndex& i) {
+    const aby::GateCostScope scope{costs, "equality", field_key(i)};
     const auto [client_entry, server_entry] = ins.get(i);
     const BoolShare cmp = (client_entry.val == server_entry.val);
 #ifdef DEBUG_SEL_CIRCUIT
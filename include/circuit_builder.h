@@ -26,6 +26,9 @@ class BooleanCircuit;
 class ArithmeticCircuit;
 
 namespace sel {
+namespace aby {
+class GateCostAttribution;
+}
 
 struct LinkageOutputShares {
   OutShare index, match, tmatch;
@@ -53,6 +56,12 @@ public:
   virtual CountOutputShares build_count_circuit() = 0;
 
   virtual void reset() = 0;
+
+  /**
+   * Attributes the gates of all subsequently built circuits to the builder
+   * stages, nullptr disables the attribution.
+   */
+  virtual void set_gate_costs(aby::GateCostAttribution* costs) = 0;
 };
 
 std::unique_ptr<CircuitBuilderBase> make_unique_circuit_builder(const CircuitConfig& cfg,
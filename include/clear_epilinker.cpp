@@ -336,6 +336,10 @@ template Result<uint16_t> calc<uint16_t>(const Input& input, const CircuitConfig
 template Result<uint32_t> calc<uint32_t>(const Input& input, const CircuitConfig& cfg);
 template Result<uint64_t> calc<uint64_t>(const Input& input, const CircuitConfig& cfg);
 
+// dice template instantiations
+template CircUnit dice<CircUnit>(const Bitmask& left, const Bitmask& right, size_t prec);
+template double dice<double>(const Bitmask& left, const Bitmask& right, size_t prec);
+
 Result<CircUnit> calc_integer(const Input& input, const CircuitConfig& cfg) {
   return calc<CircUnit>(input, cfg);
 }
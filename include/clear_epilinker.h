@@ -60,6 +60,11 @@ template<typename T> std::vector<Result<T>> calc(const Records& records,
 template<typename T> CountResult<size_t> calc_count(const Records& records,
     const VRecord& database, const CircuitConfig& cfg);
 
+/**
+ * Dice coefficient of two bitmasks, left-shifted by prec for integral T
+ */
+template<typename T> T dice(const Bitmask& left, const Bitmask& right, size_t prec);
+
 } /* end of namespace sel::clear_epilink */
 
 #endif /* end of include guard: SEL_CLEAR_EPILINKER_H */
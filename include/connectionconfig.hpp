@@ -24,11 +24,14 @@
 #include <memory>
 #include <string>
 #include "authenticator.h"
+#include "resttypes.h"
 
 namespace sel {
 struct ConnectionConfig {
   std::string url;
   sel::Authenticator authenticator;
+  // Body format the service accepts, JSON unless configured otherwise
+  WireFormat wire_format{WireFormat::JSON};
   bool empty() const {return url.empty();}
 };
 } // namespace sel
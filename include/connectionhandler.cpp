@@ -64,7 +64,7 @@ set<Port> ConnectionHandler::get_free_ports() const {
   return m_aby_available_ports;
 }
 
-Port ConnectionHandler::initialize_aby_server(
+vector<Port> ConnectionHandler::initialize_aby_server(
     shared_ptr<RemoteConfiguration> remote_config) {
   string data{"{}"};
   list<string> headers{
@@ -72,23 +72,30 @@ Port ConnectionHandler::initialize_aby_server(
     "Content-Type: application/json",
     };
   string url{assemble_remote_url(remote_config)+"/testConfig/"+ConfigurationHandler::cget().get_local_config()->get_local_id()};
-  auto response{perform_post_request(url, data, headers, true)};
+  auto response{perform_post_request(url, data, headers)};
   // FIXME(TK): Auth from response
-  auto resp_port(get_headers(response.body, "SEL-Port"));
+  auto resp_port(get_headers(response, "SEL-Port"));
   if(resp_port.empty()){
     throw runtime_error("No aby port for smpc communication in server response");
   }
-  Port sel_port = stoul(resp_port.front());
-  return sel_port;
+  return parse_port_list(resp_port.front());
 }
 
 Port ConnectionHandler::choose_aby_port() {
+  return choose_aby_ports(1).front();
+}
+
+vector<Port> ConnectionHandler::choose_aby_ports(size_t num_ports) {
   lock_guard<mutex> lock(m_port_mutex);
-  if (!m_aby_available_ports.empty()) {
-    return move(m_aby_available_ports.extract(m_aby_available_ports.begin()).value());
-  } else {
-    throw runtime_error("No available port for smpc communication");
+  if (m_aby_available_ports.size() < num_ports) {
+    throw runtime_error("Not enough available ports for smpc communication");
+  }
+  vector<Port> ports;
+  ports.reserve(num_ports);
+  for (size_t i = 0; i != num_ports; ++i) {
+    ports.emplace_back(m_aby_available_ports.extract(m_aby_available_ports.begin()).value());
   }
+  return ports;
 }
 
 void ConnectionHandler::mark_port_used(Port port) {
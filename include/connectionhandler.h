@@ -26,6 +26,7 @@ computations
 #include <memory>
 #include <unordered_map>
 #include <mutex>
+#include <vector>
 #include "util.h"
 #include "resttypes.h"
 
@@ -72,9 +73,10 @@ class ConnectionHandler {
   Port use_free_port();
   std::set<Port> get_free_ports() const;
   Port choose_aby_port();
+  std::vector<Port> choose_aby_ports(size_t);
   void mark_port_used(Port);
 
-  Port initialize_aby_server(std::shared_ptr<RemoteConfiguration>);
+  std::vector<Port> initialize_aby_server(std::shared_ptr<RemoteConfiguration>);
 
  private:
   std::shared_ptr<restbed::Service> m_service;
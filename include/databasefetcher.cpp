@@ -18,10 +18,6 @@
 
 #include "databasefetcher.h"
 #include <spdlog/spdlog.h>
-#include <curlpp/Easy.hpp>
-#include <curlpp/Infos.hpp>
-#include <curlpp/Options.hpp>
-#include <curlpp/cURLpp.hpp>
 #include <map>
 #include <memory>
 #include <optional>
@@ -41,6 +37,8 @@
 #include "resttypes.h"
 #include "restutils.h"
 #include "jsonutils.h"
+#include "configurationhandler.h"
+#include "tracer.h"
 #include "util.h"
 
 using namespace std;
@@ -66,6 +64,7 @@ DatabaseFetcher::DatabaseFetcher(
       m_logger{get_logger()} {}
 
 ServerData DatabaseFetcher::fetch_data(bool matching_mode) {
+  const TraceSpan span{"fetch database", "rest"};
   m_logger->debug("Requesting Database from {}?pageSize={}\n", m_url,
                   m_page_size);
   m_logger->info("Requesting Database");
@@ -158,17 +157,28 @@ nlohmann::json DatabaseFetcher::request_page(const string& url) const {
   m_logger->debug("DB request address: {}", url);
   m_logger->debug("Auth Header for DB: {}", m_local_authenticator.sign_transaction(""));
   headers.emplace_back("Authorization: "s + m_local_authenticator.sign_transaction(""));
-  auto response{perform_get_request(url,headers, false)};
+  // Binary pages carry bloom filters as raw bytes instead of base64
+  headers.emplace_back("Accept: "s + accepted_formats(
+        ConfigurationHandler::cget().get_server_config().wire_format));
+  auto response{perform_get_request(url,headers)};
   if (response.return_code == 200) {
-    if (!(response.body.empty())) {
-      m_logger->trace("Response Data:\n{} - {}\n",response.return_code, response.body);
-    } else {
+    if (response.body.empty()) {
       throw runtime_error("No valid data returned from Database");
     }
     try {
-      return nlohmann::json::parse(response.body);
+      const auto content_types{get_headers(response, "Content-Type")};
+      auto format{WireFormat::JSON};
+      try {
+        format = wire_format_of(content_types.empty() ? "" : content_types.front());
+      } catch (const runtime_error& e) {
+        m_logger->warn("{}, parsing page as JSON", e.what());
+      }
+      if (format == WireFormat::JSON) {
+        m_logger->trace("Response Data:\n{} - {}\n",response.return_code, response.body);
+      }
+      return decode_body(response.body, format);
     } catch (const exception& e) {
-      m_logger->error("Error parsing JSON from database: {}", e.what());
+      m_logger->error("Error parsing page from database: {}", e.what());
       return nlohmann::json();
     }
   } else {
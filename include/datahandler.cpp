@@ -4,6 +4,7 @@
 #include "localconfiguration.h"
 #include "remoteconfiguration.h"
 #include "clear_epilinker.h"
+#include "metrics.h"
 #include <memory>
 #include <mutex>
 #include <nlohmann/json.hpp>
@@ -40,7 +41,11 @@ void Debugger::reset() {
     return cref(get());
   }
 
-size_t DataHandler::poll_database(const RemoteId& remote_id, bool counting_mode) {
+/**
+ * Fetches the database and returns it. Concurrent runs each get their own
+ * snapshot, get_database() only returns the latest one.
+ */
+shared_ptr<const ServerData> DataHandler::poll_database(const RemoteId& remote_id, bool counting_mode) {
   const auto& config_handler{ConfigurationHandler::cget()};
   const auto local_configuration{config_handler.get_local_config()};
   DatabaseFetcher database_fetcher{
@@ -48,10 +53,14 @@ size_t DataHandler::poll_database(const RemoteId& remote_id, bool counting_mode)
       local_configuration->get_data_service()+"/"+remote_id,
       local_configuration->get_local_authenticator(),
       config_handler.get_server_config().default_page_size};
-  auto data{database_fetcher.fetch_data(counting_mode)};
+  shared_ptr<const ServerData> data;
+  {
+    ScopedTimer timer{"sel_database_fetch_seconds", {{"remote", remote_id}}};
+    data = make_shared<const ServerData>(database_fetcher.fetch_data(counting_mode));
+  }
   lock_guard<mutex> lock(m_db_mutex);
-  m_database = make_shared<const ServerData>(move(data));
-  return (m_database->data->begin()->second.size());
+  m_database = data;
+  return data;
 }
 
 size_t DataHandler:: poll_database_diff() {
@@ -0,0 +1,416 @@
+/**
+\file    deliveryqueue.cpp
+\copyright SEL - Secure EpiLinker
+    Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published
+    by the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+\brief Outbound queue for results and callbacks with retries
+*/
+
+#include "deliveryqueue.h"
+#include "base64.h"
+#include "configurationhandler.h"
+#include "httpclient.h"
+#include "metrics.h"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+namespace sel {
+
+namespace {
+// CBOR and MessagePack bodies are binary, the journal is JSON text
+string journal_body(const string& body) {
+  return base64_encode(reinterpret_cast<const uint8_t*>(body.data()), body.size());
+}
+
+string body_from_journal(const string& encoded) {
+  const auto length{min(encoded.find('='), encoded.size())};
+  const auto bytes{base64_decode(encoded, length * 3 / 4 * 8)};
+  return {bytes.begin(), bytes.end()};
+}
+} // namespace
+
+void to_json(nlohmann::json& j, const Delivery& delivery) {
+  j = nlohmann::json{{"url", delivery.url},
+                     {"body", journal_body(delivery.body)},
+                     {"headers", delivery.headers},
+                     {"forwardUrl", delivery.forward_url},
+                     {"forwardHeaders", delivery.forward_headers},
+                     {"description", delivery.description}};
+}
+
+void from_json(const nlohmann::json& j, Delivery& delivery) {
+  delivery.url = j.at("url").get<string>();
+  delivery.body = body_from_journal(j.at("body").get<string>());
+  delivery.headers = j.at("headers").get<list<string>>();
+  delivery.forward_url = j.at("forwardUrl").get<string>();
+  delivery.forward_headers = j.at("forwardHeaders").get<list<string>>();
+  delivery.description = j.at("description").get<string>();
+}
+
+namespace {
+string added_record(uint64_t id, const Delivery& delivery, size_t attempts) {
+  return nlohmann::json{{"id", id}, {"delivery", delivery}, {"attempts", attempts}}.dump();
+}
+
+string attempts_record(uint64_t id, size_t attempts) {
+  return nlohmann::json{{"id", id}, {"attempts", attempts}}.dump();
+}
+
+string removed_record(uint64_t id) {
+  return nlohmann::json{{"id", id}}.dump();
+}
+
+[[noreturn]] void throw_errno(const string& what) {
+  throw system_error(errno, generic_category(), what);
+}
+
+void write_records(int fd, const vector<string>& records) {
+  string data;
+  for (const auto& record : records) {
+    data += record;
+    data += '\n';
+  }
+  for (size_t written = 0; written != data.size();) {
+    const auto result{::write(fd, data.data() + written, data.size() - written)};
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      throw_errno("Can not write pending deliveries");
+    }
+    written += result;
+  }
+}
+
+// Makes a rename durable
+void sync_directory(const filesystem::path& file) {
+  const auto directory{file.has_parent_path() ? file.parent_path() : filesystem::path{"."}};
+  const int fd{::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+  if (fd < 0) {
+    throw_errno("Can not open " + directory.string());
+  }
+  const auto result{::fsync(fd)};
+  ::close(fd);
+  if (result) {
+    throw_errno("Can not sync " + directory.string());
+  }
+}
+} // namespace
+
+DeliveryQueue& DeliveryQueue::get() {
+  static DeliveryQueue singleton;
+  return singleton;
+}
+
+DeliveryQueue::DeliveryQueue()
+  : DeliveryQueue{ConfigurationHandler::cget().get_server_config().delivery_queue_file,
+                  ConfigurationHandler::cget().get_server_config().delivery_max_attempts,
+                  ConfigurationHandler::cget().get_server_config().delivery_backoff,
+                  ConfigurationHandler::cget().get_server_config().delivery_max_pending} {
+  Metrics::get().add_collector([this](Metrics& metrics){
+      metrics.set("sel_pending_deliveries", {}, size()); });
+}
+
+DeliveryQueue::DeliveryQueue(filesystem::path file, size_t max_attempts,
+    chrono::milliseconds backoff, size_t max_pending)
+  : m_file{move(file)}, m_max_attempts{max_attempts}, m_backoff{backoff},
+    m_max_pending{max_pending} {
+  // Must outlive the queue
+  HttpClient::get();
+  load();
+  m_dispatcher = thread(&DeliveryQueue::dispatch_loop, this);
+}
+
+// The dispatcher waits for the deliveries in flight and writes the journal
+// before it returns
+DeliveryQueue::~DeliveryQueue() {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_wake.notify_all();
+  m_dispatcher.join();
+  if (m_journal_fd >= 0) {
+    ::close(m_journal_fd);
+  }
+}
+
+bool DeliveryQueue::push(Delivery delivery) {
+  bool queued;
+  {
+    lock_guard<mutex> lock(m_mutex);
+    queued = push_locked(delivery);
+  }
+  if (!queued) {
+    if (delivery.on_finished) {
+      delivery.on_finished(false);
+    }
+    return false;
+  }
+  m_wake.notify_all();
+  return true;
+}
+
+size_t DeliveryQueue::size() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_pending.size() + m_incoming.size();
+}
+
+bool DeliveryQueue::push_locked(Delivery& delivery) {
+  const auto pending{m_pending.size() + m_incoming.size()};
+  if (m_max_pending && pending >= m_max_pending) {
+    m_logger->error("Rejecting delivery of {} to {}, {} deliveries are pending",
+        delivery.description, delivery.url, pending);
+    return false;
+  }
+  m_logger->debug("Queueing delivery of {} to {}", delivery.description, delivery.url);
+  m_incoming.emplace_back(m_next_id++, Entry{move(delivery), 0, Clock::now(), false});
+  return true;
+}
+
+void DeliveryQueue::dispatch_loop() {
+  unique_lock<mutex> lock(m_mutex);
+  while (!m_stopping || m_in_flight) {
+    flush(lock);
+    const auto now{Clock::now()};
+    auto next_wake{Clock::time_point::max()};
+    vector<pair<uint64_t, Delivery>> sends;
+    for (auto& [id, entry] : m_pending) {
+      if (entry.in_flight || m_stopping) continue;
+      if (entry.next_attempt > now) {
+        next_wake = min(next_wake, entry.next_attempt);
+      } else if (m_in_flight < max_in_flight) {
+        entry.in_flight = true;
+        ++m_in_flight;
+        sends.emplace_back(id, entry.delivery);
+      }
+    }
+    lock.unlock();
+    for (auto& [id, delivery] : sends) {
+      auto url{delivery.url};
+      auto body{delivery.body};
+      auto headers{delivery.headers};
+      HttpClient::get().async_request(HttpMethod::POST, move(url), move(body), move(headers),
+          [this, id = id, delivery = move(delivery), start = Clock::now()]
+          (SessionResponse response, exception_ptr error){
+            finish(id, delivery, start, response, error);
+          });
+    }
+    lock.lock();
+    // Changes while unlocked were announced before the wait started
+    if (!m_journal.empty() || !m_incoming.empty() || (m_stopping && !m_in_flight)) continue;
+    if (next_wake == Clock::time_point::max()) {
+      m_wake.wait(lock);
+    } else {
+      m_wake.wait_until(lock, next_wake);
+    }
+  }
+  flush(lock);
+}
+
+// Called on the HttpClient's event loop thread
+void DeliveryQueue::finish(uint64_t id, const Delivery& delivery, Clock::time_point start,
+    const SessionResponse& response, exception_ptr error_ptr) {
+  string error;
+  if (error_ptr) {
+    try {
+      rethrow_exception(error_ptr);
+    } catch (const exception& e) {
+      error = e.what();
+    }
+  } else {
+    m_logger->trace("Reply to delivery of {}: {} - {}", delivery.description,
+        response.return_code, response.body);
+  }
+  const bool success{error.empty() && response.return_code / 100 == 2};
+  const bool retry{!error.empty() || response.return_code == 429
+                   || response.return_code / 100 == 5};
+  Metrics::get().observe("sel_delivery_seconds",
+      {{"outcome", success ? "delivered" : retry ? "retry" : "rejected"}},
+      chrono::duration<double>(Clock::now() - start).count());
+
+  unique_lock<mutex> lock(m_mutex);
+  --m_in_flight;
+  auto& entry{m_pending.at(id)};
+  ++entry.attempts;
+  bool finished{true};
+  bool forward_rejected{false};
+  if (success) {
+    m_logger->debug("Delivered {} to {}", delivery.description, delivery.url);
+    if (!delivery.forward_url.empty()) {
+      Delivery forward{delivery.forward_url, response.body, delivery.forward_headers,
+                       "", {}, "reply to " + delivery.description,
+                       delivery.on_forward_finished, nullptr};
+      forward_rejected = !push_locked(forward);
+    }
+    m_pending.erase(id);
+  } else if (!retry || entry.attempts >= m_max_attempts) {
+    m_logger->error("Giving up delivery of {} to {} after {} attempts: {}",
+        delivery.description, delivery.url, entry.attempts,
+        error.empty() ? to_string(response.return_code) + " - " + response.body : error);
+    m_pending.erase(id);
+  } else {
+    const auto backoff{min<chrono::milliseconds>(
+        m_backoff * (1ull << min<size_t>(entry.attempts - 1, 20)), max_backoff)};
+    m_logger->warn("Delivery of {} to {} failed ({}), retrying in {}ms",
+        delivery.description, delivery.url,
+        error.empty() ? to_string(response.return_code) : error, backoff.count());
+    entry.next_attempt = Clock::now() + backoff;
+    entry.in_flight = false;
+    finished = false;
+  }
+  m_journal.emplace_back(finished ? removed_record(id) : attempts_record(id, entry.attempts));
+  m_wake.notify_all();
+  // The queue may be gone once unlocked
+  lock.unlock();
+  if (finished && delivery.on_finished) {
+    delivery.on_finished(success);
+  }
+  if (forward_rejected && delivery.on_forward_finished) {
+    delivery.on_forward_finished(false);
+  }
+}
+
+// Appends the journaled changes, or rewrites the journal from the pending
+// deliveries once it is mostly obsolete records. Pushed deliveries are sent
+// once journaled, or right away if the journal can not be written.
+void DeliveryQueue::flush(unique_lock<mutex>& lock) {
+  if (m_incoming.empty() && m_journal.empty()) return;
+  auto incoming{move(m_incoming)};
+  m_incoming.clear();
+  if (m_file.empty()) {
+    m_journal.clear();
+  } else {
+    try {
+      vector<string> records;
+      const bool rewrite{m_journal_fd < 0
+        || m_journal_records + m_journal.size() + incoming.size()
+           > max(2 * (m_pending.size() + incoming.size()), min_rewrite_records)};
+      if (rewrite) {
+        m_journal.clear();
+        records.reserve(m_pending.size() + incoming.size());
+        for (const auto& [id, entry] : m_pending) {
+          records.emplace_back(added_record(id, entry.delivery, entry.attempts));
+        }
+      } else {
+        records.swap(m_journal);
+      }
+      for (const auto& [id, entry] : incoming) {
+        records.emplace_back(added_record(id, entry.delivery, entry.attempts));
+      }
+      lock.unlock();
+      if (rewrite) {
+        rewrite_journal(records);
+      } else {
+        append_journal(records);
+      }
+    } catch (const exception& e) {
+      m_logger->error("Can not persist pending deliveries to {}: {}", m_file.string(), e.what());
+      // Rewritten from scratch next time
+      if (m_journal_fd >= 0) {
+        ::close(m_journal_fd);
+        m_journal_fd = -1;
+      }
+    }
+    if (!lock.owns_lock()) {
+      lock.lock();
+    }
+  }
+  for (auto& [id, entry] : incoming) {
+    m_pending.emplace(id, move(entry));
+  }
+}
+
+void DeliveryQueue::append_journal(const vector<string>& records) {
+  write_records(m_journal_fd, records);
+  if (::fdatasync(m_journal_fd)) {
+    throw_errno("Can not sync " + m_file.string());
+  }
+  m_journal_records += records.size();
+}
+
+// Written to a temporary file first, so a crash never leaves a truncated
+// journal behind
+void DeliveryQueue::rewrite_journal(const vector<string>& records) {
+  auto temporary{m_file};
+  temporary += ".tmp";
+  // May contain authorization headers
+  const int fd{::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)};
+  if (fd < 0) {
+    throw_errno("Can not open " + temporary.string());
+  }
+  try {
+    write_records(fd, records);
+    if (::fsync(fd)) {
+      throw_errno("Can not sync " + temporary.string());
+    }
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+  filesystem::rename(temporary, m_file);
+  sync_directory(m_file);
+  if (m_journal_fd >= 0) {
+    ::close(m_journal_fd);
+  }
+  m_journal_fd = ::open(m_file.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+  if (m_journal_fd < 0) {
+    throw_errno("Can not open " + m_file.string());
+  }
+  m_journal_records = records.size();
+}
+
+// A record cut off by a crash can only be the last one and is skipped
+void DeliveryQueue::load() {
+  if (m_file.empty() || !filesystem::exists(m_file)) return;
+  map<uint64_t, pair<Delivery, size_t>> pending;
+  try {
+    ifstream in(m_file);
+    string line;
+    while (getline(in, line)) {
+      if (line.empty()) continue;
+      nlohmann::json record;
+      try {
+        record = nlohmann::json::parse(line);
+      } catch (const nlohmann::json::parse_error&) {
+        m_logger->warn("Skipping truncated record of {}", m_file.string());
+        continue;
+      }
+      const auto id{record.at("id").get<uint64_t>()};
+      if (record.count("delivery")) {
+        pending[id] = {record.at("delivery").get<Delivery>(),
+                       record.at("attempts").get<size_t>()};
+      } else if (record.count("attempts")) {
+        if (auto entry{pending.find(id)}; entry != pending.end()) {
+          entry->second.second = record.at("attempts").get<size_t>();
+        }
+      } else {
+        pending.erase(id);
+      }
+    }
+  } catch (const exception& e) {
+    m_logger->error("Can not read pending deliveries from {}: {}", m_file.string(), e.what());
+  }
+  // Kept under their ids, so the journal stays valid until it is rewritten
+  for (auto& [id, delivery] : pending) {
+    m_pending.emplace(id, Entry{move(delivery.first), delivery.second, Clock::now(), false});
+    m_next_id = id + 1;
+  }
+  m_logger->info("Resuming {} pending deliveries", m_pending.size());
+}
+
+} // namespace sel
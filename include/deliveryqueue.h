@@ -0,0 +1,145 @@
+/**
+\file    deliveryqueue.h
+\copyright SEL - Secure EpiLinker
+    Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published
+    by the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+\brief Outbound queue for results and callbacks with retries
+*/
+
+#ifndef SEL_DELIVERYQUEUE_H
+#define SEL_DELIVERYQUEUE_H
+#pragma once
+
+#include "resttypes.h"
+#include "logger.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sel {
+
+/**
+ * A POST request to be delivered at least once
+ *
+ * If forward_url is set, the response body of the successful delivery is
+ * delivered on to it, e.g. the linkage service's answer to the callback.
+ * The completion hooks are not persisted. They are called without any lock
+ * held on the HttpClient's event loop thread, so they must not block.
+ */
+struct Delivery {
+  using Completion = std::function<void (bool delivered)>;
+  std::string url;
+  std::string body;
+  std::list<std::string> headers;
+  std::string forward_url;
+  std::list<std::string> forward_headers;
+  std::string description;
+  Completion on_finished;
+  // Becomes on_finished of the forwarded delivery
+  Completion on_forward_finished;
+};
+
+/**
+ * Delivers results and callbacks in the background
+ *
+ * Failed deliveries, i.e. connection errors, 429 and 5xx replies, are retried
+ * with exponential backoff until deliveryMaxAttempts is reached. Other
+ * replies are final. Requests are sent asynchronously by the HttpClient, the
+ * queue only has its own dispatcher thread.
+ *
+ * Pending deliveries are resumed after a restart from an append-only journal
+ * at deliveryQueuePath. Pushed deliveries are written and synced by the
+ * dispatcher and only sent once journaled, so pushing never waits for the
+ * disk. Bodies are journaled in base64, as CBOR and MessagePack bodies are
+ * binary. The journal is rewritten once most of its records are obsolete.
+ *
+ * At most deliveryMaxPending deliveries are queued, further ones are rejected.
+ */
+class DeliveryQueue {
+  public:
+    static DeliveryQueue& get();
+
+    // A queue of its own, file may be empty to not persist the deliveries
+    DeliveryQueue(std::filesystem::path file, size_t max_attempts,
+                  std::chrono::milliseconds backoff, size_t max_pending);
+    ~DeliveryQueue();
+
+    // False if the queue is full, the delivery's on_finished is then called
+    // with false right away
+    bool push(Delivery);
+    size_t size() const;
+
+    DeliveryQueue(const DeliveryQueue&) = delete;
+    DeliveryQueue& operator=(const DeliveryQueue&) = delete;
+  protected:
+    DeliveryQueue();
+  private:
+    using Clock = std::chrono::steady_clock;
+    struct Entry {
+      Delivery delivery;
+      size_t attempts{0};
+      Clock::time_point next_attempt{};
+      bool in_flight{false};
+    };
+    static constexpr size_t max_in_flight{8};
+    static constexpr std::chrono::minutes max_backoff{10};
+    // Journals shorter than this are never rewritten
+    static constexpr size_t min_rewrite_records{64};
+
+    void dispatch_loop();
+    void finish(uint64_t id, const Delivery&, Clock::time_point start,
+                const SessionResponse&, std::exception_ptr);
+    // Needs m_mutex. Takes the delivery unless the queue is full.
+    bool push_locked(Delivery&);
+    // Writes the journaled changes with m_mutex released and hands the
+    // pushed deliveries on to be sent
+    void flush(std::unique_lock<std::mutex>&);
+    // Only called by the dispatcher
+    void append_journal(const std::vector<std::string>& records);
+    void rewrite_journal(const std::vector<std::string>& records);
+    void load();
+
+    const std::filesystem::path m_file;
+    const size_t m_max_attempts;
+    const std::chrono::milliseconds m_backoff;
+    const size_t m_max_pending; // 0 is unbounded
+    std::map<uint64_t, Entry> m_pending;
+    // Pushed, but not journaled yet
+    std::vector<std::pair<uint64_t, Entry>> m_incoming;
+    uint64_t m_next_id{0};
+    size_t m_in_flight{0};
+    bool m_stopping{false};
+    // Changes not written yet
+    std::vector<std::string> m_journal;
+    // Owned by the dispatcher
+    int m_journal_fd{-1};
+    size_t m_journal_records{0};
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::thread m_dispatcher;
+    std::shared_ptr<spdlog::logger> m_logger{get_logger(ComponentLogger::REST)};
+};
+
+} // namespace sel
+
+#endif /* end of include guard: SEL_DELIVERYQUEUE_H */
@@ -0,0 +1,270 @@
+/**
+ \file    executor.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Shared work-stealing executor for all tasks of the daemon
+*/
+
+#include "executor.h"
+#include "configurationhandler.h"
+#include "resttypes.h"
+#include "metrics.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace sel {
+
+namespace {
+// Worker index of the calling thread in its executor, if any
+thread_local const Executor* t_executor{nullptr};
+thread_local size_t t_worker_index{0};
+
+double to_ms(TaskHandle::Clock::duration d) {
+  return chrono::duration<double, milli>(d).count();
+}
+} // namespace
+
+TaskHandle::TaskHandle(function<void()> task, TaskOptions options)
+  : m_task{move(task)}, m_options{move(options)}, m_submitted{Clock::now()} {}
+
+void TaskHandle::cancel() {
+  m_cancelled = true;
+}
+
+bool TaskHandle::is_cancelled() const {
+  return m_cancelled;
+}
+
+bool TaskHandle::is_done() const {
+  lock_guard<mutex> lock(m_mutex);
+  return m_state == State::DONE || m_state == State::DROPPED;
+}
+
+void TaskHandle::wait() const {
+  unique_lock<mutex> lock(m_mutex);
+  m_done.wait(lock, [this]{ return m_state == State::DONE || m_state == State::DROPPED; });
+}
+
+TaskHandle::Clock::duration TaskHandle::queue_time() const {
+  lock_guard<mutex> lock(m_mutex);
+  return (m_state == State::QUEUED ? Clock::now() : m_started) - m_submitted;
+}
+
+TaskHandle::Clock::duration TaskHandle::run_time() const {
+  lock_guard<mutex> lock(m_mutex);
+  switch (m_state) {
+    case State::RUNNING: return Clock::now() - m_started;
+    case State::DONE: return m_finished - m_started;
+    default: return Clock::duration::zero();
+  }
+}
+
+// Moves a queued task to running, fails if it was cancelled meanwhile
+bool TaskHandle::try_start() {
+  lock_guard<mutex> lock(m_mutex);
+  m_started = Clock::now();
+  if (m_cancelled) {
+    return false;
+  }
+  m_state = State::RUNNING;
+  return true;
+}
+
+void TaskHandle::finish(State state) {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_finished = Clock::now();
+    m_state = state;
+    m_task = nullptr; // release captured resources right away
+  }
+  m_done.notify_all();
+}
+
+Executor& Executor::get() {
+  static Executor singleton{
+    ConfigurationHandler::cget().get_server_config().executor_threads,
+    ConfigurationHandler::cget().get_server_config().executor_max_blocking};
+  return singleton;
+}
+
+Executor::Executor(size_t num_workers, size_t max_blocking_threads)
+  : m_max_blocking_threads{max<size_t>(max_blocking_threads, 1)} {
+  // Named tasks are observed until the executor is gone
+  Metrics::get();
+  if (!num_workers) {
+    num_workers = max(thread::hardware_concurrency(), 1u);
+  }
+  m_logger->debug("Starting executor with {} workers and up to {} blocking threads",
+      num_workers, m_max_blocking_threads);
+  for (size_t i = 0; i != num_workers; ++i) {
+    m_workers.emplace_back(make_unique<Worker>());
+  }
+  m_worker_threads.reserve(num_workers);
+  for (size_t i = 0; i != num_workers; ++i) {
+    m_worker_threads.emplace_back(&Executor::worker_loop, this, i);
+  }
+}
+
+Executor::~Executor() {
+  {
+    lock_guard<mutex> sleep_lock(m_sleep_mutex);
+    lock_guard<mutex> blocking_lock(m_blocking_mutex);
+    m_stopping = true;
+  }
+  m_wake.notify_all();
+  m_blocking_wake.notify_all();
+  for (auto& thread : m_worker_threads) thread.join();
+  for (auto& thread : m_blocking_threads) thread.join();
+  // Completes waiting handles and breaks the futures of async tasks
+  for (auto& queue : m_blocking_queues) {
+    for (const auto& task : queue) {
+      task->finish(TaskHandle::State::DROPPED);
+    }
+    queue.clear();
+  }
+}
+
+shared_ptr<TaskHandle> Executor::submit(function<void()> task, TaskOptions options) {
+  const auto priority{static_cast<size_t>(options.priority)};
+  const bool blocking{options.blocking};
+  shared_ptr<TaskHandle> handle{new TaskHandle(move(task), move(options))};
+
+  if (blocking) {
+    unique_lock<mutex> lock(m_blocking_mutex);
+    m_blocking_queues[priority].push_back(handle);
+    if (!m_idle_blocking_threads && m_blocking_threads.size() < m_max_blocking_threads) {
+      m_blocking_threads.emplace_back(&Executor::blocking_loop, this);
+    } else {
+      lock.unlock();
+      m_blocking_wake.notify_one();
+    }
+    return handle;
+  }
+
+  // Tasks spawned by a worker stay local, it is likely to run them hot
+  const auto index{t_executor == this ? t_worker_index
+                                      : m_next_worker++ % m_workers.size()};
+  // Counted before it can be popped, so m_pending never underflows
+  ++m_pending;
+  {
+    lock_guard<mutex> lock(m_workers[index]->mutex);
+    m_workers[index]->queues[priority].push_back(handle);
+  }
+  { lock_guard<mutex> lock(m_sleep_mutex); }
+  m_wake.notify_one();
+  return handle;
+}
+
+size_t Executor::num_workers() const {
+  return m_workers.size();
+}
+
+shared_ptr<TaskHandle> Executor::pop_local(size_t index) {
+  auto& worker{*m_workers[index]};
+  lock_guard<mutex> lock(worker.mutex);
+  for (auto& queue : worker.queues) {
+    if (!queue.empty()) {
+      auto task{move(queue.front())};
+      queue.pop_front();
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+// Steals the highest priority task of the other workers from the back
+shared_ptr<TaskHandle> Executor::steal(size_t index) {
+  for (size_t priority = 0; priority != num_task_priorities; ++priority) {
+    for (size_t i = 1; i != m_workers.size(); ++i) {
+      auto& victim{*m_workers[(index + i) % m_workers.size()]};
+      lock_guard<mutex> lock(victim.mutex);
+      auto& queue{victim.queues[priority]};
+      if (!queue.empty()) {
+        auto task{move(queue.back())};
+        queue.pop_back();
+        return task;
+      }
+    }
+  }
+  return nullptr;
+}
+
+void Executor::worker_loop(size_t index) {
+  t_executor = this;
+  t_worker_index = index;
+  while (true) {
+    auto task{pop_local(index)};
+    if (!task) task = steal(index);
+    if (task) {
+      --m_pending;
+      run(task);
+      continue;
+    }
+    unique_lock<mutex> lock(m_sleep_mutex);
+    m_wake.wait(lock, [this]{ return m_stopping || m_pending; });
+    if (m_stopping && !m_pending) return;
+  }
+}
+
+void Executor::blocking_loop() {
+  while (true) {
+    shared_ptr<TaskHandle> task;
+    {
+      unique_lock<mutex> lock(m_blocking_mutex);
+      ++m_idle_blocking_threads;
+      m_blocking_wake.wait(lock, [this]{
+          return m_stopping || any_of(m_blocking_queues.begin(), m_blocking_queues.end(),
+              [](const auto& queue){ return !queue.empty(); }); });
+      --m_idle_blocking_threads;
+      if (m_stopping) return;
+      for (auto& queue : m_blocking_queues) {
+        if (!queue.empty()) {
+          task = move(queue.front());
+          queue.pop_front();
+          break;
+        }
+      }
+    }
+    run(task);
+  }
+}
+
+void Executor::run(const shared_ptr<TaskHandle>& task) {
+  if (!task->try_start()) {
+    task->finish(TaskHandle::State::DROPPED);
+    if (!task->m_options.name.empty()) {
+      m_logger->debug("Task {} cancelled after {:.1f}ms in queue",
+          task->m_options.name, to_ms(task->queue_time()));
+    }
+    return;
+  }
+  try {
+    task->m_task();
+  } catch (const exception& e) {
+    m_logger->error("Uncaught exception in task {}: {}", task->m_options.name, e.what());
+  }
+  task->finish(TaskHandle::State::DONE);
+  if (!task->m_options.name.empty()) {
+    const auto queue_time{task->queue_time()}, run_time{task->run_time()};
+    m_logger->debug("Task {} waited {:.1f}ms, ran {:.1f}ms", task->m_options.name,
+        to_ms(queue_time), to_ms(run_time));
+    auto& metrics{Metrics::get()};
+    metrics.observe("sel_task_queue_seconds", {{"task", task->m_options.name}},
+        chrono::duration<double>(queue_time).count());
+    metrics.observe("sel_task_run_seconds", {{"task", task->m_options.name}},
+        chrono::duration<double>(run_time).count());
+  }
+}
+
+} /* end of namespace: sel */
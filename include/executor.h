@@ -0,0 +1,157 @@
+/**
+ \file    executor.h
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Shared work-stealing executor for all tasks of the daemon
+*/
+
+#ifndef SEL_EXECUTOR_H
+#define SEL_EXECUTOR_H
+#pragma once
+
+#include "logger.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace sel {
+
+enum class TaskPriority { HIGH = 0, NORMAL = 1, LOW = 2 };
+constexpr size_t num_task_priorities{3};
+
+struct TaskOptions {
+  TaskPriority priority{TaskPriority::NORMAL};
+  // Blocking tasks, e.g. MPC runs or waiting for remotes, run on their own
+  // threads so they don't starve the compute workers
+  bool blocking{false};
+  // Queue and run times of named tasks are logged and observed as
+  // sel_task_queue_seconds and sel_task_run_seconds
+  std::string name{};
+};
+
+/**
+ * Handle of a submitted task
+ *
+ * Cancelling a queued task drops it, a running task is not interrupted.
+ */
+class TaskHandle {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  void cancel();
+  bool is_cancelled() const;
+  bool is_done() const;
+  // Waits until the task finished or was dropped
+  void wait() const;
+
+  Clock::duration queue_time() const;
+  Clock::duration run_time() const;
+
+private:
+  friend class Executor;
+  enum class State { QUEUED, RUNNING, DONE, DROPPED };
+
+  TaskHandle(std::function<void()> task, TaskOptions options);
+  bool try_start();
+  void finish(State);
+
+  std::function<void()> m_task;
+  const TaskOptions m_options;
+  std::atomic<bool> m_cancelled{false};
+  State m_state{State::QUEUED};
+  Clock::time_point m_submitted, m_started, m_finished;
+  mutable std::mutex m_mutex;
+  mutable std::condition_variable m_done;
+};
+
+/**
+ * Thread pool owning the CPU of the daemon
+ *
+ * Every compute worker has its own prioritized task queues. Tasks submitted
+ * from a worker stay on its queues, other submissions are distributed round
+ * robin. Idle workers steal from the other workers' queues, highest priority
+ * first. Blocking tasks get their own threads, which are created on demand up
+ * to a limit and reused afterwards. Blocking tasks queue once all of them are
+ * busy, so they must not wait for other executor tasks and must not run for
+ * the lifetime of the daemon. Such loops get their own threads: the worker
+ * slots, the delivery dispatcher, the HTTP client's event loop and the job
+ * registry's sweeper.
+ *
+ * On shutdown, queued compute tasks still run. Queued blocking tasks are
+ * dropped, as they may wait for peers, so their futures are broken.
+ */
+class Executor {
+public:
+  static Executor& get();
+
+  std::shared_ptr<TaskHandle> submit(std::function<void()> task, TaskOptions options = {});
+
+  template <typename F>
+  auto async(F&& f, TaskOptions options = {}) {
+    using R = std::invoke_result_t<F>;
+    auto task{std::make_shared<std::packaged_task<R()>>(std::forward<F>(f))};
+    auto result{task->get_future()};
+    submit([task]{ (*task)(); }, std::move(options));
+    return result;
+  }
+
+  size_t num_workers() const;
+
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+protected:
+  Executor(size_t num_workers, size_t max_blocking_threads);
+private:
+  using TaskQueues = std::array<std::deque<std::shared_ptr<TaskHandle>>, num_task_priorities>;
+  struct Worker {
+    std::mutex mutex;
+    TaskQueues queues;
+  };
+
+  ~Executor();
+  void worker_loop(size_t index);
+  void blocking_loop();
+  std::shared_ptr<TaskHandle> pop_local(size_t index);
+  std::shared_ptr<TaskHandle> steal(size_t index);
+  void run(const std::shared_ptr<TaskHandle>&);
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::vector<std::thread> m_worker_threads;
+  std::atomic<size_t> m_pending{0};
+  std::atomic<size_t> m_next_worker{0};
+  std::mutex m_sleep_mutex;
+  std::condition_variable m_wake;
+
+  const size_t m_max_blocking_threads;
+  TaskQueues m_blocking_queues;
+  std::vector<std::thread> m_blocking_threads;
+  size_t m_idle_blocking_threads{0};
+  std::mutex m_blocking_mutex;
+  std::condition_variable m_blocking_wake;
+
+  std::atomic<bool> m_stopping{false};
+  std::shared_ptr<spdlog::logger> m_logger{get_logger(ComponentLogger::SERVER)};
+};
+
+} /* end of namespace: sel */
+#endif /* end of include guard: SEL_EXECUTOR_H */
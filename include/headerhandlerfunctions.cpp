@@ -17,20 +17,61 @@ later version. This program is distributed in the hope that it will be useful,
 #include "headerhandlerfunctions.h"
 #include <string>
 #include <map>
+#include <set>
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <optional>
 #include <thread>
 #include "resttypes.h"
 #include "restbed"
 #include "restresponses.hpp"
+#include "restutils.h"
 #include "serverhandler.h"
+#include "localserver.h"
 #include "configurationhandler.h"
+#include "localconfiguration.h"
 #include "remoteconfiguration.h"
 #include "connectionhandler.h"
 #include "logger.h"
 #include "util.h"
+#include "resourcescheduler.h"
+#include "executor.h"
+#include "metrics.h"
+#include "tracer.h"
 
 using namespace std;
 namespace sel{
 
+// Upper bound for a previous run's reset plus building the next circuit
+constexpr chrono::milliseconds server_ready_timeout{30s};
+// Sent to clients whose run can not be admitted right now
+constexpr chrono::seconds server_busy_retry{1s};
+
+/**
+ * Chunked jobs pinned for a run. Unless the server party takes the run over,
+ * the jobs it newly pinned are abandoned once the last reference is gone,
+ * i.e. on early replies or when the queued run is dropped.
+ */
+class PinnedRun {
+public:
+  PinnedRun(RemoteId remote_id, vector<RecordPart> partition)
+    : m_remote_id{move(remote_id)}, m_partition{move(partition)} {}
+  ~PinnedRun() {
+    if (!m_handed_over) {
+      ServerHandler::get().abandon_run(m_remote_id, m_partition);
+    }
+  }
+  void hand_over() { m_handed_over = true; }
+
+  PinnedRun(const PinnedRun&) = delete;
+  PinnedRun& operator=(const PinnedRun&) = delete;
+private:
+  const RemoteId m_remote_id;
+  const vector<RecordPart> m_partition;
+  atomic<bool> m_handed_over{false};
+};
+
 SessionResponse init_mpc(const shared_ptr<restbed::Session>&,
                               const shared_ptr<const restbed::Request>&,
                               const multimap<string,string>& header,
@@ -40,6 +81,10 @@ SessionResponse init_mpc(const shared_ptr<restbed::Session>&,
   Port aby_server_port;
   string client_ip;
   bool counting_mode;
+  // Spans of both parties share the client's trace id
+  const auto trace_header{header.find("SEL-Trace-Id")};
+  const TraceScope trace_scope{trace_header == header.end() ? "" : trace_header->second};
+  const TraceSpan span{"initMPC", "rest"};
   logger->info("Recieved Linkage Request from {}", remote_id);
   auto remote_config{ConfigurationHandler::cget().get_remote_config(remote_id)};
   if(auto auth_result = // check authentication
@@ -51,21 +96,130 @@ SessionResponse init_mpc(const shared_ptr<restbed::Session>&,
     logger->error("No client record number from {}", remote_id);
     return responses::status_error(400, "No client record number transmitted");
   }
-  if(header.find("Counting-Mode") == header.end()) {
+  if(auto it = header.find("Counting-Mode"); it == header.end()) {
     counting_mode = false;
+  } else {
+    counting_mode = it->second == "true";
+  }
+  // Partial results are only streamed if both sides are configured to
+  bool stream_results{false};
+  if(auto it = header.find("Stream-Results"); it != header.end()) {
+    stream_results = !counting_mode && it->second == "true"
+      && ConfigurationHandler::cget().get_server_config().stream_results;
+  }
+  // The client chooses the party pair, every pair runs its jobs independently.
+  // Clients without party pairs use the first one.
+  try {
+    if(auto it = header.find("SEL-Port"); it != header.end()) {
+      aby_server_port = stoul(it->second);
+    } else {
+      aby_server_port = ServerHandler::cget().get_server_port(remote_id);
+    }
+  } catch (const exception& e) {
+    logger->error("No ABY party port for {}: {}", remote_id, e.what());
+    return responses::status_error(400, "Invalid ABY party port");
+  }
+  const auto record_number{header.find("Record-Number")};
+  const auto valid_number{record_number == header.end()
+    ? nullopt : parse_header_number(record_number->second)};
+  if(!valid_number || !*valid_number) {
+    logger->error("Invalid record number from {}", remote_id);
+    return responses::status_error(400, "Invalid record number");
+  }
+  const size_t num_records{*valid_number};
+  // Coalesced client jobs: the result is split into one part per job
+  vector<RecordPart> partition{{num_records, {}}};
+  if(auto it = header.find("Record-Partition"); it != header.end()) {
+    partition.clear();
+    for(const auto& part : split(it->second, ',')) {
+      const auto part_records{parse_header_number(part)};
+      if(!part_records) {
+        logger->error("Invalid record partition from {}", remote_id);
+        return responses::status_error(400, "Invalid record partition");
+      }
+      partition.push_back({*part_records, {}});
+    }
+    if(accumulate(partition.begin(), partition.end(), size_t{0},
+          [](size_t sum, const RecordPart& part){ return sum + part.num_records; })
+        != num_records) {
+      logger->error("Record partition from {} does not match record number", remote_id);
+      return responses::status_error(400, "Record partition does not match record number");
+    }
+  }
+  // Chunked client jobs: results of continued jobs are held back
+  if(auto it = header.find("Job-Ids"); it != header.end() && !it->second.empty()) {
+    const auto job_ids{split(it->second, ',')};
+    if(job_ids.size() != partition.size()) {
+      logger->error("Job ids from {} do not match record partition", remote_id);
+      return responses::status_error(400, "Job ids do not match record partition");
+    }
+    set<JobId> continued_jobs;
+    if(auto cont = header.find("Continued-Jobs"); cont != header.end() && !cont->second.empty()) {
+      const auto ids{split(cont->second, ',')};
+      continued_jobs.insert(ids.begin(), ids.end());
+    }
+    for(size_t i = 0; i != partition.size(); ++i) {
+      partition[i].job_id = job_ids[i];
+      partition[i].continued = continued_jobs.count(job_ids[i]);
+    }
   }
-  aby_server_port = ServerHandler::cget().get_server_port(remote_id);
-  size_t num_records = stoull(header.find("Record-Number")->second);
-  counting_mode = header.find("Counting-Mode")->second == "true" ? true : false;
   size_t server_record_number;
   shared_ptr<const ServerData> data;
+  shared_ptr<PinnedRun> pinned_run;
   try {
-    server_record_number = DataHandler::get().poll_database(remote_id, counting_mode);
-    data = DataHandler::get().get_database();
+    data = ServerHandler::get().get_run_database(remote_id, partition, counting_mode);
+    pinned_run = make_shared<PinnedRun>(remote_id, partition);
+    server_record_number = data->data->begin()->second.size();
   } catch (const exception& e){
     logger->error("Error geting data from dataservice: {}", e.what());
     return sel::responses::status_error(restbed::INTERNAL_SERVER_ERROR, "Can not get data from dataservice");
   }
+  // Never wait for resources here, the client may hold its own reservation
+  auto& scheduler{ResourceScheduler::get()};
+  optional<ResourceScheduler::Reservation> reservation;
+  try {
+    const auto& circuit_config{ServerHandler::cget()
+      .get_local_server(remote_id, aby_server_port)->get_circuit_config()};
+    if (num_records > scheduler.max_run_records(circuit_config, server_record_number)) {
+      logger->error("Run of {} records from {} exceeds the memory budget", num_records, remote_id);
+      // Lets the client size its next run against the actual database
+      auto too_large{responses::status_error(restbed::REQUEST_ENTITY_TOO_LARGE,
+          "Run exceeds the memory budget, send fewer records")};
+      too_large.headers.emplace("Record-Number", to_string(server_record_number));
+      return too_large;
+    }
+    reservation = scheduler.try_acquire(
+        scheduler.estimate_run(circuit_config, num_records, server_record_number));
+  } catch (const exception& e) {
+    return responses::status_error(restbed::INTERNAL_SERVER_ERROR, e.what());
+  }
+  if (!reservation) {
+    auto busy{responses::status_error(restbed::SERVICE_UNAVAILABLE, "MPC resources exhausted")};
+    busy.headers.emplace("Retry-After", to_string(server_busy_retry.count()));
+    return busy;
+  }
+  // Only reply once the server party is ready for this job, so the client can
+  // start its MPC run right away
+  auto readiness{make_shared<ServerReadiness>()};
+  auto server_runner{Executor::get().submit(
+      [remote_id, aby_server_port, data, num_records, partition, counting_mode,
+       stream_results, readiness, reservation = make_shared<ResourceScheduler::Reservation>(move(*reservation)),
+       pinned_run, trace_id = Tracer::current_trace_id()]() {
+      pinned_run->hand_over();
+      const TraceScope trace_scope{trace_id};
+      ServerHandler::get().run_server(remote_id, aby_server_port, data, num_records,
+                                      partition, counting_mode, stream_results, readiness);
+  }, {TaskPriority::HIGH, true, "server run"})};
+  try {
+    if (!readiness->wait_ready(server_ready_timeout)) {
+      server_runner->cancel(); // don't start a run the client gave up on
+      logger->error("Server for {} not ready within {}s", remote_id,
+          chrono::duration_cast<chrono::seconds>(server_ready_timeout).count());
+      return responses::status_error(restbed::SERVICE_UNAVAILABLE, "MPC server not ready");
+    }
+  } catch (const exception& e) {
+    return responses::status_error(restbed::INTERNAL_SERVER_ERROR, e.what());
+  }
   response.return_code = restbed::OK;
   if(!counting_mode){
     response.body = "Linkage server running"s;
@@ -75,11 +229,8 @@ SessionResponse init_mpc(const shared_ptr<restbed::Session>&,
   response.headers = {{"Content-Length", to_string(response.body.length())},
                       {"Record-Number", to_string(server_record_number)},
                       {"SEL-Port", to_string(aby_server_port)},
+                      {"Stream-Results", stream_results ? "true" : "false"},
                       {"Connection", "Close"}};
-  std::thread server_runner([remote_id, data, num_records, counting_mode]() {
-      ServerHandler::get().run_server(remote_id, data, num_records, counting_mode);
-  });
-  server_runner.detach();
   return response;
 }
 
@@ -105,6 +256,58 @@ SessionResponse test_configs(const shared_ptr<restbed::Session>&,
   return response;
 }
 
+// Metrics and traces reveal job activity, so only the local data service
+// may read them
+static SessionResponse check_local_authentication(const multimap<string,string>& header) {
+  const auto local_config{ConfigurationHandler::cget().get_local_config()};
+  if (!local_config) {
+    return responses::not_initialized;
+  }
+  return local_config->get_local_authenticator().check_authentication_header(header);
+}
+
+SessionResponse get_metrics(const shared_ptr<restbed::Session>&,
+                              const shared_ptr<const restbed::Request>&,
+                              const multimap<string,string>& header,
+                              const string&,
+                              const shared_ptr<spdlog::logger>& logger) {
+  if(auto auth_result = check_local_authentication(header);
+      auth_result.return_code != 200){ // auth not ok
+    return auth_result;
+  }
+  logger->trace("Metrics scraped");
+  SessionResponse response;
+  response.return_code = restbed::OK;
+  response.body = Metrics::get().render();
+  response.headers = {{"Content-Length", to_string(response.body.length())},
+                      {"Content-Type", "text/plain; version=0.0.4"},
+                      {"Connection", "Close"}};
+  return response;
+}
+
+SessionResponse get_trace(const shared_ptr<restbed::Session>&,
+                              const shared_ptr<const restbed::Request>&,
+                              const multimap<string,string>& header,
+                              const string& trace_id,
+                              const shared_ptr<spdlog::logger>& logger) {
+  if(auto auth_result = check_local_authentication(header);
+      auth_result.return_code != 200){ // auth not ok
+    return auth_result;
+  }
+  auto& tracer{Tracer::get()};
+  if (!tracer.enabled()) {
+    return responses::status_error(restbed::NOT_FOUND, "Tracing disabled");
+  }
+  logger->debug("Exporting trace {}", trace_id);
+  SessionResponse response;
+  response.return_code = restbed::OK;
+  response.body = tracer.export_trace(trace_id).dump();
+  response.headers = {{"Content-Length", to_string(response.body.length())},
+                      {"Content-Type", "application/json"},
+                      {"Connection", "Close"}};
+  return response;
+}
+
 SessionResponse test_linkage_service(const shared_ptr<restbed::Session>&,
                               const shared_ptr<const restbed::Request>&,
                               const multimap<string,string>&,
@@ -54,6 +54,16 @@ SessionResponse test_configs(const std::shared_ptr<restbed::Session>&,
                               const std::multimap<std::string,std::string>& headers,
                               const std::string& remote_id,
                               const std::shared_ptr<spdlog::logger>& logger);
+SessionResponse get_metrics(const std::shared_ptr<restbed::Session>&,
+                              const std::shared_ptr<const restbed::Request>&,
+                              const std::multimap<std::string,std::string>& headers,
+                              const std::string& parameter,
+                              const std::shared_ptr<spdlog::logger>& logger);
+SessionResponse get_trace(const std::shared_ptr<restbed::Session>&,
+                              const std::shared_ptr<const restbed::Request>&,
+                              const std::multimap<std::string,std::string>& headers,
+                              const std::string& trace_id,
+                              const std::shared_ptr<spdlog::logger>& logger);
 SessionResponse test_linkage_service(const std::shared_ptr<restbed::Session>&,
                               const std::shared_ptr<const restbed::Request>&,
                               const std::multimap<std::string,std::string>& headers,
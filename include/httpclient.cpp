@@ -0,0 +1,288 @@
+/**
+\file    httpclient.cpp
+\copyright SEL - Secure EpiLinker
+    Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published
+    by the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+\brief Pooled keep-alive HTTP client for all outbound requests
+*/
+
+#include "httpclient.h"
+#include "util.h"
+#include <stdexcept>
+
+using namespace std;
+
+namespace sel {
+
+struct HttpClient::Transfer {
+  CURL* easy{nullptr};
+  string request_body;
+  string response_body;
+  multimap<string, string> response_headers;
+  curl_slist* header_list{nullptr};
+  promise<SessionResponse> response;
+  // Replaces the promise if set
+  Completion on_complete;
+
+  void succeed(SessionResponse result) {
+    if (on_complete) {
+      on_complete(move(result), nullptr);
+    } else {
+      response.set_value(move(result));
+    }
+  }
+  void fail(exception_ptr error) {
+    if (on_complete) {
+      on_complete({}, error);
+    } else {
+      response.set_exception(error);
+    }
+  }
+};
+
+HttpClient& HttpClient::get() {
+  static HttpClient singleton;
+  return singleton;
+}
+
+HttpClient::HttpClient() {
+  if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+    throw runtime_error("Can not initialize libcurl");
+  }
+  m_share = curl_share_init();
+  curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, lock_share);
+  curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, unlock_share);
+  curl_share_setopt(m_share, CURLSHOPT_USERDATA, this);
+
+  m_multi = curl_multi_init();
+  // Let keep-alive connections to the remote, data and linkage services pile
+  // up in the connection cache instead of reconnecting for every request
+  curl_multi_setopt(m_multi, CURLMOPT_MAXCONNECTS, 32L);
+  m_loop_thread = thread(&HttpClient::event_loop, this);
+}
+
+HttpClient::~HttpClient() {
+  m_running = false;
+  curl_multi_wakeup(m_multi);
+  m_loop_thread.join();
+  for (auto& active : m_active) {
+    curl_multi_remove_handle(m_multi, active.first);
+    curl_slist_free_all(active.second->header_list);
+    active.second->fail(make_exception_ptr(runtime_error("HTTP client shut down")));
+    curl_easy_cleanup(active.first);
+  }
+  for (auto easy : m_idle_handles) {
+    curl_easy_cleanup(easy);
+  }
+  curl_multi_cleanup(m_multi);
+  curl_share_cleanup(m_share);
+  curl_global_cleanup();
+}
+
+future<SessionResponse> HttpClient::async_request(HttpMethod method, string url,
+    string body, list<string> headers) {
+  auto transfer{make_unique<Transfer>()};
+  auto result{transfer->response.get_future()};
+  transfer->request_body = move(body);
+  enqueue(move(transfer), method, url, move(headers));
+  return result;
+}
+
+void HttpClient::async_request(HttpMethod method, string url, string body,
+    list<string> headers, Completion on_complete) {
+  auto transfer{make_unique<Transfer>()};
+  transfer->request_body = move(body);
+  transfer->on_complete = move(on_complete);
+  enqueue(move(transfer), method, url, move(headers));
+}
+
+void HttpClient::enqueue(unique_ptr<Transfer> transfer, HttpMethod method,
+    const string& url, list<string> headers) {
+  headers.emplace_back("Expect:");
+  for (const auto& header : headers) {
+    transfer->header_list = curl_slist_append(transfer->header_list, header.c_str());
+  }
+
+  // Easy handles are only configured here, they are handed to the multi
+  // handle by the event loop thread
+  HttpTimeouts timeouts;
+  {
+    lock_guard<mutex> lock(m_pending_mutex);
+    transfer->easy = acquire_easy_handle();
+    timeouts = m_timeouts;
+  }
+  auto* easy{transfer->easy};
+  curl_easy_setopt(easy, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(easy, CURLOPT_HTTPHEADER, transfer->header_list);
+  curl_easy_setopt(easy, CURLOPT_SHARE, m_share);
+  curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(timeouts.connect.count()));
+  curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, static_cast<long>(timeouts.total.count()));
+  if (timeouts.low_speed.count()) {
+    curl_easy_setopt(easy, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(easy, CURLOPT_LOW_SPEED_TIME, static_cast<long>(timeouts.low_speed.count()));
+  }
+  curl_easy_setopt(easy, CURLOPT_SSL_VERIFYHOST, 0L);
+  curl_easy_setopt(easy, CURLOPT_SSL_VERIFYPEER, 0L);
+  curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, write_callback);
+  curl_easy_setopt(easy, CURLOPT_WRITEDATA, transfer.get());
+  curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, header_callback);
+  curl_easy_setopt(easy, CURLOPT_HEADERDATA, transfer.get());
+  curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer.get());
+  if (method == HttpMethod::POST) {
+    curl_easy_setopt(easy, CURLOPT_POST, 1L);
+    curl_easy_setopt(easy, CURLOPT_POSTFIELDS, transfer->request_body.data());
+    curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE,
+        static_cast<curl_off_t>(transfer->request_body.size()));
+  } else {
+    curl_easy_setopt(easy, CURLOPT_HTTPGET, 1L);
+  }
+
+  {
+    lock_guard<mutex> lock(m_pending_mutex);
+    m_pending.emplace_back(move(transfer));
+  }
+  curl_multi_wakeup(m_multi);
+}
+
+SessionResponse HttpClient::request(HttpMethod method, string url,
+    string body, list<string> headers) {
+  // The loop thread would wait for a transfer only it can drive
+  if (this_thread::get_id() == m_loop_thread.get_id()) {
+    throw logic_error("Synchronous HTTP request from the HTTP client's event loop");
+  }
+  return async_request(method, move(url), move(body), move(headers)).get();
+}
+
+future<SessionResponse> HttpClient::async_get(string url, list<string> headers) {
+  return async_request(HttpMethod::GET, move(url), "", move(headers));
+}
+
+future<SessionResponse> HttpClient::async_post(string url, string body,
+    list<string> headers) {
+  return async_request(HttpMethod::POST, move(url), move(body), move(headers));
+}
+
+void HttpClient::set_timeouts(HttpTimeouts timeouts) {
+  lock_guard<mutex> lock(m_pending_mutex);
+  m_timeouts = timeouts;
+}
+
+void HttpClient::event_loop() {
+  int running_transfers{0};
+  while (m_running) {
+    vector<unique_ptr<Transfer>> new_transfers;
+    {
+      lock_guard<mutex> lock(m_pending_mutex);
+      new_transfers.swap(m_pending);
+    }
+    for (auto& transfer : new_transfers) {
+      start_transfer(move(transfer));
+    }
+
+    curl_multi_perform(m_multi, &running_transfers);
+    CURLMsg* message;
+    int messages_left;
+    while ((message = curl_multi_info_read(m_multi, &messages_left))) {
+      if (message->msg == CURLMSG_DONE) {
+        finish_transfer(message->easy_handle, message->data.result);
+      }
+    }
+    // Sleeps until there is socket activity, a curl timeout expires or
+    // a new request wakes the loop up
+    curl_multi_poll(m_multi, nullptr, 0, 1000, nullptr);
+  }
+}
+
+void HttpClient::start_transfer(unique_ptr<Transfer> transfer) {
+  auto* easy{transfer->easy};
+  if (auto res = curl_multi_add_handle(m_multi, easy); res != CURLM_OK) {
+    curl_slist_free_all(transfer->header_list);
+    transfer->fail(make_exception_ptr(
+        runtime_error("Can not start HTTP transfer: "s + curl_multi_strerror(res))));
+    lock_guard<mutex> lock(m_pending_mutex);
+    release_easy_handle(easy);
+    return;
+  }
+  m_active.emplace(easy, move(transfer));
+}
+
+void HttpClient::finish_transfer(CURL* easy, CURLcode result) {
+  curl_multi_remove_handle(m_multi, easy);
+  auto transfer{move(m_active.at(easy))};
+  m_active.erase(easy);
+  curl_slist_free_all(transfer->header_list);
+
+  if (result == CURLE_OK) {
+    long response_code{0};
+    curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &response_code);
+    transfer->succeed({static_cast<int>(response_code),
+        move(transfer->response_body), move(transfer->response_headers)});
+  } else {
+    char* url{nullptr};
+    curl_easy_getinfo(easy, CURLINFO_EFFECTIVE_URL, &url);
+    m_logger->warn("HTTP request to {} failed: {}", url ? url : "",
+        curl_easy_strerror(result));
+    transfer->fail(make_exception_ptr(
+        runtime_error("HTTP request failed: "s + curl_easy_strerror(result))));
+  }
+  lock_guard<mutex> lock(m_pending_mutex);
+  release_easy_handle(easy);
+}
+
+// Both functions need m_pending_mutex held
+CURL* HttpClient::acquire_easy_handle() {
+  if (m_idle_handles.empty()) {
+    return curl_easy_init();
+  }
+  auto* easy{m_idle_handles.back()};
+  m_idle_handles.pop_back();
+  return easy;
+}
+
+void HttpClient::release_easy_handle(CURL* easy) {
+  // Reset keeps the handle's connection and session caches
+  curl_easy_reset(easy);
+  m_idle_handles.emplace_back(easy);
+}
+
+size_t HttpClient::write_callback(char* data, size_t size, size_t nmemb, void* user) {
+  auto* transfer{static_cast<Transfer*>(user)};
+  transfer->response_body.append(data, size * nmemb);
+  return size * nmemb;
+}
+
+size_t HttpClient::header_callback(char* data, size_t size, size_t nmemb, void* user) {
+  auto* transfer{static_cast<Transfer*>(user)};
+  string line(data, size * nmemb);
+  if (line.compare(0, 5, "HTTP/") == 0) {
+    // New status line, e.g. after a "100 Continue" or a redirect
+    transfer->response_headers.clear();
+  } else if (const auto pos = line.find(':'); pos != string::npos) {
+    transfer->response_headers.emplace(trim_copy(line.substr(0, pos)),
+                                       trim_copy(line.substr(pos + 1)));
+  }
+  return size * nmemb;
+}
+
+void HttpClient::lock_share(CURL*, curl_lock_data data, curl_lock_access, void* user) {
+  static_cast<HttpClient*>(user)->m_share_mutexes.at(data).lock();
+}
+
+void HttpClient::unlock_share(CURL*, curl_lock_data data, void* user) {
+  static_cast<HttpClient*>(user)->m_share_mutexes.at(data).unlock();
+}
+
+} // namespace sel
@@ -0,0 +1,111 @@
+/**
+\file    httpclient.h
+\copyright SEL - Secure EpiLinker
+    Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published
+    by the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+\brief Pooled keep-alive HTTP client for all outbound requests
+*/
+
+#ifndef SEL_HTTPCLIENT_H
+#define SEL_HTTPCLIENT_H
+#pragma once
+
+#include "resttypes.h"
+#include "logger.h"
+#include <array>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <curl/curl.h>
+
+namespace sel {
+
+enum class HttpMethod { GET, POST };
+
+/**
+ * Shared HTTP client built on a single libcurl multi handle
+ *
+ * All transfers are driven by one event loop thread. Connections are kept
+ * alive in the multi handle's connection cache, DNS results and TLS sessions
+ * are shared between all easy handles, which are themselves recycled.
+ * Response headers are returned in SessionResponse::headers.
+ *
+ * Completions run on the event loop thread, so they must neither call
+ * request() nor wait on a future of this client. request() throws a
+ * logic_error instead of deadlocking if called there.
+ */
+class HttpClient {
+  public:
+    // Gets the response or the connection error. Called on the event loop
+    // thread without any lock held, so it must not block.
+    using Completion = std::function<void (SessionResponse, std::exception_ptr)>;
+
+    static HttpClient& get();
+
+    std::future<SessionResponse> async_request(HttpMethod, std::string url,
+        std::string body, std::list<std::string> headers);
+    void async_request(HttpMethod, std::string url, std::string body,
+        std::list<std::string> headers, Completion);
+    SessionResponse request(HttpMethod, std::string url,
+        std::string body, std::list<std::string> headers);
+
+    std::future<SessionResponse> async_get(std::string url, std::list<std::string> headers);
+    std::future<SessionResponse> async_post(std::string url, std::string body, std::list<std::string> headers);
+
+    // Applies to requests started afterwards
+    void set_timeouts(HttpTimeouts);
+
+    HttpClient(const HttpClient&) = delete;
+    HttpClient& operator=(const HttpClient&) = delete;
+  protected:
+    HttpClient();
+  private:
+    struct Transfer;
+    ~HttpClient();
+
+    void enqueue(std::unique_ptr<Transfer>, HttpMethod, const std::string& url,
+        std::list<std::string> headers);
+    void event_loop();
+    void start_transfer(std::unique_ptr<Transfer>);
+    void finish_transfer(CURL*, CURLcode);
+    CURL* acquire_easy_handle();
+    void release_easy_handle(CURL*);
+
+    static size_t write_callback(char*, size_t, size_t, void*);
+    static size_t header_callback(char*, size_t, size_t, void*);
+    static void lock_share(CURL*, curl_lock_data, curl_lock_access, void*);
+    static void unlock_share(CURL*, curl_lock_data, void*);
+
+    CURLM* m_multi{nullptr};
+    CURLSH* m_share{nullptr};
+    std::array<std::mutex, CURL_LOCK_DATA_LAST> m_share_mutexes;
+    std::mutex m_pending_mutex;
+    std::vector<std::unique_ptr<Transfer>> m_pending;
+    std::map<CURL*, std::unique_ptr<Transfer>> m_active;
+    std::vector<CURL*> m_idle_handles;
+    HttpTimeouts m_timeouts;
+    std::atomic<bool> m_running{true};
+    std::thread m_loop_thread;
+    std::shared_ptr<spdlog::logger> m_logger{get_logger(ComponentLogger::REST)};
+};
+
+} // namespace sel
+
+#endif /* end of include guard: SEL_HTTPCLIENT_H */
@@ -0,0 +1,268 @@
+/**
+\file    jobregistry.cpp
+\copyright SEL - Secure EpiLinker
+    Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published
+    by the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+\brief Sharded registry of the linkage jobs for status retrieval
+*/
+
+#include "jobregistry.h"
+#include "configurationhandler.h"
+#include "linkagejob.h"
+#include "metrics.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace std;
+namespace sel {
+
+JobRegistry& JobRegistry::get() {
+  static JobRegistry singleton;
+  return singleton;
+}
+
+JobRegistry const& JobRegistry::cget() {
+  return cref(get());
+}
+
+JobRegistry::JobRegistry()
+  : m_retention{ConfigurationHandler::cget().get_server_config().job_retention},
+    m_sweep_interval{max<Clock::duration>(m_retention / 4, chrono::seconds{1})} {
+  Metrics::get().add_collector([this](Metrics& metrics){ collect_metrics(metrics); });
+  m_sweeper = thread(&JobRegistry::sweep_loop, this);
+}
+
+JobRegistry::~JobRegistry() {
+  {
+    lock_guard<mutex> lock(m_sweeper_mutex);
+    m_stopping = true;
+  }
+  m_sweeper_wake.notify_all();
+  m_sweeper.join();
+}
+
+JobRegistry::Shard& JobRegistry::shard_of(const JobId& id) {
+  return m_shards[hash<JobId>{}(id) % num_shards];
+}
+
+const JobRegistry::Shard& JobRegistry::shard_of(const JobId& id) const {
+  return m_shards[hash<JobId>{}(id) % num_shards];
+}
+
+void JobRegistry::add(const shared_ptr<LinkageJob>& job) {
+  auto& shard{shard_of(job->get_id())};
+  job->set_status_listener([this](const JobId& id, JobStatus status){ notify(id, status); });
+  const auto sequence{m_next_sequence++};
+  lock_guard<mutex> lock(shard.mutex);
+  if (!shard.jobs.emplace(job->get_id(), Entry{sequence, job}).second) {
+    throw runtime_error("Job id " + job->get_id() + " is already registered");
+  }
+  shard.order.emplace(sequence, job->get_id());
+}
+
+shared_ptr<LinkageJob> JobRegistry::find(const JobId& id) const {
+  const auto& shard{shard_of(id)};
+  lock_guard<mutex> lock(shard.mutex);
+  return shard.jobs.at(id).job;
+}
+
+JobStatus JobRegistry::get_status(const JobId& id) const {
+  return find(id)->get_status();
+}
+
+nlohmann::json JobRegistry::list(size_t page, size_t page_size) const {
+  if (!page || !page_size) {
+    throw invalid_argument("page and pageSize must be positive");
+  }
+  const auto total_jobs{size()};
+  const auto skip{page - 1 <= total_jobs / page_size ? (page - 1) * page_size : total_jobs};
+  auto result = page_after(0, skip, page_size, total_jobs);
+  result["page"] = page;
+  result["lastPageNumber"] = max<size_t>((total_jobs + page_size - 1) / page_size, 1);
+  return result;
+}
+
+nlohmann::json JobRegistry::list_after(const string& cursor, size_t page_size) const {
+  if (!page_size) {
+    throw invalid_argument("pageSize must be positive");
+  }
+  if (cursor.empty() || !all_of(cursor.begin(), cursor.end(), ::isdigit)) {
+    throw invalid_argument("Invalid cursor");
+  }
+  return page_after(stoull(cursor), 0, page_size, size());
+}
+
+nlohmann::json JobRegistry::list_all() const {
+  auto result = nlohmann::json::object();
+  for (const auto& shard : m_shards) {
+    lock_guard<mutex> lock(shard.mutex);
+    for (const auto& [id, entry] : shard.jobs) {
+      result[id] = js_enum_to_string(entry.job->get_status());
+    }
+  }
+  return result;
+}
+
+// Every shard contributes at most limit jobs, so only one shard is locked at
+// a time. Jobs created meanwhile may or may not be listed.
+JobRegistry::SequencedJobs JobRegistry::jobs_after(uint64_t cursor, size_t limit) const {
+  SequencedJobs jobs;
+  for (const auto& shard : m_shards) {
+    lock_guard<mutex> lock(shard.mutex);
+    auto position{shard.order.upper_bound(cursor)};
+    for (size_t taken = 0; position != shard.order.end() && taken != limit;
+        ++position, ++taken) {
+      jobs.emplace_back(position->first, shard.jobs.at(position->second).job);
+    }
+  }
+  const auto by_sequence = [](const auto& a, const auto& b){ return a.first < b.first; };
+  if (jobs.size() > limit) {
+    nth_element(jobs.begin(), jobs.begin() + limit, jobs.end(), by_sequence);
+    jobs.erase(jobs.begin() + limit, jobs.end());
+  }
+  sort(jobs.begin(), jobs.end(), by_sequence);
+  return jobs;
+}
+
+nlohmann::json JobRegistry::page_after(uint64_t cursor, size_t skip,
+    size_t page_size, size_t total_jobs) const {
+  const auto listed{min(page_size, max<size_t>(total_jobs, 1))};
+  // One more job tells whether another page follows
+  const auto jobs{jobs_after(cursor, skip + listed + 1)};
+
+  nlohmann::json result;
+  result["pageSize"] = page_size;
+  result["totalJobs"] = total_jobs;
+  result["jobs"] = nlohmann::json::object();
+  const auto last{jobs.begin() + min(skip + listed, jobs.size())};
+  for (auto job = jobs.begin() + min(skip, jobs.size()); job != last; ++job) {
+    result["jobs"][job->second->get_id()] = js_enum_to_string(job->second->get_status());
+    result["nextCursor"] = to_string(job->first);
+  }
+  if (jobs.size() <= skip + listed) {
+    result.erase("nextCursor"); // last page
+  }
+  return result;
+}
+
+size_t JobRegistry::size() const {
+  size_t result{0};
+  for (const auto& shard : m_shards) {
+    lock_guard<mutex> lock(shard.mutex);
+    result += shard.jobs.size();
+  }
+  return result;
+}
+
+void JobRegistry::collect_metrics(Metrics& metrics) const {
+  map<JobStatus, size_t> jobs{{JobStatus::QUEUED, 0}, {JobStatus::RUNNING, 0},
+                              {JobStatus::HOLD, 0}, {JobStatus::FAULT, 0},
+                              {JobStatus::DONE, 0}};
+  for (const auto& shard : m_shards) {
+    lock_guard<mutex> lock(shard.mutex);
+    for (const auto& job : shard.jobs) {
+      ++jobs[job.second.job->get_status()];
+    }
+  }
+  for (const auto& [status, count] : jobs) {
+    metrics.set("sel_jobs", {{"status", js_enum_to_string(status)}}, count);
+  }
+}
+
+size_t JobRegistry::subscribe(const vector<JobId>& jobs, StatusCallback callback) {
+  size_t subscription;
+  {
+    lock_guard<mutex> lock(m_subscription_mutex);
+    subscription = m_next_subscription++;
+    m_subscriptions.emplace(subscription, jobs);
+  }
+  const auto shared_callback{make_shared<StatusCallback>(move(callback))};
+  for (const auto& job : jobs) {
+    auto& shard{shard_of(job)};
+    lock_guard<mutex> lock(shard.watcher_mutex);
+    shard.watchers.emplace(job, Watcher{subscription, shared_callback});
+  }
+  return subscription;
+}
+
+void JobRegistry::unsubscribe(size_t subscription) {
+  vector<JobId> jobs;
+  {
+    lock_guard<mutex> lock(m_subscription_mutex);
+    const auto entry{m_subscriptions.find(subscription)};
+    if (entry == m_subscriptions.end()) {
+      return;
+    }
+    jobs = move(entry->second);
+    m_subscriptions.erase(entry);
+  }
+  for (const auto& job : jobs) {
+    auto& shard{shard_of(job)};
+    lock_guard<mutex> lock(shard.watcher_mutex);
+    auto [first, last] = shard.watchers.equal_range(job);
+    for (; first != last; ++first) {
+      if (first->second.subscription == subscription) {
+        shard.watchers.erase(first);
+        break;
+      }
+    }
+  }
+}
+
+// Callbacks run without the lock, so they may unsubscribe themselves
+void JobRegistry::notify(const JobId& id, JobStatus status) {
+  vector<shared_ptr<StatusCallback>> callbacks;
+  {
+    auto& shard{shard_of(id)};
+    lock_guard<mutex> lock(shard.watcher_mutex);
+    auto [first, last] = shard.watchers.equal_range(id);
+    for (; first != last; ++first) {
+      callbacks.emplace_back(first->second.callback);
+    }
+  }
+  for (const auto& callback : callbacks) {
+    (*callback)(id, status);
+  }
+}
+
+void JobRegistry::sweep_loop() {
+  unique_lock<mutex> lock(m_sweeper_mutex);
+  while (!m_sweeper_wake.wait_for(lock, m_sweep_interval, [this]{ return m_stopping; })) {
+    const auto now{Clock::now()};
+    for (auto& shard : m_shards) {
+      lock_guard<mutex> shard_lock(shard.mutex);
+      sweep(shard, now);
+    }
+  }
+}
+
+// Needs the shard's mutex
+void JobRegistry::sweep(Shard& shard, Clock::time_point now) {
+  size_t evicted{0};
+  for (auto job = shard.jobs.begin(); job != shard.jobs.end();) {
+    const auto& entry{job->second};
+    if (entry.job->is_finished() && now - entry.job->get_finish_time() > m_retention) {
+      shard.order.erase(entry.sequence);
+      job = shard.jobs.erase(job);
+      ++evicted;
+    } else {
+      ++job;
+    }
+  }
+  if (evicted) {
+    m_logger->debug("Evicted {} finished jobs", evicted);
+  }
+}
+
+} // namespace sel
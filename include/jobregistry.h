@@ -0,0 +1,137 @@
+/**
+\file    jobregistry.h
+\copyright SEL - Secure EpiLinker
+    Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published
+    by the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+\brief Sharded registry of the linkage jobs for status retrieval
+*/
+
+#ifndef SEL_JOBREGISTRY_H
+#define SEL_JOBREGISTRY_H
+#pragma once
+
+#include "resttypes.h"
+#include "logger.h"
+#include "nlohmann/json.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sel {
+
+class LinkageJob;
+class Metrics;
+
+/**
+ * Registry of all linkage jobs of this daemon
+ *
+ * Jobs are spread over independently locked shards by their id, so status
+ * requests only contend with requests for jobs of the same shard. Job ids are
+ * random, so every job also gets a sequence number in order of creation, which
+ * each shard keeps an index of. Listings take the first jobs of one shard at a
+ * time and merge them without any lock held. Finished jobs older than the
+ * configured retention are evicted by a sweeper thread once per sweep
+ * interval.
+ *
+ * Status changes of registered jobs are pushed to subscribers, e.g. long
+ * polling or streaming status requests. Watchers are kept in the shard of
+ * their job, so notifying only locks that shard.
+ */
+class JobRegistry {
+  public:
+    // Called on the thread changing the status, must not block
+    using StatusCallback = std::function<void (const JobId&, JobStatus)>;
+
+    static JobRegistry& get();
+    static JobRegistry const& cget();
+
+    void add(const std::shared_ptr<LinkageJob>&);
+    // Throws if the job is unknown or already evicted
+    std::shared_ptr<LinkageJob> find(const JobId&) const;
+    JobStatus get_status(const JobId&) const;
+    // Status of the jobs on page (starting at 1) in order of creation. Costs
+    // grow with the page number, list_after does not.
+    nlohmann::json list(size_t page, size_t page_size) const;
+    // Status of the next page_size jobs created after the cursor job. The
+    // cursor is the nextCursor of the previous page.
+    nlohmann::json list_after(const std::string& cursor, size_t page_size) const;
+    // Status of all jobs by id, as listed by earlier versions
+    nlohmann::json list_all() const;
+    size_t size() const;
+
+    size_t subscribe(const std::vector<JobId>&, StatusCallback);
+    void unsubscribe(size_t subscription);
+
+    JobRegistry(const JobRegistry&) = delete;
+    JobRegistry& operator=(const JobRegistry&) = delete;
+  protected:
+    JobRegistry();
+  private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t num_shards{16};
+    struct Watcher {
+      size_t subscription;
+      std::shared_ptr<StatusCallback> callback;
+    };
+    struct Entry {
+      uint64_t sequence;
+      std::shared_ptr<LinkageJob> job;
+    };
+    struct Shard {
+      mutable std::mutex mutex;
+      std::unordered_map<JobId, Entry> jobs;
+      std::map<uint64_t, JobId> order; // by sequence number
+      std::mutex watcher_mutex;
+      std::unordered_multimap<JobId, Watcher> watchers;
+    };
+
+    ~JobRegistry();
+    Shard& shard_of(const JobId&);
+    const Shard& shard_of(const JobId&) const;
+    using SequencedJobs = std::vector<std::pair<uint64_t, std::shared_ptr<LinkageJob>>>;
+    // First limit jobs created after the cursor sequence number
+    SequencedJobs jobs_after(uint64_t cursor, size_t limit) const;
+    // Page of the jobs after the cursor, skipping the first skip jobs
+    nlohmann::json page_after(uint64_t cursor, size_t skip, size_t page_size,
+                              size_t total_jobs) const;
+    void sweep_loop();
+    void sweep(Shard&, Clock::time_point now);
+    void notify(const JobId&, JobStatus);
+    void collect_metrics(Metrics&) const;
+
+    std::array<Shard, num_shards> m_shards;
+    std::atomic<uint64_t> m_next_sequence{1}; // 0 is the cursor of the first page
+    const std::chrono::seconds m_retention;
+    const Clock::duration m_sweep_interval;
+    // Jobs of every subscription
+    std::map<size_t, std::vector<JobId>> m_subscriptions;
+    size_t m_next_subscription{0};
+    std::mutex m_subscription_mutex;
+    bool m_stopping{false};
+    std::mutex m_sweeper_mutex;
+    std::condition_variable m_sweeper_wake;
+    std::thread m_sweeper;
+    std::shared_ptr<spdlog::logger> m_logger{get_logger(ComponentLogger::SERVER)};
+};
+
+} // namespace sel
+
+#endif /* end of include guard: SEL_JOBREGISTRY_H */
@@ -18,6 +18,8 @@
 
 #include "jsonhandlerfunctions.h"
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <memory>
 #include <string>
@@ -32,6 +34,8 @@
 #include "nlohmann/json.hpp"
 #include "remoteconfiguration.h"
 #include "configurationhandler.h"
+#include "executor.h"
+#include "jobregistry.h"
 #include "restbed"
 #include "resttypes.h"
 #include "restutils.h"
@@ -61,20 +65,20 @@ SessionResponse valid_test_config_json_handler(
         auth_result.return_code != 200){ // auth not ok
       return auth_result;
     }
-    Port aby_port = connection_handler.choose_aby_port();
-    logger->debug("ABY Server port: {}", aby_port);
     auto client_comparison_config = client_config;
     // Compare Configs
     if (config_handler.compare_configuration(client_comparison_config, remote_id)) {
       logger->info("Valid config");
-      remote_config->set_aby_port(aby_port);
+      // One server port per ABY party pair
+      const auto aby_ports{connection_handler.choose_aby_ports(
+          config_handler.get_server_config().aby_parties_per_remote)};
+      logger->debug("ABY Server ports: {}", assemble_port_list(aby_ports));
       remote_config->mark_mutually_initialized();
 
-      logger->info("Building MPC Server");
-      RemoteAddress tempadr{remote_config->get_remote_host(),aby_port};
-      std::thread server_creator([remote_id,tempadr](){ServerHandler::get().insert_server(remote_id, tempadr);});
-      server_creator.detach();
-      return responses::server_initialized(aby_port);
+      logger->info("Building MPC Servers");
+      Executor::get().submit([remote_id,aby_ports](){ServerHandler::get().insert_server(remote_id, aby_ports);},
+          {TaskPriority::HIGH, true, "server creation"});
+      return responses::server_initialized(assemble_port_list(aby_ports));
     } else {
       logger->error("Invalid Configs");
       return responses::status_error(restbed::BAD_REQUEST,"Configurations are not compatible");
@@ -85,8 +89,73 @@ SessionResponse valid_test_config_json_handler(
   }
 }
 
+/**
+ * Parses the records array on the executor in chunks of ingest_chunk_size
+ * records. Every chunk writes into its own slice of the preallocated Records,
+ * the last finished chunk hands the job over to the remote's worker thread.
+ * The records are only held in memory, the 202 does not survive a restart.
+ */
+static void ingest_records(nlohmann::json&& records_json,
+    const shared_ptr<const LocalConfiguration>& local_config,
+    const shared_ptr<LinkageJob>& job,
+    const RemoteId& remote_id) {
+  struct IngestState {
+    nlohmann::json records_json;
+    Records records;
+    atomic<size_t> pending_chunks;
+    atomic<bool> failed{false};
+  };
+  auto logger{get_logger()};
+  const auto chunk_size{ConfigurationHandler::cget().get_server_config().ingest_chunk_size};
+  const auto num_records{records_json.size()};
+  const auto num_chunks{(num_records + chunk_size - 1) / chunk_size};
+  logger->debug("Ingesting {} records of job {} in {} chunks", num_records, job->get_id(), num_chunks);
+
+  auto state{make_shared<IngestState>()};
+  state->records_json = move(records_json);
+  state->records.resize(num_records);
+  state->pending_chunks = num_chunks;
+
+  auto finish = [state, local_config, job, remote_id]() {
+    auto logger{get_logger()};
+    if (state->failed) {
+      job->set_status(JobStatus::FAULT);
+      return;
+    }
+    logger->debug("Number of Client Records: {}", state->records.size());
+    job->add_data(make_unique<Records>(move(state->records)));
+    job->set_status(JobStatus::QUEUED);
+    ServerHandler::get().enqueue_linkage_job(remote_id, job);
+  };
+
+  if (!num_chunks) {
+    finish();
+    return;
+  }
+  auto& executor{Executor::get()};
+  for (size_t chunk = 0; chunk != num_chunks; ++chunk) {
+    executor.submit([state, local_config, job, finish, chunk, chunk_size, num_records]() {
+      const auto& fields{local_config->get_fields()};
+      const auto last{min((chunk + 1) * chunk_size, num_records)};
+      try {
+        for (auto i = chunk * chunk_size; i != last && !state->failed; ++i) {
+          state->records[i] = parse_json_fields(fields, state->records_json[i].at("fields"));
+        }
+      } catch (const exception& e) {
+        if (!state->failed.exchange(true)) {
+          get_logger()->error("Error in job {} record ingestion: {}", job->get_id(), e.what());
+        }
+      }
+      if (state->pending_chunks.fetch_sub(1) == 1) {
+        state->records_json = nullptr; // release the request body early
+        finish();
+      }
+    });
+  }
+}
+
 SessionResponse create_job(
-    const nlohmann::json& j,
+    nlohmann::json&& j,
     const RemoteId& remote_id,
     const string& authorization,
     bool multiple_records,
@@ -95,7 +164,9 @@ SessionResponse create_job(
   const auto& config_handler{ConfigurationHandler::cget()};
   auto& server_handler{ServerHandler::get()};
   try {
-    logger->trace("Link/MatchRecord Payload: {}", j.dump(2));
+    if (logger->should_log(spdlog::level::trace)) {
+      logger->trace("Link/MatchRecord Payload: {}", j.dump(2));
+    }
     JobId job_id;
     if (config_handler.get_remote_count()) {
       const auto local_config{config_handler.get_local_config()};
@@ -112,23 +183,45 @@ SessionResponse create_job(
         job->set_callback(j.at("callback")
             .at("url")
             .get<string>());
-
-        Records data;
-        if(!multiple_records) {
-          data.emplace_back(parse_json_fields(local_config->get_fields(), j.at("fields")));
-        } else {
-            for(auto& record : j.at("records")){
-                data.emplace_back(parse_json_fields(local_config->get_fields(), record.front()));
-            }
+        // Priority defaults to the endpoint's class
+        if (auto priority = j.find("priority"); priority != j.end()) {
+          job->set_priority(str_to_priority(priority->get<string>()));
+        } else if (counting_mode) {
+          job->set_priority(JobPriority::MATCHING);
+        } else if (multiple_records) {
+          job->set_priority(JobPriority::BATCH);
         }
-        logger->debug("Number of Client Records: {}", data.size());
-        job->add_data(make_unique<Records>(move(data)));
+
 #ifdef SEL_MATCHING_MODE
         if(counting_mode){
           job->set_counting_job();
         }
 #endif
-        server_handler.add_linkage_job(remote_id, job);
+        if(!multiple_records) {
+          Records data;
+          data.emplace_back(parse_json_fields(local_config->get_fields(), j.at("fields")));
+          job->add_data(make_unique<Records>(move(data)));
+          server_handler.add_linkage_job(remote_id, job);
+        } else {
+          // Large batches are decoded off the REST worker thread, the job is
+          // held until all records are parsed. Field names and types are
+          // checked right away, so malformed records are still answered
+          // with 400 instead of a faulty job.
+          if (j.at("records").empty()) {
+            throw invalid_argument("No records to link");
+          }
+          const auto& fields{local_config->get_fields()};
+          for (const auto& record : j.at("records")) {
+            check_json_fields(fields, record.at("fields"));
+          }
+          job->set_status(JobStatus::HOLD);
+          if (!counting_mode) {
+            // Large linkage jobs run in chunks to not block the queue
+            job->set_chunk_records(config_handler.get_server_config().job_chunk_records);
+          }
+          JobRegistry::get().add(job);
+          ingest_records(move(j.at("records")), local_config, job, remote_id);
+        }
       } catch (const exception& e) {
         logger->error("Error in job creation: {}", e.what());
         return responses::status_error(restbed::BAD_REQUEST,e.what());
@@ -147,33 +240,33 @@ SessionResponse create_job(
 }
 
 SessionResponse valid_linkrecord_json_handler(
-    const nlohmann::json& j,
+    nlohmann::json&& j,
     const RemoteId& remote_id,
     const string& authorization) {
-  return create_job(j, remote_id, authorization, false, false);
+  return create_job(move(j), remote_id, authorization, false, false);
 }
 
 SessionResponse valid_linkrecords_json_handler(
-    const nlohmann::json& j,
+    nlohmann::json&& j,
     const RemoteId& remote_id,
     const string& authorization) {
-  return create_job(j,remote_id,authorization, true, false);
+  return create_job(move(j),remote_id,authorization, true, false);
 }
 
 #ifdef SEL_MATCHING_MODE
 
 SessionResponse valid_matchrecord_json_handler(
-    const nlohmann::json& j,
+    nlohmann::json&& j,
     const RemoteId& remote_id,
     const string& authorization) {
-  return create_job(j, remote_id, authorization, false, true);
+  return create_job(move(j), remote_id, authorization, false, true);
 }
 
 SessionResponse valid_matchrecords_json_handler(
-    const nlohmann::json& j,
+    nlohmann::json&& j,
     const RemoteId& remote_id,
     const string& authorization) {
-  return create_job(j,remote_id,authorization, true, true);
+  return create_job(move(j),remote_id,authorization, true, true);
 }
 #endif
 
@@ -214,6 +307,10 @@ SessionResponse valid_init_remote_json_handler(
     if (j.count("linkageService")) {
       linkage_service.url = j.at("linkageService").at("url").get<string>();
       linkage_service.authenticator.set_auth_info(parse_json_auth_config(j.at("linkageService").at("authentication")));
+      if (j.at("linkageService").count("wireFormat")) {
+        linkage_service.wire_format = str_to_wire_format(
+            j.at("linkageService").at("wireFormat").get<string>());
+      }
       remote_config->set_linkage_service(move(linkage_service));
     } else {
       if (!matching_mode) {
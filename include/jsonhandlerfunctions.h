@@ -43,29 +43,29 @@ SessionResponse valid_init_remote_json_handler(
     const std::string&);
 
 SessionResponse valid_linkrecord_json_handler(
-    const nlohmann::json&,
+    nlohmann::json&&,
     const RemoteId&,
     const std::string&);
 
 SessionResponse valid_linkrecords_json_handler(
-    const nlohmann::json&,
+    nlohmann::json&&,
     const RemoteId&,
     const std::string&);
 
 #ifdef SEL_MATCHING_MODE
 SessionResponse valid_matchrecord_json_handler(
-    const nlohmann::json&,
+    nlohmann::json&&,
     const RemoteId&,
     const std::string&);
 
 SessionResponse valid_matchrecords_json_handler(
-    const nlohmann::json&,
+    nlohmann::json&&,
     const RemoteId&,
     const std::string&);
 #endif
 
 SessionResponse create_job(
-    const nlohmann::json&,
+    nlohmann::json&&,
     const RemoteId&,
     const std::string&,
     bool, bool);
@@ -23,6 +23,8 @@
 #include "resttypes.h"
 #include "restbed"
 #include "logger.h"
+#include "restresponses.hpp"
+#include "restutils.h"
 
 using namespace std;
 namespace sel {
@@ -60,6 +62,7 @@ void JsonMethodHandler::handle_method(
   RemoteId remote_id{request->get_path_parameter("remote_id", "")};
   string authorization{request->get_header("Authorization", "")};
   size_t content_length = request->get_header("Content-Length", 0);
+  const string content_type{request->get_header("Content-Type", "")};
   string header_string;
   for (const auto& h : headers) {
     header_string += h.first + " -- " + h.second + "\n";
@@ -77,9 +80,24 @@ void JsonMethodHandler::handle_method(
         content_length,
         [=](const shared_ptr<restbed::Session> session[[maybe_unused]],
             const restbed::Bytes& body) {
-          string bodystring = string(body.begin(), body.end());
-          nlohmann::json data = nlohmann::json::parse(bodystring);
-          use_data(session, data, remote_id, authorization);
+          nlohmann::json data;
+          WireFormat format;
+          try {
+            format = wire_format_of(content_type);
+          } catch (const exception& e) {
+            const auto response{responses::status_error(restbed::UNSUPPORTED_MEDIA_TYPE, e.what())};
+            session->close(response.return_code, response.body, response.headers);
+            return;
+          }
+          try {
+            // CBOR and MessagePack bodies may carry bloom filters as raw bytes
+            data = decode_body(body, format);
+          } catch (const nlohmann::json::exception& e) {
+            const auto response{responses::status_error(restbed::BAD_REQUEST, e.what())};
+            session->close(response.return_code, response.body, response.headers);
+            return;
+          }
+          use_data(session, move(data), remote_id, authorization);
         });
   } else {
     session->close(restbed::LENGTH_REQUIRED, "", {{"Connection", "Close"}});
@@ -87,16 +105,18 @@ void JsonMethodHandler::handle_method(
 }
 
 void JsonMethodHandler::use_data(const shared_ptr<restbed::Session>& session,
-                                 const nlohmann::json& bodydata,
+                                 nlohmann::json&& bodydata,
                                  const RemoteId& remote_id,
                                  const string& authorization) const {
   auto logger{get_logger()};
-  logger->trace("JSON recieved:\n{}", bodydata.dump(4));
+  if (logger->should_log(spdlog::level::trace)) { // don't dump large bodies needlessly
+    logger->trace("JSON recieved:\n{}", bodydata.dump(4));
+  }
   auto validation = m_validator->validate_json(bodydata);
   SessionResponse response;
   if (validation.first) {
     if (m_valid_callback) {
-      response = m_valid_callback(bodydata, remote_id, authorization);
+      response = m_valid_callback(move(bodydata), remote_id, authorization);
     } else {
       throw runtime_error("Invalid valid_callback!");
     }
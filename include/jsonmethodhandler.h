@@ -42,7 +42,7 @@ class JsonMethodHandler : public MethodHandler {
   JsonMethodHandler(
       const std::string& method,
       std::function<SessionResponse(
-                              const nlohmann::json&,
+                              nlohmann::json&&,
                               const std::string&,
                               const std::string&)> valid = nullptr,
       std::function<SessionResponse(valijson::ValidationResults&)> invalid = nullptr)
@@ -53,7 +53,7 @@ class JsonMethodHandler : public MethodHandler {
       const std::string& method,
       std::shared_ptr<Validator> validator,
       std::function<SessionResponse(
-                              const nlohmann::json&,
+                              nlohmann::json&&,
                               const std::string&,
                               const std::string&)> valid = nullptr,
       std::function<SessionResponse(valijson::ValidationResults&)> invalid = nullptr)
@@ -67,12 +67,12 @@ class JsonMethodHandler : public MethodHandler {
   void handle_continue(std::shared_ptr<restbed::Session>) const;
 
   void use_data(const std::shared_ptr<restbed::Session>&,
-                const nlohmann::json&,
+                nlohmann::json&&,
                 const RemoteId&,
                 const std::string&) const;
 
   void set_valid_callback(std::function<SessionResponse(
-                              const nlohmann::json&,
+                              nlohmann::json&&,
                               const std::string&,
                               const std::string&)> fun) {
     m_valid_callback = fun;
@@ -84,7 +84,7 @@ class JsonMethodHandler : public MethodHandler {
   }
 
  private:
-  std::function<SessionResponse(const nlohmann::json&,
+  std::function<SessionResponse(nlohmann::json&&,
                                 const std::string&,
                                 const std::string&)> m_valid_callback{nullptr};
 
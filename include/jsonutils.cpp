@@ -21,6 +21,7 @@
 #include "util.h"
 #include "base64.h"
 #include <fstream>
+#include <stdexcept>
 
 using namespace std;
 
@@ -94,6 +95,15 @@ FieldEntry parse_json_field(const FieldSpec& field,
         }
       }
       case FieldType::BITMASK: {
+        if (json.is_binary()) { // raw bytes from a binary wire format
+          const auto& bytes = json.get_binary();
+          if (bytes.empty()) {
+            return nullopt;
+          }
+          auto bloom = check_size_and_get_as_bitmask(bytes.data(), bytes.size(), field_bytes);
+          check_bitsize_and_clear_extra_bits(bloom, field.bitsize);
+          return bloom;
+        }
         const auto bloom_base64 = json.get<string>();
         if (!trim_copy(bloom_base64).empty()) {
           auto bloom = base64_decode(bloom_base64, field.bitsize);
@@ -123,6 +133,39 @@ Record parse_json_fields(
   return result;
 }
 
+void check_json_fields(
+    const map<FieldName, FieldSpec>& fields, const nlohmann::json& json) {
+  if (!json.is_object()) {
+    throw invalid_argument("Invalid JSON Data: 'fields' is not an object");
+  }
+  for (auto f = json.cbegin(); f != json.cend(); ++f) {
+    const auto spec = fields.find(f.key());
+    if (spec == fields.cend()) {
+      throw invalid_argument("Invalid JSON Data: unknown field '" + f.key() + "'");
+    }
+    if (f->is_null()) {
+      continue;
+    }
+    bool valid{false};
+    switch (spec->second.type) {
+      case FieldType::INTEGER:
+      case FieldType::NUMBER:
+        valid = f->is_number() || f->is_boolean();
+        break;
+      case FieldType::STRING:
+        valid = f->is_string();
+        break;
+      case FieldType::BITMASK:
+        valid = f->is_string() || f->is_binary();
+        break;
+    }
+    if (!valid) {
+      throw invalid_argument("Invalid JSON Data: field '" + f.key() + "' has type "
+          + f->type_name());
+    }
+  }
+}
+
 VRecord parse_json_fields_array(
     const map<FieldName, FieldSpec>& fields, const nlohmann::json& json) {
   VRecord records;
@@ -30,6 +30,9 @@ namespace sel {
 FieldEntry parse_json_field(const FieldSpec&, const nlohmann::json&);
 Record parse_json_fields(const std::map<FieldName, FieldSpec>&,
                          const nlohmann::json&);
+// Throws if parse_json_fields would fail on unknown fields or wrong JSON types
+void check_json_fields(const std::map<FieldName, FieldSpec>&,
+                       const nlohmann::json&);
 VRecord parse_json_fields_array(const std::map<FieldName, FieldSpec>& fields,
                                 const nlohmann::json& json);
 std::vector<std::string> parse_json_id_array(const nlohmann::json& json);
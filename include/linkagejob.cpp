@@ -28,7 +28,14 @@ later version. This program is distributed in the hope that it will be useful,
 #include "apikeyconfig.hpp"
 #include "authenticationconfig.hpp"
 #include "remoteconfiguration.h"
+#include "resourcescheduler.h"
+#include "deliveryqueue.h"
+#include "metrics.h"
+#include "tracer.h"
+#include "configurationhandler.h"
 #include "fmt/format.h"
+#include "corvusoft/restbed/status_code.hpp"
+#include <chrono>
 #include <exception>
 #include <map>
 #include <string>
@@ -36,15 +43,171 @@ later version. This program is distributed in the hope that it will be useful,
 #include <vector>
 #include <optional>
 #include <future>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <unistd.h>
 
 using namespace std;
 namespace sel {
 
-LinkageJob::LinkageJob() : m_id(generate_id()) {}
+/**
+ * Accumulated over all runs of a job. Shared with the job's deliveries, which
+ * may finish after the job itself.
+ */
+class JobTimings {
+  public:
+    using Clock = chrono::steady_clock;
+    enum class Stage { QUEUE_WAIT, INIT_MPC, CIRCUIT_BUILD, SETUP, ONLINE, DELIVERY, CALLBACK };
+
+    void queued() {
+      lock_guard<mutex> lock(m_mutex);
+      m_queued_since = Clock::now();
+    }
+
+    void dequeued() {
+      lock_guard<mutex> lock(m_mutex);
+      if (m_queued_since) {
+        add_locked(Stage::QUEUE_WAIT, Clock::now() - *m_queued_since);
+        m_queued_since.reset();
+      }
+      if (!m_started) {
+        m_started = chrono::system_clock::now();
+      }
+    }
+
+    void finished() {
+      lock_guard<mutex> lock(m_mutex);
+      m_finished = chrono::system_clock::now();
+    }
+
+    void add(Stage stage, Clock::duration duration) {
+      lock_guard<mutex> lock(m_mutex);
+      add_locked(stage, duration);
+    }
+
+    // Returns when the delivery finished
+    Clock::time_point delivered(Stage stage, Clock::time_point queued) {
+      const auto now{Clock::now()};
+      lock_guard<mutex> lock(m_mutex);
+      add_locked(stage, now - queued);
+      return now;
+    }
+
+    // The callback is forwarded once its result delivery succeeded
+    void forwarded(Clock::time_point delivered_at) {
+      lock_guard<mutex> lock(m_mutex);
+      add_locked(Stage::CALLBACK, Clock::now() - delivered_at);
+    }
+
+    void add_run(const SecureEpilinker::RunStats& stats, long rss_growth) {
+      lock_guard<mutex> lock(m_mutex);
+      m_stage_ms[Stage::CIRCUIT_BUILD] += stats.circuit_build_ms;
+      m_stage_ms[Stage::SETUP] += stats.setup_ms;
+      m_stage_ms[Stage::ONLINE] += stats.online_ms;
+      ++m_runs;
+      m_gates += stats.gates;
+      m_depth += stats.depth;
+      m_bytes_sent += stats.setup_sent + stats.online_sent;
+      m_bytes_received += stats.setup_received + stats.online_received;
+      m_rss_growth = max(m_rss_growth, rss_growth);
+    }
+
+    nlohmann::json to_json() const {
+      const auto epoch_ms = [](const optional<chrono::system_clock::time_point>& t) {
+        return t ? nlohmann::json(chrono::duration_cast<chrono::milliseconds>(
+              t->time_since_epoch()).count()) : nlohmann::json();
+      };
+      lock_guard<mutex> lock(m_mutex);
+      nlohmann::json stages = nlohmann::json::object();
+      for (const auto& [stage, ms] : m_stage_ms) {
+        stages[stage_name(stage)] = ms;
+      }
+      return {{"submitted", epoch_ms(m_submitted)},
+              {"started", epoch_ms(m_started)},
+              {"finished", epoch_ms(m_finished)},
+              {"stagesMs", stages},
+              {"runs", m_runs},
+              {"gates", m_gates},
+              {"depth", m_depth},
+              {"bytesSent", m_bytes_sent},
+              {"bytesReceived", m_bytes_received},
+              {"rssGrowthKiB", m_rss_growth}};
+    }
+
+  private:
+    static string stage_name(Stage stage) {
+      switch (stage) {
+        case Stage::QUEUE_WAIT: return "queueWait";
+        case Stage::INIT_MPC: return "initMPC";
+        case Stage::CIRCUIT_BUILD: return "circuitBuild";
+        case Stage::SETUP: return "setup";
+        case Stage::ONLINE: return "online";
+        case Stage::DELIVERY: return "delivery";
+        case Stage::CALLBACK: return "callback";
+      }
+      return "unknown";
+    }
+
+    // Needs m_mutex
+    void add_locked(Stage stage, Clock::duration duration) {
+      m_stage_ms[stage] += chrono::duration<double, milli>(duration).count();
+    }
+
+    mutable mutex m_mutex;
+    const chrono::system_clock::time_point m_submitted{chrono::system_clock::now()};
+    optional<chrono::system_clock::time_point> m_started;
+    optional<chrono::system_clock::time_point> m_finished;
+    optional<Clock::time_point> m_queued_since{Clock::now()};
+    map<Stage, double> m_stage_ms;
+    size_t m_runs{0};
+    uint64_t m_gates{0};
+    // Summed over runs. With GMW sharing the online phase takes one round per
+    // layer of AND gates, so this is the number of rounds, Yao runs take a
+    // constant number of rounds instead.
+    uint64_t m_depth{0};
+    uint64_t m_bytes_sent{0};
+    uint64_t m_bytes_received{0};
+    // Largest growth of the process' RSS during one of the job's runs in KiB.
+    // Concurrent runs of other jobs grow it as well.
+    long m_rss_growth{0};
+};
+
+namespace {
+using Stage = JobTimings::Stage;
+
+// Current resident set size of the process in KiB
+long current_rss() {
+  ifstream statm{"/proc/self/statm"};
+  long size{0}, resident{0};
+  statm >> size >> resident;
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+} // namespace
+
+// The run was sized against a wrong database size of the remote
+struct RunTooLargeError : runtime_error {
+  explicit RunTooLargeError(size_t size)
+    : runtime_error("Run exceeds the remote's memory budget"), database_size{size} {}
+  size_t database_size;
+};
+
+// The remote can not admit another MPC run right now
+struct RemoteBusyError : runtime_error {
+  explicit RemoteBusyError(chrono::seconds retry)
+    : runtime_error("Remote Secure EpiLinker busy"), retry_after{retry} {}
+  chrono::seconds retry_after;
+};
+
+LinkageJob::LinkageJob() : m_id(generate_id()), m_timings(make_shared<JobTimings>()) {}
 
 LinkageJob::LinkageJob(shared_ptr<const LocalConfiguration> l_conf,
                        shared_ptr<const RemoteConfiguration> r_conf)
     : m_id(generate_id()),
+      m_timings(make_shared<JobTimings>()),
       m_local_config(move(l_conf)),
       m_remote_config(move(r_conf)) {}
 
@@ -56,12 +219,62 @@ void LinkageJob::add_data(unique_ptr<Records> data) {
   m_records = move(data);
 }
 
+size_t LinkageJob::get_num_records() const {
+  if (!m_records) {
+    return 0;
+  }
+  const auto remaining{m_records->size() - m_next_record};
+  return m_chunk_records ? min(remaining, m_chunk_records) : remaining;
+}
+
+void LinkageJob::set_chunk_records(size_t chunk_records) {
+  m_chunk_records = chunk_records;
+}
+
+JobPriority LinkageJob::get_priority() const {
+  return m_priority;
+}
+
+void LinkageJob::set_priority(JobPriority priority) {
+  m_priority = priority;
+}
+
+chrono::steady_clock::time_point LinkageJob::get_not_before() const {
+  return m_not_before;
+}
+
 JobStatus LinkageJob::get_status() const {
   return m_status;
 }
 
 void LinkageJob::set_status(JobStatus status){
+  if (status == JobStatus::DONE || status == JobStatus::FAULT) {
+    m_finish_time = chrono::steady_clock::now().time_since_epoch().count();
+    m_timings->finished();
+  } else if (status == JobStatus::QUEUED) {
+    m_timings->queued();
+  }
   m_status = status;
+  if (m_status_listener) {
+    m_status_listener(m_id, status);
+  }
+}
+
+bool LinkageJob::is_finished() const {
+  const auto status{get_status()};
+  return status == JobStatus::DONE || status == JobStatus::FAULT;
+}
+
+chrono::steady_clock::time_point LinkageJob::get_finish_time() const {
+  return chrono::steady_clock::time_point{chrono::steady_clock::duration{m_finish_time}};
+}
+
+void LinkageJob::set_status_listener(StatusListener listener) {
+  m_status_listener = move(listener);
+}
+
+nlohmann::json LinkageJob::get_timings() const {
+  return m_timings->to_json();
 }
 
 JobId LinkageJob::get_id() const {
@@ -72,74 +285,256 @@ RemoteId LinkageJob::get_remote_id() const {
   return m_remote_config->get_id();
 }
 
-LinkageJob::JobPreparation LinkageJob::prepare_run() {
-  m_status = JobStatus::RUNNING;
-  // Get number of records from server
+LinkageJob::JobPreparation LinkageJob::prepare_run(Port aby_port) {
+  set_status(JobStatus::RUNNING);
+  // Get number of records from server. The server only replies once its
+  // party is ready for this job.
   size_t num_records{m_records->size()};
-  //this future trickery has to be done to properly wait for a reply
-  auto nvals{std::async(&LinkageJob::get_server_nvals, this, num_records)};
-  nvals.wait_for(15s);
-  if(!nvals.valid()){
-    throw runtime_error("Error retrieving number of records from server");
-  }
-  const auto database_size{nvals.get()};
-  return {num_records, database_size, ServerHandler::get().get_epilink_client(m_remote_config->get_id())};
+  m_timings->dequeued();
+  const auto handshake_start{JobTimings::Clock::now()};
+  const auto database_size{get_server_nvals(num_records, aby_port,
+        {{num_records, m_id}}).database_size};
+  m_timings->add(Stage::INIT_MPC, JobTimings::Clock::now() - handshake_start);
+  return {num_records, database_size};
 }
 
 
-void LinkageJob::run_linkage_job() {
+/**
+ * Runs the next chunk of one or several coalesced linkage jobs of the same
+ * remote as a single MPC run. The records of all jobs are concatenated and the
+ * server is told the partition, so both sides can hand every job its own share
+ * of the result in the same order. Shares of chunked jobs are accumulated
+ * until their last chunk has run, or streamed per chunk if both sides agreed
+ * to in initMPC. The run is cut to the records that fit the memory budget
+ * against the remote's database. Returns the jobs with chunks left to run.
+ */
+vector<shared_ptr<LinkageJob>> LinkageJob::run_linkage_jobs(
+    const vector<shared_ptr<LinkageJob>>& jobs, SecureEpilinker& epilinker, Port aby_port) {
   auto logger{get_logger(ComponentLogger::CLIENT)};
-  logger->info("Linkage job {} started\n", m_id);
+  auto& lead_job{*jobs.front()};
+  // Coalesced jobs are traced under the lead job's id
+  const TraceScope trace_scope{lead_job.m_id};
+  const TraceSpan span{"client linkage run"};
+  auto& scheduler{ResourceScheduler::get()};
+  const auto& circuit_config{epilinker.get_circuit_config()};
+  // Until the remote's database size is known, runs are sized against
+  // databaseSizeHint, or limited to one record without a hint
+  const auto known_database_size{scheduler.get_database_size(lead_job.get_remote_id())};
+  const auto max_records{known_database_size
+    ? scheduler.max_run_records(circuit_config, known_database_size) : 1};
+  if (!max_records) {
+    logger->error("Linking a single record against {} database records exceeds "
+        "the memory budget", known_database_size);
+    for (const auto& job : jobs) {
+      job->m_records.reset();
+      job->m_linkage_share.clear();
+      job->set_status(JobStatus::FAULT);
+    }
+    return {};
+  }
+
+  vector<shared_ptr<LinkageJob>> run_jobs, unfinished_jobs;
+  vector<RecordPart> partition;
+  partition.reserve(jobs.size());
+  size_t num_records{0};
+  for (const auto& job : jobs) {
+    const auto chunk_size{min(job->get_num_records(), max_records - num_records)};
+    if (!chunk_size && job->get_num_records()) {
+      unfinished_jobs.emplace_back(job); // does not fit into this run
+      continue;
+    }
+    partition.push_back({chunk_size, job->m_id,
+                         job->m_next_record + chunk_size != job->m_records->size()});
+    run_jobs.emplace_back(job);
+    num_records += chunk_size;
+  }
   try {
-    auto [num_records, database_size, epilinker] = prepare_run();
+    // Jobs stay queued until the run is admitted, the remote only starts its
+    // server party afterwards
+    const auto reservation{scheduler.acquire(scheduler.estimate_run(circuit_config,
+          num_records, known_database_size))};
+    for (const auto& job : run_jobs) {
+      job->m_timings->dequeued();
+    }
+    const auto handshake_start{JobTimings::Clock::now()};
+    const auto server_run{lead_job.get_server_nvals(num_records, aby_port, partition)};
+    const auto database_size{server_run.database_size};
+    for (const auto& job : run_jobs) {
+      job->m_timings->add(Stage::INIT_MPC, JobTimings::Clock::now() - handshake_start);
+    }
+    scheduler.set_database_size(lead_job.get_remote_id(), database_size);
+
+    auto records{make_unique<Records>()};
+    records->reserve(num_records);
+    for (size_t i = 0; i != run_jobs.size(); ++i) {
+      const auto& job{run_jobs[i]};
+      const auto chunk_size{partition[i].num_records};
+      const auto chunk_begin{job->m_records->begin() + job->m_next_record};
+      if (!job->m_next_record) {
+        logger->info("Linkage job {} started\n", job->m_id);
+      }
+      job->set_status(JobStatus::RUNNING);
+      job->m_next_record += chunk_size;
+      move(chunk_begin, chunk_begin + chunk_size, back_inserter(*records));
+    }
+    if (run_jobs.size() > 1) {
+      logger->info("Running {} coalesced jobs with {} records", run_jobs.size(), num_records);
+    }
     logger->debug("Client has {} Records\n", num_records);
     logger->debug("Server has {} Records\n", database_size);
-    epilinker->build_linkage_circuit(num_records, database_size);
-    epilinker->run_setup_phase();
+    const auto rss_before{current_rss()};
+    epilinker.build_linkage_circuit(num_records, database_size);
+    epilinker.run_setup_phase();
 #ifdef DEBUG_SEL_REST
-      print_data();
-      auto input_copy{*m_records};
+      swap(lead_job.m_records, records);
+      lead_job.print_data();
+      swap(lead_job.m_records, records);
+      auto input_copy{*records};
 #endif
-    epilinker->set_client_input({move(m_records), database_size});
-    auto linkage_share{epilinker->run_linkage()};
+    epilinker.set_client_input({move(records), database_size});
+    auto linkage_share{epilinker.run_linkage()};
+    const auto rss_growth{current_rss() - rss_before};
+    const auto& run_stats{epilinker.get_run_stats()};
+    record_run_stats(run_stats,
+        {{"remote", lead_job.get_remote_id()}, {"role", "client"}, {"job_type", "linkage"}});
+    for (const auto& job : run_jobs) {
+      job->m_timings->add_run(run_stats, rss_growth);
+    }
       // reset epilinker for the next linkage
-      epilinker->reset();
+      epilinker.reset();
       logger->info("Client Result: {}", linkage_share);
 #ifdef DEBUG_SEL_REST
-      compute_debugging_result(input_copy);
+      lead_job.compute_debugging_result(input_copy);
 #endif
-      try{
-        auto response{send_result_to_linkageservice(linkage_share, nullopt , "client", m_local_config, m_remote_config)};
-        if (response.return_code == 200) {
-          perform_callback(response.body);
-        }
-      } catch (const exception& e) {
-        get_logger(ComponentLogger::REST)->error("Can not connect to linkage service or callback: {}", e.what());
+    const bool stream{server_run.stream_results};
+    auto share_begin{linkage_share.cbegin()};
+    for (size_t i = 0; i != run_jobs.size(); ++i) {
+      auto& job{*run_jobs[i]};
+      const auto share_end{share_begin + partition[i].num_records};
+      if (stream) {
+        job.deliver_linkage_result({share_begin, share_end},
+            ResultChunk{job.m_id, job.m_next_record - partition[i].num_records,
+                        !partition[i].continued});
+      } else {
+        job.m_linkage_share.insert(job.m_linkage_share.end(), share_begin, share_end);
+      }
+      share_begin = share_end;
+      if (partition[i].continued) {
+        logger->debug("Linkage job {}: {} of {} records linked", job.m_id,
+            job.m_next_record, job.m_records->size());
+        job.set_status(JobStatus::QUEUED);
+        unfinished_jobs.emplace_back(run_jobs[i]);
+        continue;
       }
-    m_status = JobStatus::DONE;
+      job.m_records.reset();
+      if (!stream) {
+        job.deliver_linkage_result(job.m_linkage_share);
+        job.m_linkage_share.clear();
+      }
+      job.set_status(JobStatus::DONE);
+    }
+    return unfinished_jobs;
+  } catch (const RunTooLargeError& e) {
+    // Nothing ran yet, so the jobs can be resized against the actual database
+    scheduler.set_database_size(lead_job.get_remote_id(), e.database_size);
+    if (e.database_size != known_database_size) {
+      logger->info("Remote has {} instead of {} database records, resizing {} jobs",
+          e.database_size, known_database_size, jobs.size());
+      for (const auto& job : run_jobs) {
+        job->m_timings->queued();
+      }
+      return jobs;
+    }
+    logger->error("Error running MPC Client: {}\n", e.what());
+    for (const auto& job : run_jobs) {
+      job->m_records.reset();
+      job->m_linkage_share.clear();
+      job->set_status(JobStatus::FAULT);
+    }
+  } catch (const RemoteBusyError& e) {
+    logger->info("Remote busy, retrying {} jobs in {}s", jobs.size(), e.retry_after.count());
+    for (const auto& job : run_jobs) {
+      job->m_timings->queued();
+    }
+    // The slot serves other jobs meanwhile instead of sleeping
+    const auto retry{chrono::steady_clock::now() + e.retry_after};
+    for (const auto& job : jobs) {
+      job->m_not_before = retry;
+    }
+    return jobs;
   } catch (const exception& e) {
     logger->error("Error running MPC Client: {}\n", e.what());
-    m_status = JobStatus::FAULT;
+    for (const auto& job : run_jobs) {
+      job->m_records.reset();
+      job->m_linkage_share.clear();
+      job->set_status(JobStatus::FAULT);
+    }
   }
+  return unfinished_jobs;
 }
 
-void LinkageJob::run_matching_job() {
+/**
+ * Queued, so a slow linkage service or callback does not stall the next run.
+ * Of streamed results, only the reply to the complete chunk is passed on to
+ * the callback.
+ */
+void LinkageJob::deliver_linkage_result(const vector<Result<CircUnit>>& linkage_share,
+    const optional<ResultChunk>& chunk) const {
+  try{
+    auto delivery{linkage_result_delivery(linkage_share, nullopt , "client", m_local_config, m_remote_config, chunk)};
+    // Chunks are delivered in parallel, so each forwarding is timed from its
+    // own delivery
+    auto delivered_at{make_shared<atomic<JobTimings::Clock::time_point>>(
+        JobTimings::Clock::now())};
+    delivery.on_finished = [timings = m_timings, queued = JobTimings::Clock::now(),
+                            delivered_at](bool delivered){
+      if (delivered) delivered_at->store(timings->delivered(Stage::DELIVERY, queued));
+    };
+    if (!chunk || chunk->complete) {
+      delivery.forward_url = m_callback;
+      delivery.forward_headers = callback_headers();
+      delivery.on_forward_finished = [timings = m_timings, delivered_at](bool delivered){
+        if (delivered) timings->forwarded(delivered_at->load());
+      };
+    }
+    delivery.description = chunk
+      ? fmt::format("client result of job {} from record {}", m_id, chunk->offset)
+      : "client result of job " + m_id;
+    DeliveryQueue::get().push(move(delivery));
+  } catch (const exception& e) {
+    get_logger(ComponentLogger::REST)->error("Can not deliver result of job {}: {}", m_id, e.what());
+  }
+}
+
+void LinkageJob::run_matching_job(SecureEpilinker& epilinker, Port aby_port) {
   auto logger{get_logger(ComponentLogger::CLIENT)};
 #ifdef SEL_MATCHING_MODE
+  const TraceScope trace_scope{m_id};
+  const TraceSpan span{"client matching run"};
   logger->warn("A matching job is starting.");
+  auto& scheduler{ResourceScheduler::get()};
   try {
-    auto [num_records, database_size, epilinker] = prepare_run();
+    const auto reservation{scheduler.acquire(scheduler.estimate_run(
+          epilinker.get_circuit_config(), m_records->size(),
+          scheduler.get_database_size(get_remote_id())))};
+    auto [num_records, database_size] = prepare_run(aby_port);
+    scheduler.set_database_size(get_remote_id(), database_size);
     logger->debug("Client has {} Records\n", num_records);
     logger->debug("Server has {} Records\n", database_size);
-    epilinker->build_count_circuit(num_records, database_size);
-    epilinker->run_setup_phase();
+    const auto rss_before{current_rss()};
+    epilinker.build_count_circuit(num_records, database_size);
+    epilinker.run_setup_phase();
 #ifdef DEBUG_SEL_REST
       print_data();
 #endif
-    epilinker->set_input({move(m_records), database_size});
-    auto count_result{epilinker->run_count()};
+    epilinker.set_input({move(m_records), database_size});
+    auto count_result{epilinker.run_count()};
+    const auto rss_growth{current_rss() - rss_before};
+    record_run_stats(epilinker.get_run_stats(),
+        {{"remote", get_remote_id()}, {"role", "client"}, {"job_type", "matching"}});
+    m_timings->add_run(epilinker.get_run_stats(), rss_growth);
       // reset epilinker for the next operation
-      epilinker->reset();
+      epilinker.reset();
       // The strange assembly of the json is due to strange object/array
       // distinctions in nlohmann/json
       nlohmann::json match_json;
@@ -148,16 +543,24 @@ void LinkageJob::run_matching_job() {
       match_result["tentativeMatches"] = count_result.tmatches;
       match_json["result"] = match_result;
       logger->trace("Result to callback: {}", match_json.dump(0));
-      perform_callback(match_json.dump());
-    m_status = JobStatus::DONE;
+      DeliveryQueue::get().push({m_callback, match_json.dump(), callback_headers(),
+                                 "", {}, "matching result of job " + m_id,
+                                 [timings = m_timings, queued = JobTimings::Clock::now()](bool delivered){
+                                   if (delivered) timings->delivered(Stage::CALLBACK, queued);
+                                 }, nullptr});
+    set_status(JobStatus::DONE);
+  } catch (const RemoteBusyError& e) {
+    logger->info("Remote busy, retrying matching job in {}s", e.retry_after.count());
+    m_not_before = chrono::steady_clock::now() + e.retry_after;
+    set_status(JobStatus::QUEUED);
   } catch (const exception& e) {
     logger->error("Error running MPC Client: {}\n", e.what());
-    m_status = JobStatus::FAULT;
+    set_status(JobStatus::FAULT);
   }
 #endif
 #ifndef SEL_MATCHING_MODE
   logger->error("Matching mode not allowed");
-  m_status = JobStatus::FAULT;
+  set_status(JobStatus::FAULT);
 #endif
 }
 
@@ -169,41 +572,74 @@ void LinkageJob::set_local_config(shared_ptr<LocalConfiguration> l_config) {
  * Send server the configuration to compare and recieve back the number of
  * records in the database
  */
-size_t LinkageJob::get_server_nvals(size_t num_records) {
+LinkageJob::ServerRun LinkageJob::get_server_nvals(size_t num_records, Port aby_port,
+                                    const vector<RecordPart>& partition) {
   auto logger{get_logger(ComponentLogger::CLIENT)};
-  //FIXME(TK): THIS IS BAD AND I SHOULD FEEL BAD
-  std::this_thread::sleep_for(500ms);
+  if (!num_records) {
+    throw runtime_error("Can not start an MPC run without records");
+  }
+  const TraceSpan span{"initMPC request", "rest"};
+  string record_partition, job_ids, continued_jobs;
+  for (const auto& part : partition) {
+    record_partition += (record_partition.empty() ? "" : ",") + to_string(part.num_records);
+    job_ids += (job_ids.empty() ? "" : ",") + part.job_id;
+    if (part.continued) {
+      continued_jobs += (continued_jobs.empty() ? "" : ",") + part.job_id;
+    }
+  }
   list<string> headers{
       "Authorization: "s+m_remote_config->get_remote_authenticator().sign_transaction(""),
       "Record-Number: "s + to_string(num_records),
+      "Record-Partition: "s + record_partition,
+      "Job-Ids: "s + job_ids,
+      "Continued-Jobs: "s + continued_jobs,
       "Counting-Mode: "s + (m_counting_job ? "true" : "false"),
+      "Stream-Results: "s + (!m_counting_job
+          && ConfigurationHandler::cget().get_server_config().stream_results ? "true" : "false"),
+      "SEL-Port: "s + to_string(aby_port),
       "Content-Type: application/json"};
+  if (Tracer::get().enabled()) {
+    headers.emplace_back("SEL-Trace-Id: "s + Tracer::current_trace_id());
+  }
   string url{assemble_remote_url(m_remote_config) + "/initMPC/"+m_local_config->get_local_id()};
   logger->debug("Sending {} request to {}\n",(m_counting_job ? "matching" : "linkage"), url);
-  try{
-    // TODO(TK): Refactor perform_post_request w/ optional to avoid dummy data
-    auto response{perform_post_request(url, "{}", headers, true)};
-    logger->debug("Response stream:\n{} - {}\n",response.return_code, response.body);
-    // get nvals from response header
-    if (response.return_code == 200) {
-      return stoull(get_headers(response.body, "Record-Number").front());
-    } else {
-      logger->error("Error communicating with remote epilinker: {} - {}", response.return_code, response.body);
+  // TODO(TK): Refactor perform_post_request w/ optional to avoid dummy data
+  auto response{perform_post_request(url, "{}", headers)};
+  logger->debug("Response stream:\n{} - {}\n",response.return_code, response.body);
+  if (response.return_code == restbed::SERVICE_UNAVAILABLE) {
+    const auto retry_after{get_headers(response, "Retry-After")};
+    const auto seconds{retry_after.empty() ? nullopt : parse_header_number(retry_after.front())};
+    // Dates or absurd delays fall back to a short retry
+    throw RemoteBusyError(chrono::seconds{seconds && *seconds <= 600 ? *seconds : 1});
+  }
+  if (response.return_code == restbed::REQUEST_ENTITY_TOO_LARGE) {
+    if (const auto nvals{get_headers(response, "Record-Number")}; !nvals.empty()) {
+      if (const auto max_records{parse_header_number(nvals.front())}) {
+        throw RunTooLargeError(*max_records);
+      }
     }
-  } catch (const exception& e) {
-    logger->error("Error performing initMPC call: {}", e.what());
   }
+  if (response.return_code != 200) {
+    throw runtime_error("Error communicating with remote epilinker: "
+        + to_string(response.return_code) + " - " + response.body);
+  }
+  // get nvals from response header
+  const auto nvals{get_headers(response, "Record-Number")};
+  const auto database_size{nvals.empty() ? nullopt : parse_header_number(nvals.front())};
+  if (!database_size) {
+    throw runtime_error("No valid server record number in initMPC response");
+  }
+  if (!*database_size) {
+    throw runtime_error("Remote database is empty");
+  }
+  // Remotes not knowing streamed results don't answer it
+  const auto stream{get_headers(response, "Stream-Results")};
+  return {*database_size, !stream.empty() && stream.front() == "true"};
 }
 
-bool LinkageJob::perform_callback(const string& body) const {
-  auto logger{get_logger(ComponentLogger::CLIENT)};
-  list<string> headers{
-      "Authorization: "s + m_local_config->get_local_authenticator().sign_transaction(""),
-      "Content-Type: application/json"};
-  logger->debug("Sending callback to: {}\n", m_callback);
-  auto response{perform_post_request(m_callback, body, headers, true)};
-  logger->trace("Callback response:\n{} - {}\n", response.return_code, response.body);
-  return response.return_code == 200;
+list<string> LinkageJob::callback_headers() const {
+  return {"Authorization: "s + m_local_config->get_local_authenticator().sign_transaction(""),
+          "Content-Type: application/json"};
 }
 
 
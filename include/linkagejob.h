@@ -25,12 +25,20 @@
 #include "resttypes.h"
 #include "resourcehandler.h"
 #include "methodhandler.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <list>
 #include <memory>
+#include <optional>
 #include <string>
 #include <variant>
 #include <vector>
 #include <map>
 #include "epilink_input.h"
+#include "epilink_result.hpp"
+#include "circuit_config.h"
+#include "nlohmann/json.hpp"
 
 namespace restbed {
 class Service;
@@ -42,38 +50,73 @@ class LocalConfiguration;
 class RemoteConfiguration;
 class ServerHandler;
 class SecureEpilinker;
+class JobTimings;
 
 class LinkageJob {
   struct JobPreparation {
     size_t num_records;
     size_t database_size;
-    std::shared_ptr<SecureEpilinker> epilinker;
+  };
+  // Reply of the remote to initMPC
+  struct ServerRun {
+    size_t database_size;
+    bool stream_results;
   };
  public:
+   using StatusListener = std::function<void (const JobId&, JobStatus)>;
    LinkageJob();
    LinkageJob(std::shared_ptr<const LocalConfiguration>, std::shared_ptr<const RemoteConfiguration>);
    void set_callback(std::string&& cc);
    void add_data(std::unique_ptr<Records>);
    JobStatus get_status() const;
    void set_status(JobStatus);
-   bool is_counting_job() {return m_counting_job;}
+   // Whether the job is DONE or FAULT, and since when
+   bool is_finished() const;
+   std::chrono::steady_clock::time_point get_finish_time() const;
+   // Informed about every status change, set before the job is shared
+   void set_status_listener(StatusListener);
+   /**
+    * Stage durations and resource usage of the job's runs and deliveries.
+    * Coalesced jobs share the counters of their common runs.
+    */
+   nlohmann::json get_timings() const;
+   bool is_counting_job() const {return m_counting_job;}
    void set_counting_job() {m_counting_job = true;}
    JobId get_id() const;
    RemoteId get_remote_id() const;
-   void run_linkage_job();
-   void run_matching_job();
+   // Number of records of the next run, at most one chunk
+   size_t get_num_records() const;
+   // Splits the job into runs of at most this many records, 0 for one run
+   void set_chunk_records(size_t);
+   JobPriority get_priority() const;
+   void set_priority(JobPriority);
+   // Jobs rejected by a busy remote are not run again before this time
+   std::chrono::steady_clock::time_point get_not_before() const;
+   static std::vector<std::shared_ptr<LinkageJob>> run_linkage_jobs(
+       const std::vector<std::shared_ptr<LinkageJob>>&, SecureEpilinker&, Port);
+   void run_matching_job(SecureEpilinker&, Port);
    void set_local_config(std::shared_ptr<LocalConfiguration>);
  private:
-  JobPreparation prepare_run();
-  size_t get_server_nvals(size_t);
-  bool perform_callback(const std::string&) const;
+  JobPreparation prepare_run(Port);
+  ServerRun get_server_nvals(size_t, Port, const std::vector<RecordPart>&);
+  void deliver_linkage_result(const std::vector<Result<CircUnit>>&,
+                              const std::optional<ResultChunk>& = std::nullopt) const;
+  std::list<std::string> callback_headers() const;
 #ifdef DEBUG_SEL_REST
   void compute_debugging_result(const Records&);
   void print_data() const;
 #endif
   JobId m_id;
-  JobStatus m_status{JobStatus::QUEUED};
+  std::atomic<JobStatus> m_status{JobStatus::QUEUED};
+  std::atomic<std::chrono::steady_clock::rep> m_finish_time{0};
+  StatusListener m_status_listener;
+  std::shared_ptr<JobTimings> m_timings;
     std::unique_ptr<Records> m_records;
+  size_t m_next_record{0};
+  size_t m_chunk_records{0};
+  std::chrono::steady_clock::time_point m_not_before{};
+  std::vector<Result<CircUnit>> m_linkage_share;
+  JobPriority m_priority{JobPriority::INTERACTIVE};
   std::string m_callback;
   std::shared_ptr<const LocalConfiguration> m_local_config;
   std::shared_ptr<const RemoteConfiguration> m_remote_config;
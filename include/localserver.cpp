@@ -29,6 +29,10 @@
 #include "util.h"
 #include "restutils.h"
 #include "logger.h"
+#include "serverhandler.h"
+#include "deliveryqueue.h"
+#include "metrics.h"
+#include "tracer.h"
 
 using namespace std;
 namespace sel {
@@ -58,48 +62,78 @@ RemoteId LocalServer::get_id() const {
   return m_remote_id;
 }
 
-void LocalServer::run_linkage(shared_ptr<const ServerData> data, size_t num_records) {
-  m_data = move(data);
+void LocalServer::run_linkage(shared_ptr<const ServerData> data, size_t num_records,
+                              const vector<RecordPart>& partition, bool stream_results,
+                              ServerReadiness& readiness) {
   auto logger{get_logger(ComponentLogger::SERVER)};
-  logger->info("The linkage server is running");
-  const size_t database_size{m_data->data->begin()->second.size()};
+  const TraceSpan span{"server linkage run"};
+  vector<Result<CircUnit>> linkage_result;
+  {
+    // Waits for the reset of a previous run still in progress
+    lock_guard<mutex> lock(m_run_mutex);
+    m_data = move(data);
+    logger->info("The linkage server is running");
+    const size_t database_size{m_data->data->begin()->second.size()};
 #ifdef DEBUG_SEL_REST
-  DataHandler::get().get_epilink_debug()->server_input = *(m_data->data);
+    DataHandler::get().get_epilink_debug()->server_input = *(m_data->data);
 #endif
-  m_aby_server.build_linkage_circuit(num_records, database_size);
-  m_aby_server.run_setup_phase();
-  m_aby_server.set_server_input({m_data->data, num_records});
-  auto linkage_result = m_aby_server.run_linkage();
-  m_aby_server.reset();
+    m_aby_server.build_linkage_circuit(num_records, database_size);
+    m_aby_server.run_setup_phase();
+    m_aby_server.set_server_input({m_data->data, num_records});
+    if (!readiness.signal_ready()) {
+      logger->warn("Client stopped waiting for linkage server, skipping run");
+      m_aby_server.reset();
+      return;
+    }
+    linkage_result = m_aby_server.run_linkage();
+    record_run_stats(m_aby_server.get_run_stats(),
+        {{"remote", m_remote_id}, {"role", "server"}, {"job_type", "linkage"}});
+    m_aby_server.reset();
+    data = m_data;
+  }
 
   logger->debug("Server Result\n{}", linkage_result);
   string id_string;
-  for (size_t i = 0; i != m_data->ids->size(); ++i) {
-    id_string += "Index: " + to_string(i) + " ID: " + m_data->ids->at(i) + '\n';
+  for (size_t i = 0; i != data->ids->size(); ++i) {
+    id_string += "Index: " + to_string(i) + " ID: " + data->ids->at(i) + '\n';
   }
   logger->debug("IDs:\n{}", id_string);
-  send_server_result_to_linkageservice(linkage_result);
-
+  auto& server_handler{ServerHandler::get()};
+  auto part_begin{linkage_result.begin()};
+  for (const auto& part : partition) {
+    const auto part_end{part_begin + part.num_records};
+    if (stream_results) {
+      // All chunks of a job run on the same pinned database
+      const auto chunk{server_handler.next_result_chunk(m_remote_id, part)};
+      send_server_result_to_linkageservice({part_begin, part_end},
+          chunk.offset ? nullopt : make_optional(*(data->ids)), chunk);
+    } else if (auto job_result{server_handler.collect_server_result(m_remote_id, part,
+          {part_begin, part_end})}) {
+      send_server_result_to_linkageservice(*job_result, *(data->ids));
+    }
+    part_begin = part_end;
+  }
 }
 
-void LocalServer::send_server_result_to_linkageservice(const vector<Result<CircUnit>>& result) const {
+void LocalServer::send_server_result_to_linkageservice(const vector<Result<CircUnit>>& result,
+                                                       optional<vector<string>> ids,
+                                                       const optional<ResultChunk>& chunk) const {
   auto logger{get_logger(ComponentLogger::REST)};
   auto local_config{ConfigurationHandler::cget().get_local_config()};
   auto remote_config{ConfigurationHandler::get().get_remote_config(m_remote_id)};
-  logger->info("Sending server result to Linkage Service");
+  logger->info("Queueing server result for Linkage Service");
   try {
-    auto response{send_result_to_linkageservice(result,
-                              make_optional(*(m_data->ids)), "server",
-                              local_config, remote_config)};
-    logger->trace("Linkage Server responded with {} - {}",
-                      response.return_code, response.body);
+    DeliveryQueue::get().push(linkage_result_delivery(result, move(ids),
+          "server", local_config, remote_config, chunk));
   } catch (const exception& e) {
-    logger->error("Can not connect to linkage service: {}", e.what());
+    logger->error("Can not deliver server result: {}", e.what());
   }
-
 }
 
-void LocalServer::run_count(shared_ptr<const ServerData> data, size_t num_records) {
+void LocalServer::run_count(shared_ptr<const ServerData> data, size_t num_records,
+                            ServerReadiness& readiness) {
+  const TraceSpan span{"server matching run"};
+  lock_guard<mutex> lock(m_run_mutex);
   m_data = move(data);
 
   auto logger{get_logger()};
@@ -110,7 +144,14 @@ void LocalServer::run_count(shared_ptr<const ServerData> data, size_t num_record
   m_aby_server.run_setup_phase();
   logger->debug("Starting server matching computation");
   m_aby_server.set_input({m_data->data, num_records});
+  if (!readiness.signal_ready()) {
+    logger->warn("Client stopped waiting for matching server, skipping run");
+    m_aby_server.reset();
+    return;
+  }
   auto count_result = m_aby_server.run_count();
+  record_run_stats(m_aby_server.get_run_stats(),
+      {{"remote", m_remote_id}, {"role", "server"}, {"job_type", "matching"}});
   m_aby_server.reset();
   logger->debug("Server Result\n{}", count_result);
 }
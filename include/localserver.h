@@ -20,7 +20,12 @@
 #define SEL_LOCALSERVER_H
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include "secure_epilinker.h"
 #include "seltypes.h"
 #include "resttypes.h"
@@ -32,6 +37,45 @@ class DataHandler;
 class ConfigurationHandler;
 struct ServerData;
 
+/**
+ * Readiness handshake between an initMPC request and its server run
+ *
+ * The run signals readiness once its circuit is built and its input is set,
+ * so the ABY party only waits for the client. Whoever claims the handshake
+ * first wins: either the run proceeds or the request gave up waiting and the
+ * run is skipped.
+ */
+class ServerReadiness {
+ public:
+  ServerReadiness() : m_ready_future(m_ready.get_future()) {}
+  // Returns false if the request gave up, throws the error of a failed run
+  bool wait_ready(std::chrono::milliseconds timeout) {
+    if (m_ready_future.wait_for(timeout) != std::future_status::ready
+        && !m_claimed.exchange(true)) {
+      return false;
+    }
+    m_ready_future.get();
+    return true;
+  }
+  // Returns false if the request already gave up
+  bool signal_ready() {
+    if (m_claimed.exchange(true)) {
+      return false;
+    }
+    m_ready.set_value();
+    return true;
+  }
+  void signal_failure(std::exception_ptr error) {
+    if (!m_claimed.exchange(true)) {
+      m_ready.set_exception(error);
+    }
+  }
+ private:
+  std::promise<void> m_ready;
+  std::future<void> m_ready_future;
+  std::atomic<bool> m_claimed{false};
+};
+
 class LocalServer {
  public:
   LocalServer() = default;
@@ -42,8 +86,17 @@ class LocalServer {
               SecureEpilinker::ABYConfig,
               CircuitConfig);
   RemoteId get_id() const;
-  void run_linkage(std::shared_ptr<const ServerData>, size_t);
-  void run_count(std::shared_ptr<const ServerData>, size_t);
+  const CircuitConfig& get_circuit_config() const { return m_aby_server.get_circuit_config(); }
+  /**
+   * Runs one linkage and sends one result per job of the record partition to
+   * the linkage service, so coalesced and chunked client jobs keep their own
+   * result. Streamed jobs get one result per chunk, only their first chunk
+   * carries the database ids.
+   */
+  void run_linkage(std::shared_ptr<const ServerData>, size_t,
+                   const std::vector<RecordPart>& partition, bool stream_results,
+                   ServerReadiness&);
+  void run_count(std::shared_ptr<const ServerData>, size_t, ServerReadiness&);
   Port get_port() const;
   std::string get_ip() const;
   SecureEpilinker& get_epilinker();
@@ -52,12 +105,15 @@ class LocalServer {
   std::shared_ptr<std::vector<std::string>> get_ids() const {return m_data->ids;}
 
  private:
-  void send_server_result_to_linkageservice(const std::vector<Result<CircUnit>>&) const;
+  void send_server_result_to_linkageservice(const std::vector<Result<CircUnit>>&,
+                                            std::optional<std::vector<std::string>> ids,
+                                            const std::optional<ResultChunk>& = std::nullopt) const;
   RemoteId m_remote_id;
   std::string m_client_ip;
   Port m_client_port;
   std::shared_ptr<const ServerData> m_data;
   SecureEpilinker m_aby_server;
+  std::mutex m_run_mutex; // one MPC run at a time on m_aby_server
 };
 }  // namespace sel
 
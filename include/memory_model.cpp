@@ -0,0 +1,106 @@
+/**
+ \file    memory_model.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Peak memory model of the SecureEpilinker circuits
+*/
+
+#include "memory_model.h"
+#include "math.h"
+#include <algorithm>
+#include <limits>
+#include <set>
+
+using namespace std;
+
+namespace sel {
+
+/*
+ * Follows the structure of the linkage circuit: every compared field pair
+ * costs a dice coefficient or an equality test and the multiplication with
+ * its weight, every summed quotient takes part in the max_tie of the
+ * exchange group permutations and the database.
+ */
+GateCounts count_comparison_gates(const CircuitConfig& cfg) {
+  const bool arith{cfg.use_conversion};
+  const double bitlen(cfg.bitlen);
+  GateCounts gates;
+
+  auto add_mult = [&gates, arith, bitlen]() {
+    if (arith) {
+      gates.arithmetic += 1;
+      gates.conversion += bitlen;
+    } else {
+      gates.boolean += bitlen * bitlen;
+    }
+  };
+  auto add_field_pair = [&gates, &cfg, &add_mult](const FieldName& name) {
+    const auto& field{cfg.epi.fields.at(name)};
+    const double bitsize(field.bitsize);
+    if (field.comparator == FieldComparator::DICE) {
+      // AND, hammingweights and the fixed point division
+      const double div_bits(hw_size(field.bitsize) + cfg.dice_prec);
+      gates.boolean += 3 * bitsize + div_bits * div_bits;
+    } else {
+      gates.boolean += bitsize;
+    }
+    add_mult();
+  };
+  // One quotient comparison of max_tie: two multiplications, comparison and
+  // selection of numerator, denominator and index
+  auto add_quotient_max = [&gates, &add_mult, bitlen]() {
+    add_mult();
+    add_mult();
+    gates.boolean += 4 * bitlen;
+  };
+
+  set<FieldName> ungrouped;
+  for (const auto& field : cfg.epi.fields) ungrouped.insert(field.first);
+  for (const auto& group : cfg.epi.exchange_groups) {
+    for (const auto& name : group) {
+      // every field of the group is compared with every other one
+      for (size_t i = 0; i != group.size(); ++i) add_field_pair(name);
+      ungrouped.erase(name);
+    }
+    double permutations{1};
+    for (size_t k = 2; k <= group.size(); ++k) permutations *= k;
+    for (double p = 1; p < permutations; ++p) add_quotient_max();
+  }
+  for (const auto& name : ungrouped) add_field_pair(name);
+  // max over the database
+  add_quotient_max();
+  return gates;
+}
+
+size_t estimate_peak_memory(const CircuitConfig& cfg, const MemoryModel& model,
+    size_t num_records, size_t database_size) {
+  const auto gates{count_comparison_gates(cfg)};
+  const double comparison_bytes{gates.boolean * model.boolean_gate_bytes
+    + gates.arithmetic * model.arithmetic_gate_bytes
+    + gates.conversion * model.conversion_bit_bytes};
+  return model.base_bytes + static_cast<size_t>(
+      comparison_bytes * num_records * max<size_t>(database_size, 1));
+}
+
+size_t max_records_within(const CircuitConfig& cfg, const MemoryModel& model,
+    size_t database_size, size_t memory_budget) {
+  if (memory_budget <= model.base_bytes) {
+    return 0;
+  }
+  const auto record_bytes{estimate_peak_memory(cfg, model, 1, database_size)
+    - model.base_bytes};
+  return record_bytes ? (memory_budget - model.base_bytes) / record_bytes
+                      : numeric_limits<size_t>::max();
+}
+
+} /* END namespace sel */
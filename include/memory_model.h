@@ -0,0 +1,63 @@
+/**
+ \file    memory_model.h
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Peak memory model of the SecureEpilinker circuits
+*/
+
+#ifndef SEL_MEMORY_MODEL_H
+#define SEL_MEMORY_MODEL_H
+#pragma once
+
+#include "circuit_config.h"
+
+namespace sel {
+
+/**
+ * Approximate number of gates of one client record compared against one
+ * database record, by gate class. All shares are SIMD over the database, so a
+ * run has num_records * database_size times these gates.
+ */
+struct GateCounts {
+  double boolean{0}; // AND gates in Yao or GMW sharing
+  double arithmetic{0}; // multiplications in arithmetic sharing
+  double conversion{0}; // bits converted between arithmetic and boolean
+};
+
+GateCounts count_comparison_gates(const CircuitConfig& cfg);
+
+/**
+ * Bytes of peak resident memory per gate of each class plus a fixed base.
+ * The defaults are rough values for Yao sharing, calibrate with
+ * test_sel --calibrate-memory.
+ */
+struct MemoryModel {
+  double boolean_gate_bytes{64};
+  double arithmetic_gate_bytes{48};
+  double conversion_bit_bytes{96};
+  size_t base_bytes{64ull << 20};
+};
+
+size_t estimate_peak_memory(const CircuitConfig& cfg, const MemoryModel& model,
+    size_t num_records, size_t database_size);
+
+/**
+ * Largest number of client records that can be linked against database_size
+ * records within memory_budget, 0 if not even a single record fits
+ */
+size_t max_records_within(const CircuitConfig& cfg, const MemoryModel& model,
+    size_t database_size, size_t memory_budget);
+
+} /* END namespace sel */
+
+#endif /* end of include guard: SEL_MEMORY_MODEL_H */
@@ -0,0 +1,210 @@
+/**
+\file    metrics.cpp
+\copyright SEL - Secure EpiLinker
+    Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published
+    by the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+\brief Process wide metrics in Prometheus text format
+*/
+
+#include "metrics.h"
+#include "fmt/format.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+namespace sel {
+
+namespace {
+// Seconds, MPC runs of large databases take minutes
+const vector<double> duration_bounds{0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5,
+                                     1, 2.5, 5, 10, 30, 60, 120, 300, 600};
+
+string type_name(MetricType type) {
+  switch (type) {
+    case MetricType::COUNTER: return "counter";
+    case MetricType::GAUGE: return "gauge";
+    case MetricType::HISTOGRAM: return "histogram";
+  }
+  return "untyped";
+}
+
+string escape_label_value(const string& value) {
+  string result;
+  result.reserve(value.size());
+  for (const auto c : value) {
+    switch (c) {
+      case '\\': result += "\\\\"; break;
+      case '"': result += "\\\""; break;
+      case '\n': result += "\\n"; break;
+      default: result += c;
+    }
+  }
+  return result;
+}
+
+string format_labels(const MetricLabels& labels, const string& le = "") {
+  if (labels.empty() && le.empty()) {
+    return "";
+  }
+  string result{"{"};
+  for (const auto& [name, value] : labels) {
+    result += (result.size() > 1 ? "," : "") + name + "=\"" + escape_label_value(value) + '"';
+  }
+  if (!le.empty()) {
+    result += (result.size() > 1 ? "," : "") + "le=\""s + le + '"';
+  }
+  return result + '}';
+}
+} // namespace
+
+Metrics& Metrics::get() {
+  static Metrics singleton;
+  return singleton;
+}
+
+Metrics::Metrics() {
+  add_family("sel_database_fetch_seconds", MetricType::HISTOGRAM,
+      "Duration of fetching the local database for a remote");
+  add_family("sel_mpc_circuit_build_seconds", MetricType::HISTOGRAM,
+      "Duration of building the MPC circuit");
+  add_family("sel_mpc_setup_seconds", MetricType::HISTOGRAM,
+      "Duration of the ABY setup phase");
+  add_family("sel_mpc_online_seconds", MetricType::HISTOGRAM,
+      "Duration of the ABY online phase");
+  add_family("sel_delivery_seconds", MetricType::HISTOGRAM,
+      "Duration of result and callback delivery attempts");
+  add_family("sel_mpc_runs_total", MetricType::COUNTER,
+      "Finished MPC runs");
+  add_family("sel_mpc_gates_total", MetricType::COUNTER,
+      "Gates of all finished MPC circuits");
+  add_family("sel_mpc_circuit_depth", MetricType::GAUGE,
+      "Depth of the last MPC circuit");
+  add_family("sel_mpc_bytes_sent_total", MetricType::COUNTER,
+      "Bytes sent to the remote party by ABY phase");
+  add_family("sel_mpc_bytes_received_total", MetricType::COUNTER,
+      "Bytes received from the remote party by ABY phase");
+  add_family("sel_queued_jobs", MetricType::GAUGE,
+      "Linkage jobs waiting for a worker slot");
+  add_family("sel_jobs", MetricType::GAUGE,
+      "Registered linkage jobs by status");
+  add_family("sel_running_mpc_runs", MetricType::GAUGE,
+      "MPC runs admitted by the resource scheduler");
+  add_family("sel_pending_deliveries", MetricType::GAUGE,
+      "Results and callbacks waiting for delivery");
+  add_family("sel_task_queue_seconds", MetricType::HISTOGRAM,
+      "Time named executor tasks waited for a thread");
+  add_family("sel_task_run_seconds", MetricType::HISTOGRAM,
+      "Run time of named executor tasks");
+}
+
+void Metrics::add_family(const string& name, MetricType type, string help) {
+  m_families.emplace(name, Family{type, move(help),
+      type == MetricType::HISTOGRAM ? duration_bounds : vector<double>{}, {}});
+}
+
+Metrics::Series& Metrics::series_of(const string& name, MetricType type,
+                                    const MetricLabels& labels) {
+  auto& family{m_families.at(name)};
+  if (family.type != type) {
+    throw invalid_argument("Metric " + name + " is a " + type_name(family.type));
+  }
+  auto& series{family.series[labels]};
+  if (series.buckets.size() != family.bounds.size()) {
+    series.buckets.resize(family.bounds.size());
+  }
+  return series;
+}
+
+void Metrics::increment(const string& name, const MetricLabels& labels, double value) {
+  lock_guard<mutex> lock(m_mutex);
+  series_of(name, MetricType::COUNTER, labels).value += value;
+}
+
+void Metrics::set(const string& name, const MetricLabels& labels, double value) {
+  lock_guard<mutex> lock(m_mutex);
+  series_of(name, MetricType::GAUGE, labels).value = value;
+}
+
+void Metrics::observe(const string& name, const MetricLabels& labels, double value) {
+  lock_guard<mutex> lock(m_mutex);
+  const auto& bounds{m_families.at(name).bounds};
+  auto& series{series_of(name, MetricType::HISTOGRAM, labels)};
+  const auto bucket{lower_bound(bounds.begin(), bounds.end(), value) - bounds.begin()};
+  if (static_cast<size_t>(bucket) != bounds.size()) {
+    ++series.buckets[bucket];
+  }
+  series.value += value;
+  ++series.count;
+}
+
+void Metrics::add_collector(Collector collector) {
+  lock_guard<mutex> lock(m_collector_mutex);
+  m_collectors.emplace_back(move(collector));
+}
+
+string Metrics::render() {
+  {
+    lock_guard<mutex> lock(m_collector_mutex);
+    for (const auto& collector : m_collectors) {
+      collector(*this);
+    }
+  }
+  lock_guard<mutex> lock(m_mutex);
+  string result;
+  for (const auto& [name, family] : m_families) {
+    result += "# HELP " + name + ' ' + family.help + '\n';
+    result += "# TYPE " + name + ' ' + type_name(family.type) + '\n';
+    for (const auto& [labels, series] : family.series) {
+      if (family.type != MetricType::HISTOGRAM) {
+        result += fmt::format("{}{} {}\n", name, format_labels(labels), series.value);
+        continue;
+      }
+      uint64_t cumulative{0};
+      for (size_t i = 0; i != family.bounds.size(); ++i) {
+        cumulative += series.buckets[i];
+        result += fmt::format("{}_bucket{} {}\n", name,
+            format_labels(labels, fmt::format("{}", family.bounds[i])), cumulative);
+      }
+      result += fmt::format("{}_bucket{} {}\n", name, format_labels(labels, "+Inf"), series.count);
+      result += fmt::format("{}_sum{} {}\n", name, format_labels(labels), series.value);
+      result += fmt::format("{}_count{} {}\n", name, format_labels(labels), series.count);
+    }
+  }
+  return result;
+}
+
+ScopedTimer::ScopedTimer(string name, MetricLabels labels)
+  : m_name{move(name)}, m_labels{move(labels)}, m_start{chrono::steady_clock::now()} {}
+
+ScopedTimer::~ScopedTimer() {
+  Metrics::get().observe(m_name, m_labels,
+      chrono::duration<double>(chrono::steady_clock::now() - m_start).count());
+}
+
+void record_run_stats(const SecureEpilinker::RunStats& stats, const MetricLabels& labels) {
+  auto& metrics{Metrics::get()};
+  metrics.observe("sel_mpc_circuit_build_seconds", labels, stats.circuit_build_ms / 1000);
+  metrics.observe("sel_mpc_setup_seconds", labels, stats.setup_ms / 1000);
+  metrics.observe("sel_mpc_online_seconds", labels, stats.online_ms / 1000);
+  metrics.increment("sel_mpc_runs_total", labels);
+  metrics.increment("sel_mpc_gates_total", labels, stats.gates);
+  metrics.set("sel_mpc_circuit_depth", labels, stats.depth);
+  auto phase_labels{labels};
+  phase_labels["phase"] = "setup";
+  metrics.increment("sel_mpc_bytes_sent_total", phase_labels, stats.setup_sent);
+  metrics.increment("sel_mpc_bytes_received_total", phase_labels, stats.setup_received);
+  phase_labels["phase"] = "online";
+  metrics.increment("sel_mpc_bytes_sent_total", phase_labels, stats.online_sent);
+  metrics.increment("sel_mpc_bytes_received_total", phase_labels, stats.online_received);
+}
+
+} // namespace sel
@@ -0,0 +1,112 @@
+/**
+\file    metrics.h
+\copyright SEL - Secure EpiLinker
+    Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published
+    by the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+\brief Process wide metrics in Prometheus text format
+*/
+
+#ifndef SEL_METRICS_H
+#define SEL_METRICS_H
+#pragma once
+
+#include "secure_epilinker.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sel {
+
+enum class MetricType { COUNTER, GAUGE, HISTOGRAM };
+
+using MetricLabels = std::map<std::string, std::string>;
+
+/**
+ * Registry of all metrics of the daemon
+ *
+ * The metric families are fixed and declared in the constructor, updating an
+ * unknown family or one of another type throws. Gauges of state owned by
+ * other components, e.g. queue depths, are set by collectors right before
+ * every scrape.
+ */
+class Metrics {
+  public:
+    // Called on scrape with the collector mutex held, but not the registry
+    // mutex, sets gauges on the registry. Must not add collectors.
+    using Collector = std::function<void (Metrics&)>;
+
+    static Metrics& get();
+
+    void increment(const std::string& name, const MetricLabels& = {}, double value = 1);
+    void set(const std::string& name, const MetricLabels&, double value);
+    // Durations are observed in seconds
+    void observe(const std::string& name, const MetricLabels&, double value);
+    void add_collector(Collector);
+
+    // Text exposition format 0.0.4
+    std::string render();
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+  protected:
+    Metrics();
+  private:
+    struct Series {
+      double value{0}; // sum of observations for histograms
+      uint64_t count{0};
+      std::vector<uint64_t> buckets; // not cumulative
+    };
+    struct Family {
+      MetricType type;
+      std::string help;
+      std::vector<double> bounds;
+      std::map<MetricLabels, Series> series;
+    };
+
+    void add_family(const std::string& name, MetricType, std::string help);
+    // Needs m_mutex
+    Series& series_of(const std::string& name, MetricType, const MetricLabels&);
+
+    std::map<std::string, Family> m_families;
+    std::vector<Collector> m_collectors;
+    std::mutex m_mutex;
+    std::mutex m_collector_mutex;
+};
+
+/**
+ * Observes its lifetime on a duration histogram
+ */
+class ScopedTimer {
+  public:
+    ScopedTimer(std::string name, MetricLabels);
+    ~ScopedTimer();
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+  private:
+    const std::string m_name;
+    const MetricLabels m_labels;
+    const std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * Records the circuit, timing and communication counters of a finished MPC
+ * run. labels are expected to hold remote, role and job type.
+ */
+void record_run_stats(const SecureEpilinker::RunStats&, const MetricLabels&);
+
+} // namespace sel
+
+#endif /* end of include guard: SEL_METRICS_H */
@@ -17,17 +17,199 @@
 */
 
 #include "monitormethodhandler.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include "fmt/format.h"
 #include "linkagejob.h"
 #include "logger.h"
 #include "restbed"
 #include "resttypes.h"
-#include "serverhandler.h"
+#include "configurationhandler.h"
+#include "connectionhandler.h"
+#include "jobregistry.h"
+#include "util.h"
 
 using namespace std;
 namespace sel {
+
+namespace {
+constexpr chrono::seconds max_status_wait{300};
+
+// Sessions are only written from the REST service's threads, other threads
+// hand their writes to the service
+void on_service(const function<void()>& task) {
+  ConnectionHandler::cget().get_service()->schedule(task);
+}
+
+// Evicted jobs finished long ago
+bool all_finished(const vector<JobId>& ids) {
+  const auto& registry{JobRegistry::cget()};
+  return all_of(ids.begin(), ids.end(), [&registry](const JobId& id){
+      try {
+        return registry.find(id)->is_finished();
+      } catch (const out_of_range&) {
+        return true;
+      }});
+}
+
+// Jobs evicted after their retention are reported as expired
+constexpr auto expired_status{"Expired"};
+
+nlohmann::json job_status(const JobId& id, bool timings) {
+  shared_ptr<LinkageJob> job;
+  try {
+    job = JobRegistry::cget().find(id);
+  } catch (const out_of_range&) {
+    return timings ? nlohmann::json{{"status", expired_status}} : nlohmann::json(expired_status);
+  }
+  if (!timings) {
+    return js_enum_to_string(job->get_status());
+  }
+  return {{"status", js_enum_to_string(job->get_status())},
+          {"timings", job->get_timings()}};
+}
+
+/**
+ * A single job's plain status, or an object of the statuses of several jobs.
+ * With timings, every status becomes an object with the job's timings.
+ */
+string status_body(const vector<JobId>& ids, bool timings) {
+  if (ids.size() == 1) {
+    const auto status = job_status(ids.front(), timings);
+    return timings ? status.dump() : status.get<string>();
+  }
+  nlohmann::json result;
+  for (const auto& id : ids) {
+    result[id] = job_status(id, timings);
+  }
+  return result.dump();
+}
+
+// Keeps the connection for further requests unless the client closes it
+void respond(const shared_ptr<restbed::Session>& session, int return_code, const string& body) {
+  auto connection{session->get_request()->get_header("Connection", "")};
+  transform(connection.begin(), connection.end(), connection.begin(), ::tolower);
+  const bool keep_alive{connection != "close"};
+  const multimap<string, string> headers{{"Content-Length", to_string(body.length())},
+                                         {"Connection", keep_alive ? "keep-alive" : "close"}};
+  if (keep_alive) {
+    session->yield(return_code, body, headers);
+  } else {
+    session->close(return_code, body, headers);
+  }
+}
+
+struct StatusWatch {
+  std::mutex mutex;
+  size_t subscription;
+  bool done{false};
+  map<JobId, JobStatus> sent;
+  vector<pair<JobId, JobStatus>> pending; // transitions not yet streamed
+};
+
+/**
+ * Answers once all jobs finished or the wait expired. The REST worker is
+ * released right away, the thread finishing the last job hands the response
+ * to the service, otherwise it is sent from the session's timer.
+ */
+void long_poll(const shared_ptr<restbed::Session>& session, const vector<JobId>& ids,
+    chrono::seconds wait, bool timings) {
+  auto watch{make_shared<StatusWatch>()};
+  auto finish = [session, ids, watch, timings]() {
+    lock_guard<mutex> lock(watch->mutex);
+    if (watch->done) return;
+    watch->done = true;
+    JobRegistry::get().unsubscribe(watch->subscription);
+    try {
+      respond(session, restbed::OK, status_body(ids, timings));
+    } catch (const exception& e) {
+      respond(session, restbed::BAD_REQUEST, "Invalid job id");
+    }
+  };
+  {
+    lock_guard<mutex> lock(watch->mutex);
+    watch->subscription = JobRegistry::get().subscribe(ids,
+        [ids, finish](const JobId&, JobStatus){ if (all_finished(ids)) on_service(finish); });
+  }
+  if (all_finished(ids)) {
+    finish();
+    return;
+  }
+  session->sleep_for(wait, [finish](const shared_ptr<restbed::Session>){ finish(); });
+}
+
+string status_event(const JobId& id, const string& status) {
+  return fmt::format("event: status\ndata: {}\n\n",
+      nlohmann::json{{"jobId", id}, {"status", status}}.dump());
+}
+
+/**
+ * Streams every status transition of the jobs as server-sent events and
+ * closes the stream once all jobs finished. The current status of every job
+ * is replayed first. Transitions are queued by the jobs' threads and written
+ * in order by the service.
+ */
+void stream_status(const shared_ptr<restbed::Session>& session, const vector<JobId>& ids) {
+  auto watch{make_shared<StatusWatch>()};
+  // All need the watch's mutex
+  auto stop = [session, watch](bool close) {
+    watch->done = true;
+    JobRegistry::get().unsubscribe(watch->subscription);
+    if (close) session->close();
+  };
+  auto send = [session, watch, stop](const JobId& id, JobStatus status) {
+    if (watch->done) return false;
+    if (session->is_closed()) {
+      stop(false);
+      return false;
+    }
+    const auto sent{watch->sent.find(id)};
+    if (sent == watch->sent.end() || sent->second != status) {
+      watch->sent[id] = status;
+      session->yield(status_event(id, js_enum_to_string(status)));
+    }
+    return true;
+  };
+  auto close_if_finished = [ids, watch, stop]() {
+    if (!watch->done && all_finished(ids)) stop(true);
+  };
+  session->yield(restbed::OK, {{"Content-Type", "text/event-stream"},
+                               {"Cache-Control", "no-cache"},
+                               {"Connection", "keep-alive"}});
+  lock_guard<mutex> lock(watch->mutex);
+  watch->subscription = JobRegistry::get().subscribe(ids,
+      [watch, send, close_if_finished](const JobId& id, JobStatus status){
+        {
+          lock_guard<mutex> lock(watch->mutex);
+          if (watch->done) return;
+          watch->pending.emplace_back(id, status);
+        }
+        on_service([watch, send, close_if_finished]{
+          lock_guard<mutex> lock(watch->mutex);
+          for (const auto& [id, status] : watch->pending) {
+            if (!send(id, status)) break;
+          }
+          watch->pending.clear();
+          close_if_finished();
+        });
+      });
+  for (const auto& id : ids) {
+    try {
+      send(id, JobRegistry::cget().get_status(id));
+    } catch (const out_of_range&) {
+      if (!watch->done) session->yield(status_event(id, expired_status));
+    }
+  }
+  close_if_finished();
+}
+} // namespace
+
 MonitorMethodHandler::MonitorMethodHandler(
     const std::string& method)
     : MethodHandler(method),
@@ -39,6 +221,14 @@ MonitorMethodHandler::MonitorMethodHandler(
     : MethodHandler(method, validator),
       m_logger{get_logger()} {}
 
+/**
+ * Answers /jobs/list with a page of all jobs, ?after=<nextCursor> continues
+ * after the previous page without counting pages, and /jobs/{job_id} with the
+ * status of one job or a comma separated list of jobs. With ?wait=<seconds>
+ * the answer is delayed until all jobs finished or the wait expired, with
+ * Accept: text/event-stream the status transitions are streamed. With
+ * ?timings=true the stage timings of the jobs are returned as well.
+ */
 void MonitorMethodHandler::handle_method(
     shared_ptr<restbed::Session> session) const {
   auto request{session->get_request()};
@@ -54,17 +244,55 @@ void MonitorMethodHandler::handle_method(
     header_string += h.first +" -- " + h.second +"\n";
   }
   m_logger->trace("Recieved headers:\n{}", header_string);
-  SessionResponse response;
+  const auto& registry{JobRegistry::cget()};
+  if(job_id == "list") {
+    // Without paging parameters all jobs are listed as before paging existed
+    if (!request->has_query_parameter("page") && !request->has_query_parameter("pageSize")
+        && !request->has_query_parameter("after")) {
+      respond(session, restbed::OK, registry.list_all().dump());
+      return;
+    }
+    try {
+      const auto page_size{stoul(request->get_query_parameter("pageSize",
+            to_string(ConfigurationHandler::cget().get_server_config().default_page_size)))};
+      if (const auto cursor{request->get_query_parameter("after", "")}; !cursor.empty()) {
+        respond(session, restbed::OK, registry.list_after(cursor, page_size).dump());
+      } else {
+        const auto page{stoul(request->get_query_parameter("page", "1"))};
+        respond(session, restbed::OK, registry.list(page, page_size).dump());
+      }
+    } catch (const exception& e) {
+      respond(session, restbed::BAD_REQUEST, "Invalid page");
+    }
+    return;
+  }
+
+  const auto ids{split(job_id, ',')};
+  chrono::seconds wait;
+  const bool timings{request->get_query_parameter("timings", "false") == "true"};
   try {
-    const auto status{ServerHandler::cget().get_job_status(job_id)};
-    response.return_code = restbed::OK;
-    response.body = status;
+    if (ids.empty()) {
+      throw invalid_argument("No job id");
+    }
+    for (const auto& id : ids) {
+      registry.find(id);
+    }
+    wait = min(chrono::seconds{stoul(request->get_query_parameter("wait", "0"))},
+               max_status_wait);
   } catch (const exception& e) {
-    response.return_code = restbed::BAD_REQUEST;
-    response.body = "Invalid job id";
+    respond(session, restbed::BAD_REQUEST, "Invalid job id");
+    return;
+  }
+  if (request->get_header("Accept", "").find("text/event-stream") != string::npos) {
+    stream_status(session, ids);
+  } else if (wait.count()) {
+    long_poll(session, ids, wait, timings);
+  } else {
+    try {
+      respond(session, restbed::OK, status_body(ids, timings));
+    } catch (const exception& e) {
+      respond(session, restbed::BAD_REQUEST, "Invalid job id");
+    }
   }
-  response.headers = {{"Content-Length", to_string(response.body.length())},
-                      {"Connection", "Close"}};
-  session->close(response.return_code, response.body, response.headers);
 }
 }  // namespace sel
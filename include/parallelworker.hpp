@@ -0,0 +1,244 @@
+/**
+ \file    parallelworker.hpp
+ \author  Sebastian Stammler <sebastian.stammler@cysec.de>
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Thread-safe worker threads sharing one prioritized job queue
+*/
+
+#ifndef SEL_PARALLELWORKER_HPP
+#define SEL_PARALLELWORKER_HPP
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <thread>
+#include <vector>
+
+namespace sel {
+
+/**
+ * Worker threads with one shared job queue
+ *
+ * Every worker slot has its own consumer, e.g. bound to its own ABY party,
+ * and runs one batch of jobs at a time. Jobs are dispatched to the first free
+ * slot. With a single slot this behaves like a serial worker. Every slot has
+ * its own thread, the slot loops live as long as the worker and must not
+ * occupy threads of the shared Executor.
+ *
+ * Jobs are sorted into priority classes with one FIFO queue each. Free slots
+ * either always serve the highest non-empty class or share the dispatches
+ * between the non-empty classes by their weights.
+ */
+template<typename T>
+class ParallelWorker {
+public:
+  using JobBatch = std::vector<std::shared_ptr<T>>;
+  using JobConsumer = std::function<void (const JobBatch&)>;
+
+  /**
+   * A batchable job is coalesced with further queued batchable jobs as long
+   * as their summed weight does not exceed max_weight. If the batch is not
+   * full yet, the slot waits up to wait_window for more jobs.
+   * The default policy never batches.
+   */
+  struct BatchPolicy {
+    size_t max_weight{1};
+    std::chrono::milliseconds wait_window{0};
+    std::function<bool (const T&)> batchable;
+    std::function<size_t (const T&)> weight;
+  };
+
+  /**
+   * job_class maps a job to its class, lower classes have higher priority.
+   * The default policy has a single class.
+   */
+  struct SchedulingPolicy {
+    std::function<size_t (const T&)> job_class;
+    std::vector<size_t> class_weights{1};
+    bool strict{false};
+  };
+
+  explicit ParallelWorker(const std::vector<JobConsumer>& slot_consumers,
+                          BatchPolicy policy = {},
+                          SchedulingPolicy scheduling = {})
+    : policy_(std::move(policy)), scheduling_(std::move(scheduling)),
+      queues_(std::max<size_t>(scheduling_.class_weights.size(), 1)),
+      credits_(queues_.size(), 0) {
+    threads_.reserve(slot_consumers.size());
+    for (const auto& consumer : slot_consumers) {
+      threads_.emplace_back(&ParallelWorker<T>::worker_loop, this, consumer);
+    }
+  }
+
+  void push(std::shared_ptr<T> job) {
+    std::unique_lock<std::mutex> mlock(mutex_);
+    enqueue(std::move(job));
+    mlock.unlock();
+    cond_.notify_one();
+  }
+
+  /**
+   * Queues the job once not_before has passed, e.g. to retry it on a busy
+   * remote. Until then no slot is occupied by it.
+   */
+  void push_after(std::shared_ptr<T> job, std::chrono::steady_clock::time_point not_before) {
+    if (not_before <= std::chrono::steady_clock::now()) {
+      push(std::move(job));
+      return;
+    }
+    std::unique_lock<std::mutex> mlock(mutex_);
+    delayed_.emplace(not_before, std::move(job));
+    mlock.unlock();
+    // Idle slots have to wait for the new deadline
+    cond_.notify_all();
+  }
+
+  void interrupt() {
+    std::unique_lock<std::mutex> mlock(mutex_);
+    interrupted = true;
+    mlock.unlock();
+    cond_.notify_all();
+  }
+
+  // Returns once the slots finished their current batch, call interrupt first
+  void join() {
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  size_t num_slots() const {
+    return threads_.size();
+  }
+
+  size_t num_queued() const {
+    std::lock_guard<std::mutex> mlock(mutex_);
+    return num_queued_ + delayed_.size();
+  }
+
+  ParallelWorker()=delete;
+  ParallelWorker(const ParallelWorker&) = delete;
+  ParallelWorker& operator=(const ParallelWorker&) = delete;
+
+private:
+  const BatchPolicy policy_;
+  const SchedulingPolicy scheduling_;
+  std::vector<std::thread> threads_;
+  std::vector<std::deque<std::shared_ptr<T>>> queues_;
+  std::vector<long> credits_;
+  std::multimap<std::chrono::steady_clock::time_point, std::shared_ptr<T>> delayed_;
+  size_t num_queued_{0};
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  bool interrupted = false;
+
+  // Both need mutex_
+  void enqueue(std::shared_ptr<T> job) {
+    const auto job_class{scheduling_.job_class ? scheduling_.job_class(*job) : 0};
+    queues_[std::min(job_class, queues_.size() - 1)].push_back(std::move(job));
+    ++num_queued_;
+  }
+
+  void enqueue_due_jobs() {
+    const auto now{std::chrono::steady_clock::now()};
+    while (!delayed_.empty() && delayed_.begin()->first <= now) {
+      enqueue(std::move(delayed_.begin()->second));
+      delayed_.erase(delayed_.begin());
+    }
+  }
+
+  // Picks the class to serve next, needs mutex_ and a non-empty queue
+  size_t next_class() {
+    if (scheduling_.strict) {
+      return std::find_if(queues_.begin(), queues_.end(),
+          [](const auto& queue){ return !queue.empty(); }) - queues_.begin();
+    }
+    // Smooth weighted round robin over the non-empty classes
+    size_t chosen{queues_.size()};
+    long total_weight{0};
+    for (size_t c = 0; c != queues_.size(); ++c) {
+      if (queues_[c].empty()) continue;
+      const auto weight{static_cast<long>(scheduling_.class_weights[c])};
+      credits_[c] += weight;
+      total_weight += weight;
+      if (chosen == queues_.size() || credits_[c] > credits_[chosen]) {
+        chosen = c;
+      }
+    }
+    credits_[chosen] -= total_weight;
+    return chosen;
+  }
+
+  // Moves fitting batchable jobs of a class into the batch, needs mutex_
+  void collect_batchable(size_t job_class, JobBatch& batch, size_t& weight) {
+    auto& queue{queues_[job_class]};
+    for (auto it = queue.begin(); it != queue.end() && weight < policy_.max_weight;) {
+      const auto job_weight{policy_.weight(**it)};
+      if (policy_.batchable(**it) && weight + job_weight <= policy_.max_weight) {
+        weight += job_weight;
+        batch.emplace_back(std::move(*it));
+        it = queue.erase(it);
+        --num_queued_;
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  void worker_loop(const JobConsumer job_consumer) {
+    while (true) {
+      std::unique_lock<std::mutex> mlock(mutex_);
+      enqueue_due_jobs();
+      while (!interrupted && !num_queued_) {
+        if (delayed_.empty()) {
+          cond_.wait(mlock);
+        } else {
+          cond_.wait_until(mlock, delayed_.begin()->first);
+        }
+        enqueue_due_jobs();
+      }
+      if (interrupted) return;
+      // Jobs are only coalesced with jobs of their own class
+      const auto job_class{next_class()};
+      JobBatch batch{std::move(queues_[job_class].front())};
+      queues_[job_class].pop_front();
+      --num_queued_;
+
+      if (policy_.batchable && policy_.batchable(*batch.front())) {
+        size_t weight{policy_.weight(*batch.front())};
+        const auto deadline{std::chrono::steady_clock::now() + policy_.wait_window};
+        collect_batchable(job_class, batch, weight);
+        while (weight < policy_.max_weight && !interrupted
+            && cond_.wait_until(mlock, deadline) == std::cv_status::no_timeout) {
+          collect_batchable(job_class, batch, weight);
+          // Hand jobs this slot could not take on to an idle slot
+          if (num_queued_) cond_.notify_one();
+        }
+        collect_batchable(job_class, batch, weight);
+      }
+      mlock.unlock();
+
+      job_consumer(batch);
+    }
+  }
+};
+
+} /* end of namespace: sel */
+#endif /* end of include guard: SEL_PARALLELWORKER_HPP */
@@ -30,6 +30,7 @@
 #include "connectionconfig.hpp"
 #include "connectionhandler.h"
 #include "serverhandler.h"
+#include "executor.h"
 using namespace std;
 namespace sel {
 
@@ -63,12 +64,12 @@ RemoteId RemoteConfiguration::get_id() const {
   return m_remote_id;
 }
 
-Port RemoteConfiguration::get_aby_port() const {
-  return m_aby_port;
+const vector<Port>& RemoteConfiguration::get_aby_ports() const {
+  return m_aby_ports;
 }
 
-void RemoteConfiguration::set_aby_port(Port port) {
-  m_aby_port = port;
+void RemoteConfiguration::set_aby_ports(vector<Port> ports) {
+  m_aby_ports = move(ports);
 }
 
 void RemoteConfiguration::set_matching_mode(bool matching_mode) {
@@ -97,7 +98,7 @@ void RemoteConfiguration::test_configuration(
   string url{assemble_remote_url(this) + "/testConfig/" + client_id};
 
   logger->debug("Sending config test to: {}\n", url);
-  auto response{perform_post_request(url, data, headers, true)};
+  auto response{perform_post_request(url, data, headers)};
   logger->trace("Config test response:\n{} - {}\n", response.return_code, response.body );
 
   if(response.body.find("No connection initialized") != response.body.npos){
@@ -108,13 +109,13 @@ void RemoteConfiguration::test_configuration(
     logger->error("Configuration is not compatible to remote config");
     return;
   }
-  const auto aby_server_port{get_headers(response.body, "SEL-Port")};
+  const auto aby_server_port{get_headers(response, "SEL-Port")};
   if (!aby_server_port.empty()) {
-    logger->info("Client registered aby Port {}", aby_server_port.front());
-    set_aby_port(stoul(aby_server_port.front()));
+    logger->info("Client registered aby Ports {}", aby_server_port.front());
+    set_aby_ports(parse_port_list(aby_server_port.front()));
     mark_mutually_initialized();
-    std::thread client_creator([this](){ServerHandler::get().insert_client(m_remote_id);});
-    client_creator.detach();
+    Executor::get().submit([this](){ServerHandler::get().insert_client(m_remote_id);},
+        {TaskPriority::HIGH, true, "client creation"});
   }
 }
 
@@ -132,7 +133,7 @@ void RemoteConfiguration::test_linkage_service() const {
       ConfigurationHandler::cget().get_local_config()->get_local_id()};
     list<string> header{"Authorization: "s+m_linkage_service.authenticator.sign_transaction("")};
     get_logger(ComponentLogger::REST)->info("Testing Connection to Linkage Service at: {}", url);
-    auto response{perform_get_request(url, header, false)};
+    auto response{perform_get_request(url, header)};
     if(response.return_code != 204) {
       throw logic_error(to_string(response.return_code)+" - "+response.body);
     }
@@ -52,8 +52,8 @@ class RemoteConfiguration {
   RemoteId get_id() const;
 
   Port get_remote_signaling_port() const;
-  Port get_aby_port() const;
-  void set_aby_port(Port port);
+  const std::vector<Port>& get_aby_ports() const;
+  void set_aby_ports(std::vector<Port> ports);
   std::string get_remote_host() const;
   std::string get_remote_scheme() const;
   const Authenticator& get_remote_authenticator() const;
@@ -71,7 +71,7 @@ class RemoteConfiguration {
   RemoteId m_remote_id;
   ConnectionConfig m_connection_profile;
   ConnectionConfig m_linkage_service;
-  Port m_aby_port;
+  std::vector<Port> m_aby_ports;
   bool m_matching_mode{false};
   mutable bool m_mutually_initialized{false};
 };
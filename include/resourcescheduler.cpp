@@ -0,0 +1,141 @@
+/**
+\file    resourcescheduler.cpp
+\copyright SEL - Secure EpiLinker
+    Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published
+    by the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+\brief Admission of MPC runs against global core and memory budgets
+*/
+
+#include "resourcescheduler.h"
+#include "configurationhandler.h"
+#include "metrics.h"
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+namespace sel {
+
+ResourceScheduler::Reservation::Reservation(ResourceScheduler* scheduler, Estimate estimate)
+  : m_scheduler{scheduler}, m_estimate{estimate} {}
+
+ResourceScheduler::Reservation::Reservation(Reservation&& other) noexcept
+  : m_scheduler{other.m_scheduler}, m_estimate{other.m_estimate} {
+  other.m_scheduler = nullptr;
+}
+
+ResourceScheduler::Reservation&
+ResourceScheduler::Reservation::operator=(Reservation&& other) noexcept {
+  if (this != &other) {
+    if (m_scheduler) m_scheduler->release(m_estimate);
+    m_scheduler = other.m_scheduler;
+    m_estimate = other.m_estimate;
+    other.m_scheduler = nullptr;
+  }
+  return *this;
+}
+
+ResourceScheduler::Reservation::~Reservation() {
+  if (m_scheduler) m_scheduler->release(m_estimate);
+}
+
+ResourceScheduler& ResourceScheduler::get() {
+  static ResourceScheduler singleton;
+  return singleton;
+}
+
+ResourceScheduler const& ResourceScheduler::cget() {
+  return cref(get());
+}
+
+ResourceScheduler::ResourceScheduler() {
+  const auto& server_config{ConfigurationHandler::cget().get_server_config()};
+  m_core_budget = server_config.scheduler_cores ? server_config.scheduler_cores
+                                                : max(thread::hardware_concurrency(), 1u);
+  m_memory_budget = server_config.scheduler_memory_mb << 20;
+  m_memory_model = server_config.memory_model;
+  m_threads_per_run = max<size_t>(server_config.aby_threads, 1);
+  m_database_size_hint = server_config.database_size_hint;
+  m_logger->debug("Scheduling MPC runs on {} cores and {} MiB", m_core_budget,
+      server_config.scheduler_memory_mb);
+  Metrics::get().add_collector([this](Metrics& metrics){
+      lock_guard<mutex> lock(m_mutex);
+      metrics.set("sel_running_mpc_runs", {}, m_running); });
+}
+
+// Every run keeps its ABY threads busy
+ResourceScheduler::Estimate ResourceScheduler::estimate_run(const CircuitConfig& cfg,
+    size_t num_records, size_t database_size) const {
+  return {m_threads_per_run,
+          estimate_peak_memory(cfg, m_memory_model, num_records, database_size)};
+}
+
+size_t ResourceScheduler::max_run_records(const CircuitConfig& cfg,
+    size_t database_size) const {
+  return max_records_within(cfg, m_memory_model, database_size, m_memory_budget);
+}
+
+ResourceScheduler::Reservation ResourceScheduler::acquire(Estimate estimate) {
+  unique_lock<mutex> lock(m_mutex);
+  if (!fits(estimate)) {
+    m_logger->debug("Waiting for {} cores and {} MiB", estimate.cores, estimate.memory >> 20);
+  }
+  m_released.wait(lock, [this, &estimate]{ return fits(estimate); });
+  m_used.cores += estimate.cores;
+  m_used.memory += estimate.memory;
+  ++m_running;
+  return {this, estimate};
+}
+
+optional<ResourceScheduler::Reservation> ResourceScheduler::try_acquire(Estimate estimate) {
+  lock_guard<mutex> lock(m_mutex);
+  if (!fits(estimate)) {
+    m_logger->info("Rejecting MPC run, {} cores and {} MiB in use by {} runs",
+        m_used.cores, m_used.memory >> 20, m_running);
+    return nullopt;
+  }
+  m_used.cores += estimate.cores;
+  m_used.memory += estimate.memory;
+  ++m_running;
+  return Reservation{this, estimate};
+}
+
+size_t ResourceScheduler::get_database_size(const RemoteId& remote_id) const {
+  lock_guard<mutex> lock(m_mutex);
+  const auto size{m_database_sizes.find(remote_id)};
+  return size != m_database_sizes.end() ? size->second : m_database_size_hint;
+}
+
+void ResourceScheduler::set_database_size(const RemoteId& remote_id, size_t database_size) {
+  lock_guard<mutex> lock(m_mutex);
+  m_database_sizes[remote_id] = database_size;
+}
+
+// Needs m_mutex
+bool ResourceScheduler::fits(const Estimate& estimate) const {
+  if (!m_running) {
+    return true;
+  }
+  return m_used.cores + estimate.cores <= m_core_budget
+      && m_used.memory + estimate.memory <= m_memory_budget;
+}
+
+void ResourceScheduler::release(const Estimate& estimate) {
+  {
+    lock_guard<mutex> lock(m_mutex);
+    m_used.cores -= estimate.cores;
+    m_used.memory -= estimate.memory;
+    --m_running;
+  }
+  m_released.notify_all();
+}
+
+} // namespace sel
@@ -0,0 +1,103 @@
+/**
+\file    resourcescheduler.h
+\copyright SEL - Secure EpiLinker
+    Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published
+    by the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Affero General Public License for more details.
+    You should have received a copy of the GNU Affero General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+\brief Admission of MPC runs against global core and memory budgets
+*/
+
+#ifndef SEL_RESOURCESCHEDULER_H
+#define SEL_RESOURCESCHEDULER_H
+#pragma once
+
+#include "resttypes.h"
+#include "logger.h"
+#include "memory_model.h"
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace sel {
+
+/**
+ * Global admission control for all MPC runs of the daemon
+ *
+ * Client and server runs of all remotes reserve their estimated cores and
+ * memory before building a circuit. Client runs wait in their worker slot
+ * until enough resources are free, server runs are rejected when the budget
+ * is exhausted, so the client retries later instead of both sides holding
+ * resources while waiting for each other. A run larger than the whole budget
+ * is admitted once nothing else runs.
+ */
+class ResourceScheduler {
+  public:
+    struct Estimate {
+      size_t cores;
+      size_t memory; // bytes
+    };
+
+    // Releases its resources on destruction
+    class Reservation {
+      public:
+        Reservation(Reservation&&) noexcept;
+        Reservation& operator=(Reservation&&) noexcept;
+        ~Reservation();
+        Reservation(const Reservation&) = delete;
+        Reservation& operator=(const Reservation&) = delete;
+      private:
+        friend class ResourceScheduler;
+        Reservation(ResourceScheduler*, Estimate);
+        ResourceScheduler* m_scheduler;
+        Estimate m_estimate;
+    };
+
+    static ResourceScheduler& get();
+    static ResourceScheduler const& cget();
+
+    Estimate estimate_run(const CircuitConfig&, size_t num_records,
+        size_t database_size) const;
+    // Largest run against database_size records that fits the memory budget
+    size_t max_run_records(const CircuitConfig&, size_t database_size) const;
+    Reservation acquire(Estimate);
+    std::optional<Reservation> try_acquire(Estimate);
+
+    // Last database size reported by a remote, to estimate client runs
+    // before the remote is asked. databaseSizeHint until the remote answered.
+    size_t get_database_size(const RemoteId&) const;
+    void set_database_size(const RemoteId&, size_t);
+
+    ResourceScheduler(const ResourceScheduler&) = delete;
+    ResourceScheduler& operator=(const ResourceScheduler&) = delete;
+  protected:
+    ResourceScheduler();
+  private:
+    bool fits(const Estimate&) const;
+    void release(const Estimate&);
+
+    size_t m_core_budget;
+    size_t m_memory_budget;
+    MemoryModel m_memory_model;
+    size_t m_threads_per_run;
+    size_t m_database_size_hint;
+    Estimate m_used{0, 0};
+    size_t m_running{0};
+    mutable std::mutex m_mutex;
+    std::condition_variable m_released;
+    std::map<RemoteId, size_t> m_database_sizes;
+    std::shared_ptr<spdlog::logger> m_logger{get_logger(ComponentLogger::SERVER)};
+};
+
+} // namespace sel
+
+#endif /* end of include guard: SEL_RESOURCESCHEDULER_H */
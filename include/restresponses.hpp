@@ -21,8 +21,9 @@
 
 namespace sel{
   namespace responses{
-  inline SessionResponse server_initialized(Port port){
-    return{restbed::OK, "Connection Initialized", {{"Content-Length", "22"},{"Connection", "Close"}, {"SEL-Port", std::to_string(port)}}};
+  // One ABY server port per party pair, comma separated
+  inline SessionResponse server_initialized(const std::string& ports){
+    return{restbed::OK, "Connection Initialized", {{"Content-Length", "22"},{"Connection", "Close"}, {"SEL-Port", ports}}};
   }
   inline SessionResponse status_error(int status, std::string msg) {
   return {status, msg, {{"Content-Length", std::to_string(msg.length())},
@@ -24,10 +24,6 @@
 
 #include <future>
 #include <sstream>
-#include <curlpp/Easy.hpp>
-#include <curlpp/Infos.hpp>
-#include <curlpp/Options.hpp>
-#include <curlpp/cURLpp.hpp>
 using std::string;
 using std::runtime_error;
 
@@ -49,6 +45,26 @@ AuthenticationType str_to_authtype(const string& str) {
   throw runtime_error("Invalid Authentication Type");
 }
 
+JobPriority str_to_priority(const string& str) {
+  if (str == "interactive")
+    return JobPriority::INTERACTIVE;
+  else if (str == "batch")
+    return JobPriority::BATCH;
+  else if (str == "matching")
+    return JobPriority::MATCHING;
+  throw runtime_error("Invalid Job Priority: " + str);
+}
+
+WireFormat str_to_wire_format(const string& str) {
+  if (str == "json")
+    return WireFormat::JSON;
+  else if (str == "cbor")
+    return WireFormat::CBOR;
+  else if (str == "msgpack")
+    return WireFormat::MSGPACK;
+  throw runtime_error("Invalid Wire Format: " + str);
+}
+
 string js_enum_to_string(JobStatus status) {
   switch (status) {
     case JobStatus::RUNNING: {
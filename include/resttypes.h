@@ -25,9 +25,12 @@
 #include <memory>
 #include <string>
 #include <set>
+#include <vector>
 
 #include "circuit_config.h" // for BooleanSharing
+#include "memory_model.h"
 #include <filesystem>
+#include <chrono>
 
 namespace sel {
 
@@ -42,9 +45,16 @@ using Port = uint16_t;
 enum class AlgorithmType { EPILINK };
 enum class AuthenticationType { NONE, API_KEY };
 enum class JobStatus { QUEUED, RUNNING, HOLD, FAULT, DONE };
+// Scheduling classes of the per-remote job queue, in descending priority
+enum class JobPriority { INTERACTIVE, BATCH, MATCHING };
+constexpr size_t num_job_priorities{3};
+// Encodings of request and result bodies, JSON unless negotiated otherwise
+enum class WireFormat { JSON, CBOR, MSGPACK };
 
 AlgorithmType str_to_atype(const std::string& str);
 AuthenticationType str_to_authtype(const std::string& str);
+JobPriority str_to_priority(const std::string& str);
+WireFormat str_to_wire_format(const std::string& str);
 std::string js_enum_to_string(JobStatus);
 
 struct SessionResponse {
@@ -53,22 +63,76 @@ struct SessionResponse {
   std::multimap<std::string, std::string> headers;
 };
 
+// Limits of outbound HTTP transfers
+struct HttpTimeouts {
+  std::chrono::milliseconds connect{10000};
+  std::chrono::milliseconds total{0}; // 0 waits forever
+  // Aborts transfers that move less than a byte per second for this long,
+  // 0 disables the check
+  std::chrono::seconds low_speed{60};
+};
+
+/**
+ * One job's part of a (coalesced) MPC run, transmitted in the Record-Partition
+ * and Job-Ids headers. Continued parts are chunks of a larger job, their
+ * result is held back until the job's last chunk has run.
+ */
+struct RecordPart {
+  size_t num_records;
+  JobId job_id;
+  bool continued{false};
+};
+
+/**
+ * Position of a streamed partial result within its job. The chunk with
+ * complete set is the job's last one.
+ */
+struct ResultChunk {
+  JobId job_id;
+  size_t offset;
+  bool complete;
+};
+
 struct ServerConfig {
   std::filesystem::path local_init_schema_file;
   std::filesystem::path remote_init_schema_file;
   std::filesystem::path link_record_schema_file;
+  std::filesystem::path link_records_schema_file;
   std::filesystem::path ssl_key_file;
   std::filesystem::path ssl_cert_file;
   std::filesystem::path ssl_dh_file;
   std::filesystem::path log_file;
   std::filesystem::path circuit_directory;
+  std::filesystem::path delivery_queue_file;
   bool use_ssl;
   bool use_circuit_conversion;
   Port server_port;
   std::string bind_address;
   size_t rest_worker;
   size_t default_page_size;
+  std::chrono::seconds job_retention;
+  size_t executor_threads;
+  size_t executor_max_blocking;
+  size_t ingest_chunk_size;
+  HttpTimeouts http_timeouts;
   uint32_t aby_threads;
+  // Every remote takes this many abyPorts, which bounds the number of remotes
+  size_t aby_parties_per_remote;
+  size_t coalesce_max_records;
+  std::chrono::milliseconds coalesce_window;
+  bool strict_priority;
+  std::vector<size_t> priority_weights;
+  size_t job_chunk_records;
+  size_t scheduler_cores;
+  size_t scheduler_memory_mb;
+  size_t database_size_hint; // 0 if unknown
+  MemoryModel memory_model;
+  size_t delivery_max_attempts;
+  std::chrono::milliseconds delivery_backoff;
+  size_t delivery_max_pending; // 0 is unbounded
+  bool stream_results;
+  WireFormat wire_format;
+  size_t trace_buffer_events; // 0 disables tracing
   BooleanSharing boolean_sharing;
   std::set<Port> avaliable_aby_ports;
 };
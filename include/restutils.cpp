@@ -8,10 +8,8 @@
 #include "logger.h"
 #include "localconfiguration.h"
 #include "remoteconfiguration.h"
-#include <curlpp/Easy.hpp>
-#include <curlpp/Infos.hpp>
-#include <curlpp/Options.hpp>
-#include <curlpp/cURLpp.hpp>
+#include "httpclient.h"
+#include "configurationhandler.h"
 #include <tuple>
 #include <map>
 #include <iostream>
@@ -66,6 +64,7 @@ void test_server_config_paths(const ServerConfig& config) {
   throw_if_nonexisting_file(config.local_init_schema_file);
   throw_if_nonexisting_file(config.remote_init_schema_file);
   throw_if_nonexisting_file(config.link_record_schema_file);
+  throw_if_nonexisting_file(config.link_records_schema_file);
   throw_if_nonexisting_file(config.ssl_key_file);
   throw_if_nonexisting_file(config.ssl_cert_file);
   throw_if_nonexisting_file(config.ssl_dh_file);
@@ -73,6 +72,24 @@ void test_server_config_paths(const ServerConfig& config) {
   throw_if_nonexisting_file(config.circuit_directory);
 }
 
+MemoryModel parse_json_memory_model(const nlohmann::json& json) {
+  const MemoryModel defaults;
+  return {json.value("booleanGateBytes", defaults.boolean_gate_bytes),
+          json.value("arithmeticGateBytes", defaults.arithmetic_gate_bytes),
+          json.value("conversionBitBytes", defaults.conversion_bit_bytes),
+          get_optional_result<size_t>(json,"baseMB", defaults.base_bytes >> 20) << 20};
+}
+
+HttpTimeouts parse_json_http_timeouts(const nlohmann::json& json) {
+  const HttpTimeouts defaults;
+  return {chrono::milliseconds{get_optional_result<size_t>(json,"httpConnectTimeoutMs",
+              defaults.connect.count())},
+          chrono::milliseconds{get_optional_result<size_t>(json,"httpTimeoutMs",
+              defaults.total.count())},
+          chrono::seconds{get_optional_result<size_t>(json,"httpLowSpeedSeconds",
+              defaults.low_speed.count())}};
+}
+
 ServerConfig parse_json_server_config(const nlohmann::json& json) {
   BooleanSharing boolean_sharing;
   string sharing_type{get_checked_result<string>(json,"booleanSharing")};
@@ -81,24 +98,87 @@ ServerConfig parse_json_server_config(const nlohmann::json& json) {
   transform(sharing_type.begin(), sharing_type.end(), sharing_type.begin(), ::toupper);
   boolean_sharing = (sharing_type == "YAO") ? BooleanSharing::YAO : BooleanSharing::GMW;
   auto aby_ports{get_checked_result<set<Port>>(json,"abyPorts")};
+  // By default two remotes fit, each with up to four party pairs
+  const auto default_parties{clamp<size_t>(aby_ports.size() / 2, 1, 4)};
+  const auto scheduling_policy{get_optional_result<string>(json,"schedulingPolicy", "weighted")};
+  if (scheduling_policy != "strict" && scheduling_policy != "weighted") {
+    throw runtime_error("schedulingPolicy must be either \"strict\" or \"weighted\"");
+  }
+  // Not brace-initialized, that would make it an array holding the object
+  const auto weights_json = json.count("priorityWeights")
+    ? json.at("priorityWeights") : nlohmann::json::object();
+  vector<size_t> priority_weights{
+    get_optional_result<size_t>(weights_json,"interactive", 8),
+    get_optional_result<size_t>(weights_json,"batch", 2),
+    get_optional_result<size_t>(weights_json,"matching", 1)};
+  const filesystem::path link_record_schema{get_checked_result<string>(json,"linkRecordSchemaPath")};
+  const filesystem::path log_file{get_checked_result<string>(json,"logFilePath")};
   ServerConfig result{get_checked_result<string>(json,"localInitSchemaPath"),
           get_checked_result<string>(json,"remoteInitSchemaPath"),
-          get_checked_result<string>(json,"linkRecordSchemaPath"),
+          link_record_schema,
+          get_optional_result<string>(json,"linkRecordsSchemaPath",
+              filesystem::path{link_record_schema}.replace_filename("linkrecords-schema.json").string()),
           get_checked_result<string>(json,"serverKeyPath"),
           get_checked_result<string>(json,"serverCertificatePath"),
           get_checked_result<string>(json,"serverDHPath"),
-          get_checked_result<string>(json,"logFilePath"),
+          log_file,
           get_checked_result<string>(json,"circuitDirectory"),
+          get_optional_result<string>(json,"deliveryQueuePath",
+              filesystem::path{log_file}.replace_filename("pending-deliveries.jsonl").string()),
           get_checked_result<bool>(json,"useSSL"),
           get_checked_result<bool>(json,"useCircuitConversion"),
           get_checked_result<Port>(json,"port"),
           get_checked_result<string>(json,"bindAddress"),
           get_checked_result<size_t>(json,"restWorkerThreads"),
-          get_checked_result<size_t>(json,"defaultPageSize"),
+          get_optional_result<size_t>(json,"defaultPageSize", 25),
+          chrono::seconds{get_optional_result<size_t>(json,"jobRetentionSeconds", 3600)},
+          get_optional_result<size_t>(json,"executorThreads", 0),
+          get_optional_result<size_t>(json,"executorMaxBlockingThreads", 64),
+          get_optional_result<size_t>(json,"ingestChunkSize", 256),
+          parse_json_http_timeouts(json),
           get_checked_result<uint32_t>(json,"abyThreads"),
+          get_optional_result<size_t>(json,"abyPartiesPerRemote", default_parties),
+          get_optional_result<size_t>(json,"coalesceMaxRecords", 16),
+          chrono::milliseconds{get_optional_result<size_t>(json,"coalesceWindowMs", 0)},
+          scheduling_policy == "strict",
+          move(priority_weights),
+          get_optional_result<size_t>(json,"jobChunkRecords", 1000),
+          get_optional_result<size_t>(json,"schedulerCores", 0),
+          get_optional_result<size_t>(json,"schedulerMemoryMB", 8192),
+          get_optional_result<size_t>(json,"databaseSizeHint", 0),
+          parse_json_memory_model(json.count("memoryModel")
+              ? json.at("memoryModel") : nlohmann::json::object()),
+          get_optional_result<size_t>(json,"deliveryMaxAttempts", 8),
+          chrono::milliseconds{get_optional_result<size_t>(json,"deliveryBackoffMs", 1000)},
+          get_optional_result<size_t>(json,"deliveryMaxPending", 10000),
+          get_optional_result<bool>(json,"streamPartialResults", false),
+          str_to_wire_format(get_optional_result<string>(json,"wireFormat", "json")),
+          get_optional_result<size_t>(json,"traceBufferEvents", 0),
           boolean_sharing,
           aby_ports};
   test_server_config_paths(result);
+  if (!result.default_page_size) {
+    throw runtime_error("defaultPageSize must be positive");
+  }
+  if (!result.delivery_max_attempts) {
+    throw runtime_error("deliveryMaxAttempts must be positive");
+  }
+  if (!result.ingest_chunk_size) {
+    throw runtime_error("ingestChunkSize must be positive");
+  }
+  if (!result.aby_parties_per_remote
+      || result.aby_parties_per_remote > result.avaliable_aby_ports.size()) {
+    throw runtime_error("abyPartiesPerRemote must be between 1 and the number of abyPorts");
+  }
+  if (result.avaliable_aby_ports.size() / result.aby_parties_per_remote < 2) {
+    get_logger()->warn("{} abyPorts with {} parties per remote only serve {} remote(s)",
+        result.avaliable_aby_ports.size(), result.aby_parties_per_remote,
+        result.avaliable_aby_ports.size() / result.aby_parties_per_remote);
+  }
+  if (find(result.priority_weights.begin(), result.priority_weights.end(), 0)
+      != result.priority_weights.end()) {
+    throw runtime_error("priorityWeights must be positive");
+  }
   return result;
 }
 
@@ -111,61 +191,27 @@ unique_ptr<AuthenticationConfig> parse_json_auth_config(const nlohmann::json& j)
   return make_unique<AuthenticationConfig>(AuthenticationType::NONE);
 }
 
-stringstream send_curl(curlpp::Easy& request){
-  std::stringstream response;
-  request.setOpt(new curlpp::Options::WriteStream(&response));
-  request.perform();
-  return response;
+SessionResponse perform_post_request(string url, string data, list<string> headers){
+  return HttpClient::get().request(HttpMethod::POST, move(url), move(data), move(headers));
 }
 
-SessionResponse perform_post_request(string url, string data, list<string> headers, bool get_headers){
-  auto logger{get_logger()};
-  curlpp::Easy curl_request;
-  headers.emplace_back("Expect:");
-  headers.emplace_back("Content-Length: "s+to_string(data.length()));
-  curl_request.setOpt(new curlpp::Options::HttpHeader(headers));
-  curl_request.setOpt(new curlpp::Options::Url(url));
-  curl_request.setOpt(new curlpp::Options::Verbose(false));
-  curl_request.setOpt(new curlpp::Options::Post(true));
-  curl_request.setOpt(new curlpp::Options::PostFields(data.c_str()));
-  curl_request.setOpt(new curlpp::Options::PostFieldSize(data.size()));
-  curl_request.setOpt(new curlpp::Options::SslVerifyHost(false));
-  curl_request.setOpt(new curlpp::Options::SslVerifyPeer(false));
-  curl_request.setOpt(new curlpp::Options::Header(get_headers));
-  //this future trickery has to be done to properly wait for a reply
-  auto response_stream{async(send_curl,std::ref(curl_request))};
-  response_stream.wait();
-  auto responsecode = curlpp::Infos::ResponseCode::get(curl_request);
-  auto stream = response_stream.get();
-  return {static_cast<int>(responsecode), stream.str(),{}};
-}
-
-SessionResponse perform_get_request(string url, list<string> headers, bool get_headers){
-  auto logger{get_logger()};
-  curlpp::Easy curl_request;
-  headers.emplace_back("Expect:");
-  curl_request.setOpt(new curlpp::Options::HttpHeader(headers));
-  curl_request.setOpt(new curlpp::Options::Url(url));
-  curl_request.setOpt(new curlpp::Options::Verbose(false));
-  curl_request.setOpt(new curlpp::Options::HttpGet(true));
-  curl_request.setOpt(new curlpp::Options::SslVerifyHost(false));
-  curl_request.setOpt(new curlpp::Options::SslVerifyPeer(false));
-  curl_request.setOpt(new curlpp::Options::Header(get_headers));
-  //this future trickery has to be done to properly wait for a reply
-  auto response_stream{async(send_curl,std::ref(curl_request))};
-  response_stream.wait();
-  auto responsecode = curlpp::Infos::ResponseCode::get(curl_request);
-  auto stream = response_stream.get();
-  return {static_cast<int>(responsecode), stream.str(),{}};
-}
-
-  SessionResponse send_result_to_linkageservice(const vector<Result<CircUnit>>& share,
+SessionResponse perform_get_request(string url, list<string> headers){
+  return HttpClient::get().request(HttpMethod::GET, move(url), "", move(headers));
+}
+
+Delivery linkage_result_delivery(const vector<Result<CircUnit>>& share,
     optional<vector<string>> ids, const string& role,
     const shared_ptr<const LocalConfiguration>& local_config,
-    const shared_ptr<const RemoteConfiguration>& remote_config) {
+    const shared_ptr<const RemoteConfiguration>& remote_config,
+    const optional<ResultChunk>& chunk) {
   auto logger{get_logger()};
   nlohmann::json json_data;
   json_data["role"] = role;
+  if(chunk) {
+    json_data["jobId"] = chunk->job_id;
+    json_data["offset"] = chunk->offset;
+    json_data["complete"] = chunk->complete;
+  }
   nlohmann::json results;
   for(auto& result : share){
     results.push_back({{"match", result.match},
@@ -176,38 +222,101 @@ SessionResponse perform_get_request(string url, list<string> headers, bool get_h
 if(role=="server") {
   if(ids) {
     json_data["ids"] = ids.value();
-  } else {
+  } else if(!chunk || !chunk->offset) {
+    // Later chunks share the ids of the job's first chunk
     throw runtime_error("Missing IDs from server result");
   }
 }
-  auto data{json_data.dump()};
-  logger->trace("Data for linkage Service: {}",data);
-  list<string> headers{"Content-Type: application/json","Authorization: "s+remote_config->get_linkage_service()->authenticator.sign_transaction("")};
+  logger->trace("Data for linkage Service: {}",json_data.dump());
+  // Linkage services only get binary results if configured to accept them
+  const auto format{remote_config->get_linkage_service()->wire_format};
+  auto data{encode_body(json_data, format)};
+  list<string> headers{"Content-Type: "s + content_type(format),"Authorization: "s+remote_config->get_linkage_service()->authenticator.sign_transaction("")};
   string url = remote_config->get_linkage_service()->url+"/linkageResult/"+local_config->get_local_id()+'/'+remote_config->get_id();
-  logger->debug("Sending {} result to linkage service at {}", role, url);
-  auto response{perform_post_request(url, data, headers, false)};
-  logger->trace("Linkage service reply: {} - {}", response.return_code, response.body);
-  return response;
+  return {move(url), move(data), move(headers), "", {}, role + " result for " + remote_config->get_id()};
 }
-vector<string> get_headers(istream& is,const string& header){
-  vector<string> responsevec;
-  string line;
-  while(safeGetline(is,line)){
-    responsevec.emplace_back(line);
+
+optional<size_t> parse_header_number(const string& value){
+  const auto number{trim_copy(value)};
+  if(number.empty() || !all_of(number.begin(), number.end(), ::isdigit)){
+    return nullopt;
+  }
+  try{
+    return stoull(number);
+  } catch (const out_of_range&){
+    return nullopt;
   }
+}
+
+vector<string> get_headers(const SessionResponse& response, const string& header){
+  // Header names are case insensitive
+  auto lower{[](string str){
+    transform(str.begin(), str.end(), str.begin(), ::tolower);
+    return str;
+  }};
+  const auto name{lower(header)};
   vector<string> headers;
-  for(const auto& line : responsevec){
-    if(auto pos = line.find(header); pos != string::npos){
-      headers.emplace_back(line.substr(header.length()+2));
+  for(const auto& h : response.headers){
+    if(lower(h.first) == name){
+      headers.emplace_back(h.second);
     }
   }
   return headers;
 }
-vector<string> get_headers(const string& is,const string& header){
-  stringstream stream;
-  stream << is;
-  return get_headers(stream, header);
+
+string content_type(WireFormat format){
+  switch (format) {
+    case WireFormat::CBOR: return "application/cbor";
+    case WireFormat::MSGPACK: return "application/msgpack";
+    default: return "application/json";
+  }
+}
+
+WireFormat wire_format_of(const string& content_type){
+  auto media_type{trim_copy(content_type.substr(0, content_type.find(';')))};
+  transform(media_type.begin(), media_type.end(), media_type.begin(), ::tolower);
+  if(media_type.empty() || media_type == "application/json"){
+    return WireFormat::JSON;
+  } else if(media_type == "application/cbor"){
+    return WireFormat::CBOR;
+  } else if(media_type == "application/msgpack" || media_type == "application/x-msgpack"){
+    return WireFormat::MSGPACK;
   }
+  throw runtime_error("Unsupported content type: " + content_type);
+}
+
+string accepted_formats(WireFormat preferred){
+  if(preferred == WireFormat::JSON){
+    return content_type(WireFormat::JSON);
+  }
+  return content_type(preferred) + ", " + content_type(WireFormat::JSON) + ";q=0.5";
+}
+
+string encode_body(const nlohmann::json& data, WireFormat format){
+  vector<uint8_t> bytes;
+  switch (format) {
+    case WireFormat::CBOR: bytes = nlohmann::json::to_cbor(data); break;
+    case WireFormat::MSGPACK: bytes = nlohmann::json::to_msgpack(data); break;
+    default: return data.dump();
+  }
+  return {bytes.begin(), bytes.end()};
+}
+
+vector<Port> parse_port_list(const string& port_list){
+  vector<Port> ports;
+  for(const auto& port : split(port_list, ',')){
+    ports.emplace_back(stoul(trim_copy(port)));
+  }
+  return ports;
+}
+
+string assemble_port_list(const vector<Port>& ports){
+  string port_list;
+  for(const auto& port : ports){
+    port_list += (port_list.empty() ? "" : ",") + to_string(port);
+  }
+  return port_list;
+}
 
 string assemble_remote_url(RemoteConfiguration const *remote_config) {
   return remote_config->get_remote_scheme() + "://" + remote_config->get_remote_host() + ':' + to_string(remote_config->get_remote_signaling_port());
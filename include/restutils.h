@@ -21,14 +21,13 @@
 
 #include "resttypes.h"
 #include "circuit_config.h" // CircUnit
+#include "deliveryqueue.h"
 #include <memory>
 #include <optional>
 
-#include <future>
-#include <sstream>
+#include <list>
 
 #include <nlohmann/json.hpp>
-#include <curlpp/Easy.hpp>
 
 namespace sel {
 
@@ -51,23 +50,55 @@ T get_checked_result(const nlohmann::json& j, const std::string& field_name){
     throw std::runtime_error("Wrong type in config");
 }
 
+// Tuning keys may be left out of the config, they fall back to their default
+template <typename T>
+T get_optional_result(const nlohmann::json& j, const std::string& field_name, T default_value){
+  if(!j.count(field_name)){
+    return default_value;
+  }
+  return get_checked_result<T>(j, field_name);
+}
+
 template <> std::set<Port> get_checked_result<std::set<Port>>(const nlohmann::json& j, const std::string& field_name);
 
 void throw_if_nonexisting_file(const std::filesystem::path&);
 void test_server_config_paths(const ServerConfig&);
 
 ServerConfig parse_json_server_config(const nlohmann::json&);
+MemoryModel parse_json_memory_model(const nlohmann::json&);
+HttpTimeouts parse_json_http_timeouts(const nlohmann::json&);
 std::unique_ptr<AuthenticationConfig> parse_json_auth_config(const nlohmann::json&);
 
 std::string assemble_remote_url(const std::shared_ptr<const RemoteConfiguration>&);
 std::string assemble_remote_url(RemoteConfiguration const * );
-SessionResponse perform_post_request(std::string, std::string, std::list<std::string>, bool);
-SessionResponse perform_get_request(std::string, std::list<std::string>, bool);
-SessionResponse send_result_to_linkageservice(const std::vector<Result<CircUnit>>&, std::optional<std::vector<std::string> >,const std::string&,const std::shared_ptr<const LocalConfiguration>&,const std::shared_ptr<const RemoteConfiguration>&);
-std::vector<std::string> get_headers(std::istream& is,const std::string& header);
-std::vector<std::string> get_headers(const std::string&,const std::string& header);
+SessionResponse perform_post_request(std::string, std::string, std::list<std::string>);
+SessionResponse perform_get_request(std::string, std::list<std::string>);
+// Result share of a linkage run for the linkage service, to be queued on the
+// DeliveryQueue. Streamed partial results carry their chunk, server chunks
+// only carry the ids with the job's first chunk.
+Delivery linkage_result_delivery(const std::vector<Result<CircUnit>>&, std::optional<std::vector<std::string> >,const std::string&,const std::shared_ptr<const LocalConfiguration>&,const std::shared_ptr<const RemoteConfiguration>&, const std::optional<ResultChunk>& = std::nullopt);
+std::vector<std::string> get_headers(const SessionResponse&, const std::string& header);
+// Numbers in a peer's headers, nullopt if malformed
+std::optional<size_t> parse_header_number(const std::string&);
 
-std::stringstream send_curl(curlpp::Easy& request);
+std::string content_type(WireFormat);
+// Format of a Content-Type value, JSON if empty. Throws if unsupported.
+WireFormat wire_format_of(const std::string& content_type);
+// Accept header value preferring the given format, JSON as fallback
+std::string accepted_formats(WireFormat preferred);
+std::string encode_body(const nlohmann::json&, WireFormat);
+
+// Body may be a std::string or restbed::Bytes
+template <typename Body>
+nlohmann::json decode_body(const Body& body, WireFormat format) {
+  switch (format) {
+    case WireFormat::CBOR: return nlohmann::json::from_cbor(body.begin(), body.end());
+    case WireFormat::MSGPACK: return nlohmann::json::from_msgpack(body.begin(), body.end());
+    default: return nlohmann::json::parse(body.begin(), body.end());
+  }
+}
+std::vector<Port> parse_port_list(const std::string&);
+std::string assemble_port_list(const std::vector<Port>&);
 
 } // namespace sel
 #endif /* end of include guard: SEL_RESTUTILS_H */
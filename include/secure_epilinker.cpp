@@ -16,6 +16,7 @@
  \brief Encapsulation class for the secure epilink s2PC process
 */
 
+#include <chrono>
 #include <stdexcept>
 #include "fmt/format.h"
 using fmt::format;
@@ -26,6 +27,7 @@ using fmt::format;
 #include "util.h"
 #include "seltypes.h"
 #include "logger.h"
+#include "tracer.h"
 
 using namespace std;
 
@@ -52,6 +54,10 @@ SecureEpilinker::SecureEpilinker(ABYConfig config, CircuitConfig circuit_config)
       ->GetCircuitBuildRoutine())},
   acirc{dynamic_cast<ArithmeticCircuit*>(party->GetSharings()[S_ARITH]->GetCircuitBuildRoutine())},
   cfg{circuit_config}, selc{make_unique_circuit_builder(cfg, bcirc, ccirc, acirc)} {
+#ifdef SEL_STATS
+    gate_costs = make_unique<sel::aby::GateCostAttribution>(bcirc, ccirc, acirc);
+    selc->set_gate_costs(gate_costs.get());
+#endif
     get_logger()->debug("SecureEpilinker created.");
   }
 // TODO when ABY can separate circuit building/setup/online phases, we create
@@ -161,10 +167,15 @@ vector<Result<CircUnit>> SecureEpilinker::run_linkage() {
     run_setup_phase();
   }
 
+  const auto build_start = chrono::steady_clock::now();
   auto results = selc->build_linkage_circuit();
+  const chrono::duration<double, milli> build_time = chrono::steady_clock::now() - build_start;
   get_logger()->trace("Executing ABYParty Circuit...");
+  const auto exec_start_us = Tracer::now_us();
   party->ExecCircuit();
   get_logger()->trace("ABYParty Circuit executed.");
+  collect_run_stats(build_time.count());
+  trace_phases(exec_start_us);
 
   auto clear_results = transform_vec(results, [dice_prec=cfg.dice_prec](auto r){
         return to_clear_value(r, dice_prec);
@@ -187,10 +198,15 @@ CountResult<CircUnit> SecureEpilinker::run_count() {
     run_setup_phase();
 
   }
+  const auto build_start = chrono::steady_clock::now();
   auto results = selc->build_count_circuit();
+  const chrono::duration<double, milli> build_time = chrono::steady_clock::now() - build_start;
   get_logger()->trace("Executing ABYParty Circuit...");
+  const auto exec_start_us = Tracer::now_us();
   party->ExecCircuit();
   get_logger()->trace("ABYParty Circuit executed.");
+  collect_run_stats(build_time.count());
+  trace_phases(exec_start_us);
 
   auto clear_results = to_clear_value(results);
   state.reset(); // need to setup new circuit
@@ -205,10 +221,37 @@ void SecureEpilinker::State::reset() {
   input_set = false;
 }
 
+void SecureEpilinker::collect_run_stats(double circuit_build_ms) {
+  run_stats = {
+    circuit_build_ms,
+    party->GetTiming(P_SETUP),
+    party->GetTiming(P_ONLINE),
+    party->GetSentData(P_SETUP),
+    party->GetReceivedData(P_SETUP),
+    party->GetSentData(P_ONLINE),
+    party->GetReceivedData(P_ONLINE),
+    party->GetTotalGates(),
+    party->GetTotalDepth()
+  };
+}
+
+// ABY runs both phases in ExecCircuit, so their spans are recorded afterwards
+void SecureEpilinker::trace_phases(int64_t exec_start_us) const {
+  auto& tracer = Tracer::get();
+  if (!tracer.enabled()) return;
+  const auto setup_us = static_cast<int64_t>(run_stats.setup_ms * 1000);
+  tracer.record("setup phase", "aby", exec_start_us, setup_us);
+  tracer.record("online phase", "aby", exec_start_us + setup_us,
+      static_cast<int64_t>(run_stats.online_ms * 1000));
+}
+
 void SecureEpilinker::reset() {
   selc->reset();
   party->Reset();
   state.reset();
+#ifdef SEL_STATS
+  gate_costs->reset();
+#endif
 }
 
 #ifdef SEL_STATS
@@ -26,6 +26,7 @@
 #include "circuit_config.h"
 #ifdef SEL_STATS
 #include "aby/statsprinter.h"
+#include "aby/gatecost.h"
 #endif
 
 // ABY forward declarations
@@ -60,6 +61,19 @@ public:
     void reset();
   };
 
+  // Counters of the last run, collected from the ABYParty before its reset
+  struct RunStats {
+    double circuit_build_ms{0};
+    double setup_ms{0};
+    double online_ms{0};
+    uint64_t setup_sent{0};
+    uint64_t setup_received{0};
+    uint64_t online_sent{0};
+    uint64_t online_received{0};
+    uint64_t gates{0};
+    uint32_t depth{0};
+  };
+
   SecureEpilinker(ABYConfig aby_config, CircuitConfig circuit_config);
   ~SecureEpilinker();
 
@@ -107,8 +121,14 @@ public:
 
   State get_state();
 
+  const CircuitConfig& get_circuit_config() const { return cfg; }
+
+  const RunStats& get_run_stats() const { return run_stats; }
+
 #ifdef SEL_STATS
   sel::aby::StatsPrinter get_stats_printer();
+  // Gates of the last run by circuit builder stage, until reset()
+  const sel::aby::GateCostAttribution& get_gate_costs() const { return *gate_costs; }
 #endif
 
 private:
@@ -119,6 +139,9 @@ private:
   const CircuitConfig cfg;
 
   std::unique_ptr<CircuitBuilderBase> selc; // ~pimpl
+#ifdef SEL_STATS
+  std::unique_ptr<sel::aby::GateCostAttribution> gate_costs;
+#endif
 
   /*
    * Note that we currently maintain an outside-facing state that behaves as if
@@ -128,6 +151,10 @@ private:
    */
   State state;
 
+  RunStats run_stats;
+  void collect_run_stats(double circuit_build_ms);
+  void trace_phases(int64_t exec_start_us) const;
+
   /*
    * TODO It is currently not possible to build an ABY circuit without
    * specifying the inputs, as all circuits start with the InputGates. Hence,
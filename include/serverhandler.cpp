@@ -23,6 +23,7 @@
 #include "localconfiguration.h"
 #include "remoteconfiguration.h"
 #include "localserver.h"
+#include "datahandler.h"
 #include "restutils.h"
 #include "secure_epilinker.h"
 #include "connectionhandler.h"
@@ -30,34 +31,64 @@
 #include "seltypes.h"
 #include "resttypes.h"
 #include "logger.h"
+#include "executor.h"
+#include "jobregistry.h"
+#include "metrics.h"
+#include <algorithm>
 #include <tuple>
 #include <mutex>
+#include <thread>
+#include <future>
+#include <functional>
 #include <iterator>
 
 using namespace std;
 
 namespace sel {
 
-void run_job(const shared_ptr<LinkageJob>& job) {
-  assert (job->get_status() == JobStatus::QUEUED && "Only queued jobs can be run!");
-
+void run_job(const vector<shared_ptr<LinkageJob>>& jobs, SecureEpilinker& epilinker, Port aby_port) {
+  for (const auto& job : jobs) {
+    assert (job->get_status() == JobStatus::QUEUED && "Only queued jobs can be run!");
+  }
+  // Only linkage jobs are coalesced, matching jobs always come alone
+  const auto& job = jobs.front();
   const auto& remote_id = job->get_remote_id();
   bool matching_mode = ConfigurationHandler::cget()
       .get_remote_config(remote_id)->get_matching_mode();
   if (!job->is_counting_job()) {
-    job->run_linkage_job();
+    // Chunked jobs go back to the end of their queue, so jobs of other
+    // priority classes can run in between
+    for (const auto& unfinished_job : LinkageJob::run_linkage_jobs(jobs, epilinker, aby_port)) {
+      ServerHandler::get().enqueue_linkage_job(remote_id, unfinished_job);
+    }
   } else if(!matching_mode){
     throw runtime_error("Attempt to run matching job but matching mode not allowed for remote!");
   } else {
 #ifdef SEL_MATCHING_MODE
-    job->run_matching_job();
+    job->run_matching_job(epilinker, aby_port);
+    // Rejected by a busy remote
+    if (job->get_status() == JobStatus::QUEUED) {
+      ServerHandler::get().enqueue_linkage_job(remote_id, job);
+    }
 #else
     throw runtime_error("Attempt to run matching job but matching mode not compiled!");
 #endif
   }
 }
 
+// Must not read the configuration, it is created before it is set
+ServerHandler::ServerHandler() {
+  Metrics::get().add_collector([this](Metrics& metrics){
+      lock_guard<mutex> lock(m_party_mutex);
+      for (const auto& [remote_id, worker] : m_worker_threads) {
+        metrics.set("sel_queued_jobs", {{"remote", remote_id}}, worker.num_queued());
+      }});
+}
+
 ServerHandler::~ServerHandler() {
+  for (auto& worker_thread : m_worker_threads) {
+    worker_thread.second.interrupt();
+  }
   for (auto& worker_thread : m_worker_threads) {
     worker_thread.second.join();
   }
@@ -81,18 +112,54 @@ void ServerHandler::insert_client(RemoteId id) {
     m_logger->warn("Client created with matching mode allowed!");
   }
   auto server_config{config_handler.get_server_config()};
-  SecureEpilinker::ABYConfig aby_config{
-    MPCRole::CLIENT, remote_config->get_remote_host(),
-      remote_config->get_aby_port(), server_config.aby_threads};
-  m_logger->debug("Creating client on port {}, remote host: {}", aby_config.port, aby_config.host);
-  m_aby_clients.emplace(id, make_shared<SecureEpilinker>(aby_config,circuit_config));
+  // One client party per server port of the remote, each owned by a worker
+  // slot
+  vector<shared_ptr<SecureEpilinker>> clients;
+  vector<function<void()>> connectors;
+  vector<ParallelWorker<LinkageJob>::JobConsumer> slot_consumers;
+  for (const auto port : remote_config->get_aby_ports()) {
+    SecureEpilinker::ABYConfig aby_config{
+      MPCRole::CLIENT, remote_config->get_remote_host(),
+        port, server_config.aby_threads};
+    m_logger->debug("Creating client on port {}, remote host: {}", aby_config.port, aby_config.host);
+    auto client{make_shared<SecureEpilinker>(aby_config,circuit_config)};
+    slot_consumers.emplace_back([client, port](const vector<shared_ptr<LinkageJob>>& jobs){
+        run_job(jobs, *client, port);
+    });
+    connectors.emplace_back([client]{ client->connect(); });
+    clients.emplace_back(move(client));
+  }
+  connect_parties(connectors);
 
-  m_logger->debug("Creating worker thread for remote {}", id);
-  m_worker_threads.emplace(id, run_job);
-  connect_client(id);
+  m_logger->debug("Creating {} worker threads for remote {}", slot_consumers.size(), id);
+  lock_guard<mutex> lock(m_party_mutex);
+  m_aby_clients.emplace(id, move(clients));
+  // Queued linkage jobs are coalesced into one MPC run per slot
+  ParallelWorker<LinkageJob>::BatchPolicy batch_policy{
+    server_config.coalesce_max_records, server_config.coalesce_window,
+    [](const LinkageJob& job){ return !job.is_counting_job(); },
+    [](const LinkageJob& job){ return job.get_num_records(); }};
+  ParallelWorker<LinkageJob>::SchedulingPolicy scheduling_policy{
+    [](const LinkageJob& job){ return static_cast<size_t>(job.get_priority()); },
+    server_config.priority_weights, server_config.strict_priority};
+  m_worker_threads.try_emplace(id, slot_consumers, batch_policy, scheduling_policy);
 }
 
-void ServerHandler::insert_server(RemoteId id, RemoteAddress remote_address) {
+void ServerHandler::connect_parties(const vector<function<void()>>& connectors) const {
+  // Both sides connect their parties in parallel, so the order in which
+  // the remote accepts them does not matter. Runs inside a blocking executor
+  // task, so the connections get their own threads instead of waiting for
+  // further executor tasks.
+  vector<future<void>> connections;
+  for (const auto& connector : connectors) {
+    connections.emplace_back(async(launch::async, connector));
+  }
+  for (auto& connection : connections) {
+    connection.get();
+  }
+}
+
+void ServerHandler::insert_server(RemoteId id, std::vector<Port> ports) {
   const auto& config_handler{ConfigurationHandler::cget()};
   auto local_config{config_handler.get_local_config()};
   auto remote_config{config_handler.get_remote_config(id)};
@@ -101,79 +168,225 @@ void ServerHandler::insert_server(RemoteId id, RemoteAddress remote_address) {
     m_logger->warn("Server created with matching mode allowed!");
   }
   auto server_config{config_handler.get_server_config()};
-  SecureEpilinker::ABYConfig aby_config{
-    MPCRole::SERVER, ConfigurationHandler::cget().get_server_config().bind_address,
-      remote_address.port, server_config.aby_threads};
-  m_logger->debug("Creating server on port {}, bound to: {}\n", aby_config.port, aby_config.host);
-  m_server.emplace(id, make_shared<LocalServer>(id, aby_config, circuit_config));
-  get_local_server(id)->connect_server();
+  map<Port, shared_ptr<LocalServer>> servers;
+  vector<function<void()>> connectors;
+  for (const auto port : ports) {
+    SecureEpilinker::ABYConfig aby_config{
+      MPCRole::SERVER, server_config.bind_address,
+        port, server_config.aby_threads};
+    m_logger->debug("Creating server on port {}, bound to: {}\n", aby_config.port, aby_config.host);
+    auto server{make_shared<LocalServer>(id, aby_config, circuit_config)};
+    connectors.emplace_back([server]{ server->connect_server(); });
+    servers.emplace(port, move(server));
+  }
+  {
+    lock_guard<mutex> lock(m_party_mutex);
+    m_server.emplace(id, move(servers));
+  }
+  connect_parties(connectors);
 }
 
 void ServerHandler::add_linkage_job(const RemoteId& remote_id, const std::shared_ptr<LinkageJob>& job){
+  JobRegistry::get().add(job);
+  enqueue_linkage_job(remote_id, job);
+}
+
+void ServerHandler::enqueue_linkage_job(const RemoteId& remote_id, const std::shared_ptr<LinkageJob>& job){
   const auto& config_handler = ConfigurationHandler::cget();
-  const auto job_id = job->get_id();
   if(config_handler.get_remote_config(remote_id)->get_mutual_initialization_status()) {
-    m_client_jobs.emplace(job_id, job);
-    m_worker_threads.at(remote_id).push(job);
+    lock_guard<mutex> lock(m_party_mutex);
+    m_worker_threads.at(remote_id).push_after(job, job->get_not_before());
   } else {
+    job->set_status(JobStatus::FAULT);
     m_logger->error("Can not create linkage job {}: Connection to remote "
-        "Secure EpiLinker {} is not properly initialized.", job_id, remote_id);
+        "Secure EpiLinker {} is not properly initialized.", job->get_id(), remote_id);
   }
 }
 
-shared_ptr<const LinkageJob> ServerHandler::get_linkage_job(const JobId& j_id) const {
-  return m_client_jobs.at(j_id);
+std::shared_ptr<LocalServer> ServerHandler::get_local_server(const RemoteId& remote_id, Port port) const {
+  lock_guard<mutex> lock(m_party_mutex);
+  const auto servers{m_server.find(remote_id)};
+  if (servers == m_server.end()) {
+    throw runtime_error("No MPC server for remote " + remote_id);
+  }
+  if (const auto server{servers->second.find(port)}; server != servers->second.end()) {
+    return server->second;
+  }
+  throw runtime_error("No MPC server for remote " + remote_id + " on port " + to_string(port));
 }
 
-string ServerHandler::get_job_status(const JobId& j_id) const {
-  if (j_id == "list"){ // Generate job status listing
-    nlohmann::json result;
-    for(const auto& job : m_client_jobs) {
-      result[job.first] = js_enum_to_string(job.second->get_status());
+Port ServerHandler::get_server_port(const RemoteId& remote_id) const {
+  lock_guard<mutex> lock(m_party_mutex);
+  const auto servers{m_server.find(remote_id)};
+  if (servers == m_server.end() || servers->second.empty()) {
+    throw runtime_error("No MPC server for remote " + remote_id);
+  }
+  return servers->second.begin()->first;
+}
+
+shared_ptr<const ServerData> ServerHandler::get_run_database(const RemoteId& remote_id,
+    const vector<RecordPart>& partition, bool counting_mode) {
+  const auto now{chrono::steady_clock::now()};
+  {
+    lock_guard<mutex> lock(m_chunked_jobs_mutex);
+    sweep_chunked_jobs(now);
+    if (auto pin{m_pinned_databases.find(remote_id)}; pin != m_pinned_databases.end()
+        && any_of(partition.begin(), partition.end(), [&pin](const RecordPart& part){
+          return part.continued || pin->second.jobs.count(part.job_id); })) {
+      track_chunked_jobs(pin->second, partition, now);
+      return pin->second.data;
     }
-    return result.dump();
-  } else { // get specific job status
-    return js_enum_to_string(get_linkage_job(j_id)->get_status());
   }
+  auto data{DataHandler::get().poll_database(remote_id, counting_mode)};
+  if (none_of(partition.begin(), partition.end(),
+        [](const RecordPart& part){ return part.continued; })) {
+    return data;
+  }
+  lock_guard<mutex> lock(m_chunked_jobs_mutex);
+  // Another run may have pinned a snapshot during the fetch
+  auto& pin{m_pinned_databases.try_emplace(remote_id, PinnedDatabase{move(data), {}})
+    .first->second};
+  track_chunked_jobs(pin, partition, now);
+  return pin.data;
+}
 
+void ServerHandler::track_chunked_jobs(PinnedDatabase& pin,
+    const vector<RecordPart>& partition, chrono::steady_clock::time_point now) {
+  for (const auto& part : partition) {
+    if (part.job_id.empty()) continue;
+    if (auto job{pin.jobs.find(part.job_id)}; job != pin.jobs.end()) {
+      job->second.last_run = now;
+    } else if (part.continued) {
+      pin.jobs.emplace(part.job_id, ChunkedJob{{}, 0, now});
+    }
+  }
 }
 
-Port ServerHandler::get_server_port(const RemoteId& id) const {
-  return m_server.at(id)->get_port();
+// Chunked jobs whose client stopped sending chunks are dropped after the job
+// retention
+void ServerHandler::sweep_chunked_jobs(chrono::steady_clock::time_point now) {
+  const auto retention{ConfigurationHandler::cget().get_server_config().job_retention};
+  for (auto pin = m_pinned_databases.begin(); pin != m_pinned_databases.end();) {
+    auto& jobs{pin->second.jobs};
+    for (auto job = jobs.begin(); job != jobs.end();) {
+      if (now - job->second.last_run > retention) {
+        m_logger->warn("Dropping chunked job {} of {}, no chunk within {}s",
+            job->first, pin->first, retention.count());
+        job = jobs.erase(job);
+      } else {
+        ++job;
+      }
+    }
+    pin = jobs.empty() ? m_pinned_databases.erase(pin) : next(pin);
+  }
 }
 
-shared_ptr<SecureEpilinker> ServerHandler::get_epilink_client(const RemoteId& remote_id){
-  return m_aby_clients.at(remote_id);
+void ServerHandler::abandon_run(const RemoteId& remote_id,
+    const vector<RecordPart>& partition) {
+  lock_guard<mutex> lock(m_chunked_jobs_mutex);
+  auto pin{m_pinned_databases.find(remote_id)};
+  if (pin == m_pinned_databases.end()) return;
+  for (const auto& part : partition) {
+    auto job{pin->second.jobs.find(part.job_id)};
+    if (job != pin->second.jobs.end() && job->second.partial_result.empty()
+        && !job->second.stream_offset) {
+      pin->second.jobs.erase(job);
+    }
+  }
+  if (pin->second.jobs.empty()) {
+    m_pinned_databases.erase(pin);
+  }
 }
 
-std::shared_ptr<LocalServer> ServerHandler::get_local_server(const RemoteId& remote_id) const {
-  return m_server.at(remote_id);
+void ServerHandler::release_chunked_jobs(const RemoteId& remote_id,
+    const vector<RecordPart>& partition) {
+  lock_guard<mutex> lock(m_chunked_jobs_mutex);
+  auto pin{m_pinned_databases.find(remote_id)};
+  if (pin == m_pinned_databases.end()) return;
+  for (const auto& part : partition) {
+    pin->second.jobs.erase(part.job_id);
+  }
+  if (pin->second.jobs.empty()) {
+    m_pinned_databases.erase(pin);
+  }
 }
 
-void ServerHandler::run_server(const RemoteId& remote_id,
+void ServerHandler::run_server(const RemoteId& remote_id, Port port,
                                std::shared_ptr<const ServerData> data,
-                               size_t num_records, bool counting_mode) {
+                               size_t num_records, const vector<RecordPart>& partition,
+                               bool counting_mode, bool stream_results,
+                               const std::shared_ptr<ServerReadiness>& readiness) {
   const auto& config_handler{ConfigurationHandler::cget()};
   auto remote_config{config_handler.get_remote_config(remote_id)};
   auto local_config{config_handler.get_local_config()};
-  if (remote_config->get_mutual_initialization_status()) {
+  try {
+    if (!remote_config->get_mutual_initialization_status()) {
+      throw runtime_error("Can not execute linkage job server: Connection to remote Secure "
+          "EpiLinker " + remote_id + " is not properly initialized");
+    }
     if (!counting_mode) {
-      get_local_server(remote_id)->run_linkage(move(data), num_records);
+      get_local_server(remote_id, port)->run_linkage(move(data), num_records, partition,
+                                                     stream_results, *readiness);
     } else if(remote_config->get_matching_mode()){ // Matching mode
-      get_local_server(remote_id)->run_count(move(data), num_records);
+      get_local_server(remote_id, port)->run_count(move(data), num_records, *readiness);
     } else {
-      m_logger->error("Matching mode not allowed for remote");
+      throw runtime_error("Matching mode not allowed for remote");
     }
-  } else {
-    m_logger->error(
-        "Can not execute linkage job server: Connection to remote Secure "
-        "EpiLinker {} is not properly initialized",
-        remote_id);
+  } catch (const exception& e) {
+    m_logger->error("Error running MPC server: {}", e.what());
+    release_chunked_jobs(remote_id, partition);
+    // Only reaches the waiting request if the run failed before being ready
+    readiness->signal_failure(current_exception());
   }
 }
 
-void ServerHandler::connect_client(const RemoteId& remote_id) {
-  m_aby_clients.at(remote_id)->connect();
+optional<vector<Result<CircUnit>>> ServerHandler::collect_server_result(
+    const RemoteId& remote_id, const RecordPart& part, vector<Result<CircUnit>>&& share) {
+  if (part.job_id.empty()) {
+    return move(share);
+  }
+  lock_guard<mutex> lock(m_chunked_jobs_mutex);
+  auto pin{m_pinned_databases.find(remote_id)};
+  if (pin == m_pinned_databases.end()) {
+    return move(share);
+  }
+  auto job{pin->second.jobs.find(part.job_id)};
+  if (job == pin->second.jobs.end()) {
+    return move(share);
+  }
+  auto& result{job->second.partial_result};
+  result.insert(result.end(), make_move_iterator(share.begin()), make_move_iterator(share.end()));
+  if (part.continued) {
+    return nullopt;
+  }
+  auto complete_result{move(result)};
+  pin->second.jobs.erase(job);
+  if (pin->second.jobs.empty()) {
+    m_pinned_databases.erase(pin);
+  }
+  return complete_result;
+}
+
+ResultChunk ServerHandler::next_result_chunk(const RemoteId& remote_id, const RecordPart& part) {
+  ResultChunk chunk{part.job_id, 0, !part.continued};
+  lock_guard<mutex> lock(m_chunked_jobs_mutex);
+  auto pin{m_pinned_databases.find(remote_id)};
+  if (pin == m_pinned_databases.end()) {
+    return chunk;
+  }
+  auto job{pin->second.jobs.find(part.job_id)};
+  if (job == pin->second.jobs.end()) {
+    return chunk;
+  }
+  chunk.offset = job->second.stream_offset;
+  job->second.stream_offset += part.num_records;
+  if (chunk.complete) {
+    pin->second.jobs.erase(job);
+    if (pin->second.jobs.empty()) {
+      m_pinned_databases.erase(pin);
+    }
+  }
+  return chunk;
 }
 
 }  // namespace sel
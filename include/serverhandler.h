@@ -23,17 +23,27 @@
 #include "seltypes.h"
 #include "resttypes.h"
 #include "connectionhandler.h"
-#include "serialworker.hpp"
+#include "parallelworker.hpp"
 #include "logger.h"
+#include "epilink_result.hpp"
+#include "circuit_config.h"
+#include <chrono>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
 
 namespace sel {
 
 class LinkageJob;
 class LocalServer;
+class ServerReadiness;
 class ConfigurationHandler;
 class DataHandler;
+struct ServerData;
 class SecureEpilinker;
 
 class ServerHandler {
@@ -41,23 +51,64 @@ class ServerHandler {
     static ServerHandler& get();
     static ServerHandler const& cget();
     void insert_client(RemoteId);
-    void insert_server(RemoteId, RemoteAddress);
+    void insert_server(RemoteId, std::vector<Port>);
     void add_linkage_job(const RemoteId&, const std::shared_ptr<LinkageJob>&);
-    std::shared_ptr<const LinkageJob> get_linkage_job(const JobId&) const;
-    std::string get_job_status(const JobId&) const;
-    std::shared_ptr<LocalServer> get_local_server(const RemoteId&) const;
+    void enqueue_linkage_job(const RemoteId&, const std::shared_ptr<LinkageJob>&);
+    std::shared_ptr<LocalServer> get_local_server(const RemoteId&, Port) const;
+    /**
+     * Database of a server run. All chunks of the remote's chunked client
+     * jobs run on one pinned snapshot, so a job never mixes database states.
+     * The snapshot is fetched anew once no chunked job is in progress.
+     */
+    std::shared_ptr<const ServerData> get_run_database(const RemoteId&,
+        const std::vector<RecordPart>&, bool counting_mode);
+    // Unpins the chunked jobs of a run that never started. Jobs with chunks
+    // already run stay pinned, the client retries the chunk.
+    void abandon_run(const RemoteId&, const std::vector<RecordPart>&);
+    // First server port of the remote, for clients not choosing a party pair
     Port get_server_port(const RemoteId&) const;
-    std::shared_ptr<SecureEpilinker> get_epilink_client(const RemoteId&);
-    void run_server(const RemoteId&, std::shared_ptr<const ServerData>, size_t, bool);
-    void connect_client(const RemoteId&);
+    void run_server(const RemoteId&, Port, std::shared_ptr<const ServerData>, size_t,
+                    const std::vector<RecordPart>&, bool counting_mode,
+                    bool stream_results, const std::shared_ptr<ServerReadiness>&);
+    /**
+     * Collects the server result share of one part of a linkage run. Returns
+     * the job's complete share once its last chunk arrived, nothing for
+     * continued jobs.
+     */
+    std::optional<std::vector<Result<CircUnit>>> collect_server_result(
+        const RemoteId&, const RecordPart&, std::vector<Result<CircUnit>>&&);
+    // Position of the part within its job, for streamed server results
+    ResultChunk next_result_chunk(const RemoteId&, const RecordPart&);
   protected:
-    ServerHandler() = default;
+    ServerHandler();
   private:
+    // Server side state of a client job linked in several chunks
+    struct ChunkedJob {
+      std::vector<Result<CircUnit>> partial_result;
+      size_t stream_offset;
+      std::chrono::steady_clock::time_point last_run;
+    };
+    struct PinnedDatabase {
+      std::shared_ptr<const ServerData> data;
+      std::map<JobId, ChunkedJob> jobs;
+    };
+
     ~ServerHandler();
-    std::map<RemoteId, std::shared_ptr<SecureEpilinker>> m_aby_clients;
-    std::map<RemoteId, std::shared_ptr<LocalServer>> m_server;
-    std::map<RemoteId, SerialWorker<LinkageJob>> m_worker_threads;
-    std::map<JobId, std::shared_ptr<LinkageJob>> m_client_jobs; // for status retrieval
+    void connect_parties(const std::vector<std::function<void()>>&) const;
+    // Need m_chunked_jobs_mutex
+    void track_chunked_jobs(PinnedDatabase&, const std::vector<RecordPart>&,
+                            std::chrono::steady_clock::time_point now);
+    void sweep_chunked_jobs(std::chrono::steady_clock::time_point now);
+    // Drops the chunks of a failed run, the client job fails as well
+    void release_chunked_jobs(const RemoteId&, const std::vector<RecordPart>&);
+    // One ABY party pair per port, the client parties are owned by the
+    // worker slots
+    std::map<RemoteId, std::vector<std::shared_ptr<SecureEpilinker>>> m_aby_clients;
+    std::map<RemoteId, std::map<Port, std::shared_ptr<LocalServer>>> m_server;
+    std::map<RemoteId, ParallelWorker<LinkageJob>> m_worker_threads;
+    mutable std::mutex m_party_mutex;
+    std::map<RemoteId, PinnedDatabase> m_pinned_databases;
+    std::mutex m_chunked_jobs_mutex;
     std::shared_ptr<spdlog::logger> m_logger{get_logger(ComponentLogger::SERVER)};
 };
 
@@ -0,0 +1,114 @@
+/**
+ \file    tracer.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Span tracing of linkage runs across both parties in Chrome trace format
+*/
+
+#include "tracer.h"
+#include <functional>
+
+using namespace std;
+
+namespace sel {
+
+namespace {
+thread_local string t_trace_id;
+
+// Small sequential thread ids read better in trace viewers
+uint32_t this_thread_id() {
+  static atomic<uint32_t> next_id{1};
+  thread_local const uint32_t id{next_id++};
+  return id;
+}
+} // namespace
+
+Tracer& Tracer::get() {
+  static Tracer singleton;
+  return singleton;
+}
+
+void Tracer::enable(size_t capacity, string process_name) {
+  lock_guard<mutex> lock(m_mutex);
+  m_events.clear();
+  m_events.reserve(capacity);
+  m_capacity = capacity;
+  m_next = 0;
+  // Distinguishes the parties when their exports are merged
+  m_process_id = hash<string>{}(process_name) & 0x7fffffff;
+  m_process_name = move(process_name);
+  m_enabled = capacity != 0;
+}
+
+void Tracer::record(const char* name, const char* category,
+                    int64_t start_us, int64_t duration_us) {
+  if (!enabled()) return;
+  Event event{name, category, t_trace_id, start_us, duration_us, this_thread_id()};
+  lock_guard<mutex> lock(m_mutex);
+  if (!m_capacity) return;
+  if (m_events.size() < m_capacity) {
+    m_events.emplace_back(move(event));
+  } else {
+    m_events[m_next] = move(event);
+  }
+  m_next = (m_next + 1) % m_capacity;
+}
+
+nlohmann::json Tracer::export_trace(const string& trace_id) const {
+  lock_guard<mutex> lock(m_mutex);
+  auto events = nlohmann::json::array();
+  events.push_back({{"name", "process_name"}, {"ph", "M"}, {"pid", m_process_id},
+                    {"args", {{"name", m_process_name}}}});
+  for (const auto& event : m_events) {
+    if (!trace_id.empty() && event.trace_id != trace_id) continue;
+    events.push_back({{"name", event.name}, {"cat", event.category}, {"ph", "X"},
+                      {"ts", event.start_us}, {"dur", event.duration_us},
+                      {"pid", m_process_id}, {"tid", event.thread},
+                      {"args", {{"traceId", event.trace_id}}}});
+  }
+  return {{"traceEvents", move(events)}, {"displayTimeUnit", "ms"}};
+}
+
+int64_t Tracer::now_us() {
+  return chrono::duration_cast<chrono::microseconds>(
+      chrono::system_clock::now().time_since_epoch()).count();
+}
+
+const string& Tracer::current_trace_id() {
+  return t_trace_id;
+}
+
+TraceScope::TraceScope(string trace_id) : m_previous{move(t_trace_id)} {
+  t_trace_id = move(trace_id);
+}
+
+TraceScope::~TraceScope() {
+  t_trace_id = move(m_previous);
+}
+
+TraceSpan::TraceSpan(const char* name, const char* category)
+  : m_name{name}, m_category{category} {
+  if (Tracer::get().enabled()) {
+    m_start_us = Tracer::now_us();
+    m_start = chrono::steady_clock::now();
+  }
+}
+
+TraceSpan::~TraceSpan() {
+  if (m_start_us < 0) return;
+  Tracer::get().record(m_name, m_category, m_start_us,
+      chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - m_start).count());
+}
+
+} // namespace sel
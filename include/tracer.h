@@ -0,0 +1,114 @@
+/**
+ \file    tracer.h
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Span tracing of linkage runs across both parties in Chrome trace format
+*/
+
+#ifndef SEL_TRACER_H
+#define SEL_TRACER_H
+#pragma once
+
+#include "nlohmann/json.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sel {
+
+/**
+ * Ring buffer of the most recent spans of this daemon
+ *
+ * Every span carries the trace id of its thread's current TraceScope. The
+ * client uses the job id as trace id and passes it on in the SEL-Trace-Id
+ * header of initMPC, so the spans of both parties of a run share it. Span
+ * start times are wall clock times, so the exports of both parties can be
+ * merged by concatenating their traceEvents.
+ *
+ * Tracing is disabled until enable() is called, spans then only cost a
+ * relaxed atomic load.
+ */
+class Tracer {
+  public:
+    static Tracer& get();
+
+    // Keeps the last capacity spans, 0 disables tracing
+    void enable(size_t capacity, std::string process_name);
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // name and category must be string literals
+    void record(const char* name, const char* category, int64_t start_us, int64_t duration_us);
+    // Chrome trace event JSON of the spans of one trace, of all spans if empty
+    nlohmann::json export_trace(const std::string& trace_id = "") const;
+
+    static int64_t now_us();
+    static const std::string& current_trace_id();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+  protected:
+    Tracer() = default;
+  private:
+    struct Event {
+      const char* name;
+      const char* category;
+      std::string trace_id;
+      int64_t start_us;
+      int64_t duration_us;
+      uint32_t thread;
+    };
+
+    std::atomic<bool> m_enabled{false};
+    std::string m_process_name;
+    uint32_t m_process_id{0};
+    std::vector<Event> m_events;
+    size_t m_capacity{0};
+    size_t m_next{0};
+    mutable std::mutex m_mutex;
+};
+
+/**
+ * Sets the trace id of the spans of the calling thread until destruction
+ */
+class TraceScope {
+  public:
+    explicit TraceScope(std::string trace_id);
+    ~TraceScope();
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+  private:
+    std::string m_previous;
+};
+
+/**
+ * Records its lifetime as a span, name and category must be string literals
+ */
+class TraceSpan {
+  public:
+    explicit TraceSpan(const char* name, const char* category = "sel");
+    ~TraceSpan();
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+  private:
+    const char* m_name;
+    const char* m_category;
+    int64_t m_start_us{-1};
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace sel
+
+#endif /* end of include guard: SEL_TRACER_H */
@@ -90,12 +90,17 @@ std::ostream& operator<< (std::ostream& out, const std::vector<uint8_t>& v) {
     return out;
 }
 
+/*
+ * 128 random bits in hex, so the ids of other jobs can not be guessed
+ */
 std::string generate_id(){
-  const auto timestamp{chrono::system_clock::now().time_since_epoch()};
-  std::string tempstring{
-      to_string(chrono::duration_cast<chrono::milliseconds>(timestamp).count())};
-  random_shuffle(tempstring.begin(), tempstring.end());
-  return tempstring;
+  thread_local random_device random;
+  stringstream id;
+  id << hex << setfill('0');
+  for (int i = 0; i != 4; ++i) {
+    id << setw(8) << random();
+  }
+  return id.str();
 }
 
 // safeGetline to handle \n or \r\n from Stackoverflow User user763305
@@ -18,6 +18,8 @@
 
 #include "validator.h"
 
+#include <stdexcept>
+#include <string>
 #include <tuple>
 #include "fmt/format.h"
 #include "nlohmann/json.hpp"
@@ -34,36 +36,99 @@ using valijson::ValidationResults;
 using valijson::adapters::NlohmannJsonAdapter;
 using namespace std;
 namespace sel {
-Validator::Validator() {
-  m_schema = "{}"_json;  // Accept everything
-}
+Validator::Validator() : Validator("{}"_json) {}  // Accept everything
 
-pair<bool, ValidationResults> Validator::validate_json(const json& data) const {
-  /**
-   * Validate JSON schema compatibility and data logic
-   */
+Validator::Validator(const json& schema)
+    : m_schema(schema), m_compiled_schema(compile_schema(m_schema)) {}
+
+Validator::~Validator() = default;
 
-  Schema json_schema;
+shared_ptr<const Schema> Validator::compile_schema(const json& schema) {
+  auto compiled = make_shared<Schema>();
   SchemaParser parser;
-  NlohmannJsonAdapter schema_doc(m_schema);
-  parser.populateSchema(schema_doc, json_schema);
+  NlohmannJsonAdapter schema_doc(schema);
+  parser.populateSchema(schema_doc, *compiled);
+  return compiled;
+}
 
+bool Validator::validate_against(const Schema& schema, const json& data,
+                                 ValidationResults* results) {
+  // valijson::Validator only holds per-validation state, the compiled schema
+  // is shared read-only
   valijson::Validator validator;
   NlohmannJsonAdapter doc(data);
-  ValidationResults results;
+  return validator.validate(schema, doc, results);
+}
 
-  if (!validator.validate(json_schema, doc, &results)) {
+pair<bool, ValidationResults> Validator::validate_json(const json& data) const {
+  /**
+   * Validate JSON schema compatibility and data logic
+   */
+  ValidationResults results;
+  if (!validate_against(*m_compiled_schema, data, &results)) {
     return make_pair(false, results);
   }
   return make_pair(logic_validation(data),
                    results);  // Does the data make sense?
 }
 
-bool Validator::logic_validation(const json& data) const {
+bool Validator::logic_validation(const json&) const {
   /**
    * Validata data logic
    */
   // TODO(TK) Write logic
   return true;
 }
+
+/**
+ * The envelope schema only checks that the records are an array, the records
+ * themselves are checked one by one against the record definition.
+ */
+static json make_envelope_schema(json schema, const string& records_key) {
+  schema.at("properties")[records_key] = {{"type", "array"}};
+  return schema;
+}
+
+/**
+ * The record definition keeps all definitions of the full schema, so
+ * references like "#/definitions/..." still resolve.
+ */
+static json make_record_schema(const json& schema, const string& record_definition) {
+  auto record_schema = schema.at("definitions").at(record_definition);
+  record_schema["definitions"] = schema.at("definitions");
+  return record_schema;
+}
+
+BatchValidator::BatchValidator(const json& schema,
+                               string records_key,
+                               const string& record_definition)
+    : Validator(make_envelope_schema(schema, records_key)),
+      m_records_key(move(records_key)),
+      m_record_schema(compile_schema(make_record_schema(schema, record_definition))) {}
+
+pair<bool, ValidationResults> BatchValidator::validate_json(const json& data) const {
+  auto validation = Validator::validate_json(data);
+  if (!validation.first || !data.count(m_records_key)) {
+    return validation;
+  }
+  const auto& records = data[m_records_key];
+  for (size_t i = 0; i != records.size(); ++i) {
+    ValidationResults record_results;
+    if (!validate_against(*m_record_schema, records[i], &record_results)) {
+      ValidationResults results;
+      ValidationResults::Error error;
+      while (record_results.popError(error)) {
+        vector<string> context{"<root>", "["s + m_records_key + ']',
+                               '[' + to_string(i) + ']'};
+        // drop the record's own "<root>"
+        if (!error.context.empty()) {
+          context.insert(context.end(), next(error.context.begin()), error.context.end());
+        }
+        results.pushError(context, error.description);
+      }
+      return make_pair(false, results);
+    }
+  }
+  return validation;
+}
 }  // namespace sel
@@ -22,20 +22,55 @@
 
 #include "nlohmann/json.hpp"
 #include "valijson/validation_results.hpp"
+#include <memory>
+#include <string>
 #include <tuple>
 
+namespace valijson {
+class Schema;
+}
+
 namespace sel {
 
+/**
+ * Validates JSON documents against a JSON schema.
+ *
+ * The schema is compiled once on construction and never changed afterwards,
+ * so a single Validator can be shared by all REST worker threads.
+ */
 class Validator {
  public:
-   Validator();
-   explicit Validator(const nlohmann::json& schema) : m_schema(schema) {}
-   std::pair<bool, valijson::ValidationResults> validate_json(const nlohmann::json& data) const;
-  void set_schema(const nlohmann::json& schema) {m_schema = schema;};
+  Validator();
+  explicit Validator(const nlohmann::json& schema);
+  virtual ~Validator();
+  virtual std::pair<bool, valijson::ValidationResults> validate_json(const nlohmann::json& data) const;
   const nlohmann::json& get_schema() const {return m_schema;}
- private:
+ protected:
+  static std::shared_ptr<const valijson::Schema> compile_schema(const nlohmann::json& schema);
+  static bool validate_against(const valijson::Schema&, const nlohmann::json&,
+                               valijson::ValidationResults*);
   bool logic_validation(const nlohmann::json& data) const;
+ private:
   nlohmann::json m_schema;
+  std::shared_ptr<const valijson::Schema> m_compiled_schema;
+};
+
+/**
+ * Validates batch documents (linkRecords, matchRecords)
+ *
+ * The envelope is validated without descending into the records array. Each
+ * record is then validated in place against the schema's record definition,
+ * stopping at the first invalid record.
+ */
+class BatchValidator : public Validator {
+ public:
+  explicit BatchValidator(const nlohmann::json& schema,
+                          std::string records_key = "records",
+                          const std::string& record_definition = "record");
+  std::pair<bool, valijson::ValidationResults> validate_json(const nlohmann::json& data) const override;
+ private:
+  std::string m_records_key;
+  std::shared_ptr<const valijson::Schema> m_record_schema;
 };
 
 }  // Namespace sel
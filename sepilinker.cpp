@@ -32,6 +32,9 @@
 #include "include/jsonhandlerfunctions.h"
 #include "include/headermethodhandler.h"
 #include "include/headerhandlerfunctions.h"
+#include "include/httpclient.h"
+#include "include/deliveryqueue.h"
+#include "include/tracer.h"
 
 #include "fmt/format.h"
 #include "nlohmann/json.hpp"
@@ -42,7 +45,6 @@
 #include <functional>
 #include <memory>
 #include <string>
-#include <curlpp/cURLpp.hpp>
 
 #include "include/logger.h"
 #include <spdlog/spdlog.h>
@@ -93,6 +95,7 @@ int main(int argc, char* argv[]) {
     ("i,localschema", "File name of local initialization schema", cxxopts::value<std::string>())
     ("I,remoteschema", "File name of remote initialization schema", cxxopts::value<std::string>())
     ("l,linkschema", "File name of linkRecord schema", cxxopts::value<std::string>())
+    ("linkrecordsschema", "File name of linkRecords schema", cxxopts::value<std::string>())
     ("L,logfile", "File name of log file", cxxopts::value<std::string>())
     ("k,key", "File name of server key", cxxopts::value<std::string>())
     ("v,verbose", "Log more information")
@@ -113,6 +116,7 @@ int main(int argc, char* argv[]) {
   config_override<std::string>(server_config, cmdoptions, "localschema", "LOCALSCHEMA", "localInitSchemaPath");
   config_override<std::string>(server_config, cmdoptions, "remoteschema", "REMOTESCHEMA", "remoteInitSchemaPath");
   config_override<std::string>(server_config, cmdoptions, "linkschema", "LINKSCHEMA", "linkRecordSchemaPath");
+  config_override<std::string>(server_config, cmdoptions, "linkrecordsschema", "LINKRECORDSSCHEMA", "linkRecordsSchemaPath");
   config_override<std::string>(server_config, cmdoptions, "key", "SELKEY", "serverKeyPath");
   config_override<std::string>(server_config, cmdoptions, "dh", "SELDHPARAM", "serverDHPath");
   config_override<std::string>(server_config, cmdoptions, "cert", "SELCERT", "serverCertificatePath");
@@ -137,7 +141,8 @@ int main(int argc, char* argv[]) {
   auto logger = get_logger();
 
   restbed::Service service;
-  curlpp::Cleanup curl_cleanup;
+  // Initializes libcurl before any other thread is started
+  sel::HttpClient::get();
   // Create Connection Handler
   auto& connections = sel::ConnectionHandler::get();
   connections.set_service(&service);
@@ -148,21 +153,36 @@ int main(int argc, char* argv[]) {
   try{
     configurations.set_server_config(parse_json_server_config(server_config));
     test_server_config_paths(configurations.get_server_config());
+    sel::HttpClient::get().set_timeouts(configurations.get_server_config().http_timeouts);
   } catch (const std::exception& e) {
     logger->critical("Can not create server configuration: {}", e.what());
     return EXIT_FAILURE;
   }
   connections.populate_aby_ports();
+  sel::Tracer::get().enable(configurations.get_server_config().trace_buffer_events,
+      fmt::format("SEL {}:{}", configurations.get_server_config().bind_address,
+                  configurations.get_server_config().server_port));
+  // Resumes deliveries still pending from the last run
+  sel::DeliveryQueue::get();
 
-  // Create JSON Validator
+  // Create JSON Validator. Schemas are compiled once here and shared by all
+  // REST workers.
   auto restconf{configurations.get_server_config()};
-  auto init_local_validator = std::make_shared<sel::Validator>(
-      read_json_from_disk(restconf.local_init_schema_file));
-  auto init_remote_validator = std::make_shared<sel::Validator>(
-      read_json_from_disk(restconf.remote_init_schema_file));
-  auto linkrecord_validator =
-      std::make_shared<sel::Validator>(read_json_from_disk(
-          restconf.link_record_schema_file));
+  std::shared_ptr<sel::Validator> init_local_validator, init_remote_validator,
+      linkrecord_validator, linkrecords_validator;
+  try {
+    init_local_validator = std::make_shared<sel::Validator>(
+        read_json_from_disk(restconf.local_init_schema_file));
+    init_remote_validator = std::make_shared<sel::Validator>(
+        read_json_from_disk(restconf.remote_init_schema_file));
+    linkrecord_validator = std::make_shared<sel::Validator>(
+        read_json_from_disk(restconf.link_record_schema_file));
+    linkrecords_validator = std::make_shared<sel::BatchValidator>(
+        read_json_from_disk(restconf.link_records_schema_file));
+  } catch (const std::exception& e) {
+    logger->critical("Can not compile JSON schemas: {}", e.what());
+    return EXIT_FAILURE;
+  }
   auto null_validator = std::make_shared<sel::Validator>();
   // Create Handlers for INIT Phase
   auto init_local_methodhandler =
@@ -179,6 +199,12 @@ int main(int argc, char* argv[]) {
   auto test_linkage_service_methodhandler =
       sel::MethodHandler::create_methodhandler<sel::HeaderMethodHandler>(
           "GET", sel::test_linkage_service);
+  auto metrics_methodhandler =
+      sel::MethodHandler::create_methodhandler<sel::HeaderMethodHandler>(
+          "GET", sel::get_metrics);
+  auto trace_methodhandler =
+      sel::MethodHandler::create_methodhandler<sel::HeaderMethodHandler>(
+          "GET", sel::get_trace);
   // Create Handlers for Record Linkage phase
   auto linkrecord_methodhandler =
       sel::MethodHandler::create_methodhandler<sel::JsonMethodHandler>(
@@ -186,16 +212,18 @@ int main(int argc, char* argv[]) {
           sel::valid_linkrecord_json_handler, sel::invalid_json_handler);
   auto linkrecords_methodhandler =
       sel::MethodHandler::create_methodhandler<sel::JsonMethodHandler>(
-          "POST", null_validator, // TODO(TK): Write json schema file for db linking
+          "POST", linkrecords_validator,
           sel::valid_linkrecords_json_handler, sel::invalid_json_handler);
 #ifdef SEL_MATCHING_MODE
+  // Match requests have the same layout as link requests, only the job type
+  // differs, so they share the validators
   auto matchrecord_methodhandler =
       sel::MethodHandler::create_methodhandler<sel::JsonMethodHandler>(
           "POST", linkrecord_validator,
           sel::valid_matchrecord_json_handler, sel::invalid_json_handler);
   auto matchrecords_methodhandler =
       sel::MethodHandler::create_methodhandler<sel::JsonMethodHandler>(
-          "POST", null_validator,
+          "POST", linkrecords_validator,
           sel::valid_matchrecords_json_handler, sel::invalid_json_handler);
 #endif
   // Create GET-Handler for job status monitoring
@@ -237,6 +265,12 @@ int main(int argc, char* argv[]) {
   // The jobid is provided in the url
   sel::ResourceHandler jobmonitor_handler{"/jobs/{job_id: .*}"};
   jobmonitor_handler.add_method(jobmonitor_methodhandler);
+  // Prometheus scrape target
+  sel::ResourceHandler metrics_handler{"/metrics"};
+  metrics_handler.add_method(metrics_methodhandler);
+  // Chrome trace JSON of one trace id, of all buffered spans without
+  sel::ResourceHandler trace_handler{"/trace/{parameter: .*}"};
+  trace_handler.add_method(trace_methodhandler);
   // Ressources for internal usage. Not exposed in public API
   sel::ResourceHandler test_config_handler{"/testConfig/{remote_id: .*}"};
   test_config_handler.add_method(test_config_methodhandler);
@@ -276,6 +310,8 @@ int main(int argc, char* argv[]) {
   matchrecords_handler.publish(service);
 #endif
   jobmonitor_handler.publish(service);
+  metrics_handler.publish(service);
+  trace_handler.publish(service);
   test_config_handler.publish(service);
   sellink_handler.publish(service);
 
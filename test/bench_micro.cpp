@@ -0,0 +1,252 @@
+/**
+ \file    bench_micro.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Microbenchmarks of the utility, parsing and clear linkage kernels
+*/
+
+#include "cxxopts.hpp"
+#include "fmt/format.h"
+#include "nlohmann/json.hpp"
+
+#include "../include/logger.h"
+#include "../include/util.h"
+#include "../include/base64.h"
+#include "../include/jsonutils.h"
+#include "../include/clear_epilinker.h"
+#include "random_input_generator.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <random>
+
+using namespace std;
+using fmt::print;
+using nlohmann::json;
+
+// Allocation counting for the whole binary
+namespace {
+atomic<size_t> alloc_count{0};
+atomic<size_t> alloc_bytes{0};
+} // namespace
+
+void* operator new(size_t size) {
+  alloc_count.fetch_add(1, memory_order_relaxed);
+  alloc_bytes.fetch_add(size, memory_order_relaxed);
+  if (auto p = malloc(size ? size : 1)) return p;
+  throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+namespace sel::test {
+
+constexpr double Threshold = 0.9;
+constexpr double TThreshold = 0.7;
+constexpr size_t BloomBits = 500;
+const vector<size_t> PageSizes{25, 1000, 10000};
+
+// Keeps the compiler from optimizing away the result
+template <typename T>
+void keep(T&& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+struct Measurement {
+  string name;
+  uint64_t ops;
+  double ns_per_op;
+  double records_per_s;
+  double bytes_per_s;
+  double allocs_per_op;
+  double alloc_bytes_per_op;
+};
+
+/**
+ * Runs op in doubling batches until a batch takes at least min_seconds.
+ * records and bytes are the amount of input one op processes.
+ */
+template <typename F>
+Measurement measure(const string& name, size_t records, size_t bytes,
+    double min_seconds, F&& op) {
+  op(); // warm-up
+  for (uint64_t ops = 1;; ops *= 2) {
+    const auto count_before = alloc_count.load(memory_order_relaxed);
+    const auto bytes_before = alloc_bytes.load(memory_order_relaxed);
+    const auto start = chrono::steady_clock::now();
+    for (uint64_t i = 0; i != ops; ++i) op();
+    const double seconds = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+    if (seconds < min_seconds) continue;
+    return {name, ops, seconds * 1e9 / ops,
+      records * ops / seconds, bytes * ops / seconds,
+      double(alloc_count.load(memory_order_relaxed) - count_before) / ops,
+      double(alloc_bytes.load(memory_order_relaxed) - bytes_before) / ops};
+  }
+}
+
+class Inputs {
+public:
+  Inputs() {
+    for (const auto n : PageSizes) {
+      auto page = json::array();
+      for (size_t i = 0; i != n; ++i) page.push_back(random_record_json());
+      pages.emplace(n, move(page));
+    }
+  }
+
+  Bitmask random_bloom() {
+    Bitmask bm(bitbytes(BloomBits));
+    for (auto& b : bm) b = random_byte(gen);
+    bm.back() &= (1 << (BloomBits % 8)) - 1;
+    return bm;
+  }
+
+  // Record of the dkfz config with base64 encoded bloom filters
+  json random_record_json() {
+    const auto bloom = [this] {
+      const auto bm = random_bloom();
+      return base64_encode(bm.data(), bm.size());
+    };
+    return {{"fields", {
+      {"vorname", bloom()},
+      {"nachname", bloom()},
+      {"geburtsname", bloom()},
+      {"geburtstag", uniform_int_distribution<>{1, 31}(gen)},
+      {"geburtsmonat", uniform_int_distribution<>{1, 12}(gen)},
+      {"geburtsjahr", uniform_int_distribution<>{1900, 2018}(gen)},
+      {"plz", fmt::format("{:05}", uniform_int_distribution<>{1067, 99998}(gen))},
+      {"ort", bloom()}
+    }}};
+  }
+
+  const EpilinkConfig cfg{make_dkfz_cfg(Threshold, TThreshold)};
+  map<size_t, json> pages;
+
+private:
+  mt19937 gen{73};
+  uniform_int_distribution<> random_byte{0, 0xff};
+};
+
+vector<Measurement> run_benchmarks(const string& filter, double min_seconds) {
+  Inputs in;
+  vector<Measurement> results;
+  const auto bench = [&](const string& name, size_t records, size_t bytes, auto&& op) {
+    if (name.find(filter) == string::npos) return;
+    results.emplace_back(measure(name, records, bytes, min_seconds, op));
+    const auto& m = results.back();
+    print("{:<40} {:>12.1f} {:>14.0f} {:>12.2f} {:>10.2f} {:>12.0f}\n", m.name,
+        m.ns_per_op, m.records_per_s, m.bytes_per_s / (1 << 20), m.allocs_per_op,
+        m.alloc_bytes_per_op);
+  };
+  print("{:<40} {:>12} {:>14} {:>12} {:>10} {:>12}\n", "benchmark", "ns/op",
+      "records/s", "MiB/s", "allocs/op", "alloc B/op");
+
+  const auto bloom_bytes = bitbytes(BloomBits);
+  const auto left = in.random_bloom(), right = in.random_bloom();
+  bench("hw/500bit", 1, bloom_bytes, [&] { keep(hw(left)); });
+  bench("bm_and/500bit", 1, 2*bloom_bytes, [&] { keep(bm_and(left, right)); });
+
+  vector<bool> bits(BloomBits);
+  for (size_t i = 0; i != BloomBits; ++i) bits[i] = (left[i/8] >> (i%8)) & 1;
+  bench("vector_bool_to_bitmask/500bit", 1, bloom_bytes,
+      [&] { keep(vector_bool_to_bitmask(bits)); });
+
+  for (const auto n : PageSizes) {
+    const vector<Bitmask> blooms(n, left);
+    bench(fmt::format("concat_vec/{}x500bit", n), n, n*bloom_bytes,
+        [&] { keep(concat_vec(blooms)); });
+    bench(fmt::format("repeat_vec/{}x500bit", n), n, n*bloom_bytes,
+        [&] { keep(repeat_vec(left, n)); });
+  }
+
+  const auto bloom_base64 = base64_encode(left.data(), left.size());
+  bench("base64_decode/500bit", 1, bloom_base64.size(),
+      [&] { keep(base64_decode(bloom_base64, BloomBits)); });
+
+  const auto& fields = in.cfg.fields;
+  const auto& record_fields = in.pages.at(PageSizes.front())[0].at("fields");
+  bench("parse_json_field/bitmask", 1, bloom_base64.size(), [&] {
+      keep(parse_json_field(fields.at("vorname"), record_fields.at("vorname"))); });
+  bench("parse_json_field/integer", 1, sizeof(int), [&] {
+      keep(parse_json_field(fields.at("geburtsjahr"), record_fields.at("geburtsjahr"))); });
+
+  // Bytes are those of the serialized page
+  for (const auto& [n, page] : in.pages) {
+    bench(fmt::format("parse_json_fields_array/dkfz/{}", n), n, page.dump().size(),
+        [&] { keep(parse_json_fields_array(fields, page)); });
+  }
+
+  bench("dice<CircUnit>/500bit", 1, 2*bloom_bytes,
+      [&] { keep(clear_epilink::dice<CircUnit>(left, right, 8)); });
+
+  const CircuitConfig circ_cfg{in.cfg};
+  const auto record = parse_json_fields(fields, record_fields);
+  for (const auto& [n, page] : in.pages) {
+    const auto database = parse_json_fields_array(fields, page);
+    bench(fmt::format("calc<CircUnit>/dkfz/{}", n), n, 0, [&] {
+        keep(clear_epilink::calc<CircUnit>({record, database}, circ_cfg)); });
+  }
+
+  return results;
+}
+
+} /* END namespace sel::test */
+
+using namespace sel;
+using namespace sel::test;
+
+int main(int argc, char *argv[])
+{
+  string filter;
+  double min_seconds = 0.5;
+  string json_filepath;
+
+  cxxopts::Options options{"bench_micro",
+    "Microbenchmarks of the utility, parsing and clear linkage kernels on "
+    "500 bit bloom filters and pages of dkfz records"};
+  options.add_options()
+    ("f,filter", "Only run benchmarks whose name contains this string",
+        cxxopts::value(filter))
+    ("t,min-time", "Minimum measured seconds per benchmark. Default 0.5",
+        cxxopts::value(min_seconds))
+    ("o,output", "Write the results as JSON to this file", cxxopts::value(json_filepath))
+    ("h,help", "Print help");
+  auto op = options.parse(argc, argv);
+
+  if (op["help"].as<bool>()) {
+    cout << options.help() << endl;
+    return 0;
+  }
+
+  create_terminal_logger();
+  spdlog::set_level(spdlog::level::warn);
+
+  const auto results = run_benchmarks(filter, min_seconds);
+
+  if (!json_filepath.empty()) {
+    auto report = json::array();
+    for (const auto& m : results) {
+      report.push_back({{"name", m.name}, {"ops", m.ops}, {"nsPerOp", m.ns_per_op},
+          {"recordsPerSecond", m.records_per_s}, {"bytesPerSecond", m.bytes_per_s},
+          {"allocsPerOp", m.allocs_per_op}, {"allocBytesPerOp", m.alloc_bytes_per_op}});
+    }
+    ofstream{json_filepath} << report.dump(2) << '\n';
+  }
+
+  return 0;
+}
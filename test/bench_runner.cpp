@@ -0,0 +1,112 @@
+/**
+ \file    bench_runner.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Runs both SecureEpilinker parties in one process for benchmarks
+*/
+
+#include "bench_runner.h"
+#include <chrono>
+#include <fstream>
+#include <future>
+
+using namespace std;
+using nlohmann::json;
+
+namespace sel::test {
+
+namespace {
+double ms_since(chrono::steady_clock::time_point start) {
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Runs one linkage as one party and returns its wall time in ms
+ */
+template <typename Input>
+double run_party(SecureEpilinker& linker, const EpilinkInput& in, const Input& input) {
+  const auto start = chrono::steady_clock::now();
+  linker.build_linkage_circuit(in.client.num_records, in.client.database_size);
+  linker.run_setup_phase();
+  linker.set_input(input);
+  linker.run_linkage();
+  const auto wall_ms = ms_since(start);
+  linker.reset();
+  return wall_ms;
+}
+
+unique_ptr<NetemProxy> make_proxy(const optional<NetworkProfile>& netem, uint16_t port) {
+  return netem ? make_unique<NetemProxy>(*netem, "127.0.0.1", port) : nullptr;
+}
+} // namespace
+
+json to_json(const BenchRun& r) {
+  return {
+    {"wallMs", r.wall_ms},
+    {"clientWallMs", r.client_wall_ms},
+    {"serverWallMs", r.server_wall_ms},
+    {"circuitBuildMs", r.stats.circuit_build_ms},
+    {"setupMs", r.stats.setup_ms},
+    {"onlineMs", r.stats.online_ms},
+    {"setupBytesSent", r.stats.setup_sent},
+    {"setupBytesReceived", r.stats.setup_received},
+    {"onlineBytesSent", r.stats.online_sent},
+    {"onlineBytesReceived", r.stats.online_received},
+    {"gates", r.stats.gates},
+    {"depth", r.stats.depth},
+    {"peakMemoryBytes", r.peak_memory}
+  };
+}
+
+size_t peak_memory() {
+  ifstream status{"/proc/self/status"};
+  string line;
+  while (getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return stoull(line.substr(6)) << 10; // reported in kB
+    }
+  }
+  throw runtime_error("Can not read peak memory from /proc/self/status");
+}
+
+void reset_peak_memory() {
+  ofstream{"/proc/self/clear_refs"} << "5";
+}
+
+PartyPair::PartyPair(const CircuitConfig& circ_cfg, uint16_t port,
+    uint32_t nthreads, const optional<NetworkProfile>& netem) :
+  proxy{make_proxy(netem, port)},
+  server{{MPCRole::SERVER, "127.0.0.1", port, nthreads}, circ_cfg},
+  client{{MPCRole::CLIENT, "127.0.0.1",
+    static_cast<uint16_t>(proxy ? proxy->port() : port), nthreads}, circ_cfg}
+{
+  auto server_connect = async(launch::async, [this] { server.connect(); });
+  client.connect();
+  server_connect.get();
+}
+
+BenchRun PartyPair::run_linkage(const EpilinkInput& in) {
+  reset_peak_memory();
+  const auto start = chrono::steady_clock::now();
+  auto server_run = async(launch::async,
+      [&] { return run_party(server, in, in.server); });
+  auto client_run = async(launch::async,
+      [&] { return run_party(client, in, in.client); });
+  const auto client_wall_ms = client_run.get();
+  const auto server_wall_ms = server_run.get();
+  // reset() of the client keeps the counters of the last run
+  return {ms_since(start), client_wall_ms, server_wall_ms,
+    client.get_run_stats(), peak_memory()};
+}
+
+} /* END namespace sel::test */
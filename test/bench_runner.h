@@ -0,0 +1,82 @@
+/**
+ \file    bench_runner.h
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Runs both SecureEpilinker parties in one process for benchmarks
+*/
+
+#ifndef SEL_TEST_BENCH_RUNNER_H
+#define SEL_TEST_BENCH_RUNNER_H
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "../include/secure_epilinker.h"
+#include "random_input_generator.h"
+#include "netem_proxy.h"
+
+namespace sel::test {
+
+/**
+ * Measurements of one linkage run, the MPC counters are the client's
+ */
+struct BenchRun {
+  double wall_ms;
+  double client_wall_ms;
+  double server_wall_ms;
+  SecureEpilinker::RunStats stats;
+  size_t peak_memory; // of both parties
+};
+
+nlohmann::json to_json(const BenchRun& run);
+
+/**
+ * Peak resident memory of the process since the last reset_peak_memory(), in
+ * bytes
+ */
+size_t peak_memory();
+void reset_peak_memory();
+
+template <typename T, typename F>
+double median(const std::vector<T>& runs, F value) {
+  std::vector<double> values;
+  std::transform(runs.cbegin(), runs.cend(), std::back_inserter(values), value);
+  std::sort(values.begin(), values.end());
+  const auto n = values.size();
+  return n % 2 ? values[n/2] : (values[n/2 - 1] + values[n/2]) / 2;
+}
+
+/**
+ * Connected server and client SecureEpilinker on loopback, the client
+ * optionally connecting through an emulated network
+ */
+class PartyPair {
+public:
+  PartyPair(const CircuitConfig& circ_cfg, uint16_t port, uint32_t nthreads,
+      const std::optional<NetworkProfile>& netem = std::nullopt);
+
+  // Runs a linkage of the input on both parties in parallel
+  BenchRun run_linkage(const EpilinkInput& in);
+
+private:
+  std::unique_ptr<NetemProxy> proxy;
+  SecureEpilinker server;
+  SecureEpilinker client;
+};
+
+} /* END namespace sel::test */
+
+#endif /* end of include guard: SEL_TEST_BENCH_RUNNER_H */
@@ -0,0 +1,271 @@
+/**
+ \file    bench_sel.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Benchmark of both SecureEpilinker parties in one process over loopback
+*/
+
+#include "cxxopts.hpp"
+#include "fmt/format.h"
+#include "nlohmann/json.hpp"
+
+#include "../include/logger.h"
+#include "bench_runner.h"
+#include "dataset_snapshot.h"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+using fmt::print, fmt::format;
+using nlohmann::json;
+
+namespace sel::test {
+
+shared_ptr<spdlog::logger> logger;
+
+constexpr double Threshold = 0.9;
+constexpr double TThreshold = 0.7;
+const filesystem::path CircDir = "../data/circ";
+
+/**
+ * One point of the benchmark grid
+ */
+struct BenchPoint {
+  size_t dbsize;
+  size_t nrecords;
+  size_t num_fields;
+  RunMode mode;
+  BooleanSharing sharing;
+  bool use_conversion;
+};
+
+string mode_name(RunMode mode) {
+  switch (mode) {
+    case RunMode::integer: return "integer";
+    case RunMode::bitmask: return "bitmask";
+    case RunMode::combined: return "combined";
+    default: return "dkfz";
+  }
+}
+
+string sharing_name(BooleanSharing sharing) {
+  return sharing == BooleanSharing::YAO ? "yao" : "gmw";
+}
+
+json point_json(const BenchPoint& p) {
+  return {
+    {"dbSize", p.dbsize},
+    {"numRecords", p.nrecords},
+    {"numFields", p.num_fields},
+    {"fieldMode", mode_name(p.mode)},
+    {"boolSharing", sharing_name(p.sharing)},
+    {"arithConversion", p.use_conversion}
+  };
+}
+
+json median_json(const vector<BenchRun>& runs) {
+  return {
+    {"wallMs", median(runs, [](auto& r){ return r.wall_ms; })},
+    {"circuitBuildMs", median(runs, [](auto& r){ return r.stats.circuit_build_ms; })},
+    {"setupMs", median(runs, [](auto& r){ return r.stats.setup_ms; })},
+    {"onlineMs", median(runs, [](auto& r){ return r.stats.online_ms; })},
+    {"peakMemoryBytes", median(runs, [](auto& r){ return r.peak_memory; })}
+  };
+}
+
+const string csv_header = "dbSize,numRecords,numFields,fieldMode,boolSharing,"
+  "arithConversion,repetition,wallMs,clientWallMs,serverWallMs,circuitBuildMs,"
+  "setupMs,onlineMs,setupBytesSent,setupBytesReceived,onlineBytesSent,"
+  "onlineBytesReceived,gates,depth,peakMemoryBytes\n";
+
+void print_csv_row(ostream& out, const BenchPoint& p, size_t rep, const BenchRun& r) {
+  print(out, "{},{},{},{},{},{},{},{:.3f},{:.3f},{:.3f},{:.3f},{:.3f},{:.3f},"
+      "{},{},{},{},{},{},{}\n",
+      p.dbsize, p.nrecords, p.num_fields, mode_name(p.mode),
+      sharing_name(p.sharing), p.use_conversion, rep,
+      r.wall_ms, r.client_wall_ms, r.server_wall_ms, r.stats.circuit_build_ms,
+      r.stats.setup_ms, r.stats.online_ms,
+      r.stats.setup_sent, r.stats.setup_received,
+      r.stats.online_sent, r.stats.online_received,
+      r.stats.gates, r.stats.depth, r.peak_memory);
+}
+
+/**
+ * Sweeps the grid. Each field, sharing and conversion setting gets its own
+ * pair of parties on its own port, which are then reused for all database
+ * sizes and numbers of records. With a dataset, its config and first records
+ * replace the generated fields and random inputs.
+ */
+json run_grid(const vector<size_t>& dbsizes, const vector<size_t>& nrecordss,
+    const vector<size_t>& num_fieldss, const vector<unsigned>& modes,
+    const vector<unsigned>& sharings, const vector<bool>& conversions,
+    size_t warmups, size_t repetitions, uint16_t port, uint32_t nthreads,
+    const optional<NetworkProfile>& netem, const Dataset* dataset, ostream* csv) {
+  auto points = json::array();
+  for (const auto num_fields : num_fieldss) {
+  for (const auto mode_num : modes) {
+  for (const auto sharing_num : sharings) {
+  for (const bool use_conversion : conversions) {
+    const auto mode = static_cast<RunMode>(mode_num);
+    const auto sharing = sharing_num ? BooleanSharing::YAO : BooleanSharing::GMW;
+    const auto cfg = dataset ? dataset->input.cfg
+      : make_benchmark_cfg(num_fields, mode, Threshold, TThreshold);
+    const CircuitConfig circ_cfg{cfg, CircDir, false, sharing, use_conversion};
+
+    PartyPair parties{circ_cfg, port++, nthreads, netem};
+
+    for (const auto dbsize : dbsizes) {
+    for (const auto nrecords : nrecordss) {
+      const BenchPoint point{dbsize, nrecords, num_fields, mode, sharing, use_conversion};
+      const auto in = dataset ? head(dataset->input, dbsize, nrecords)
+        : RandomInputGenerator{cfg}.generate(dbsize, nrecords);
+
+      for (size_t i = 0; i != warmups; ++i) parties.run_linkage(in);
+      vector<BenchRun> runs;
+      for (size_t i = 0; i != repetitions; ++i) {
+        runs.emplace_back(parties.run_linkage(in));
+        if (csv) print_csv_row(*csv, point, i, runs.back());
+      }
+
+      auto point_j = point_json(point);
+      logger->info("{}: median wall time {:.1f} ms", point_j.dump(),
+          median(runs, [](auto& r){ return r.wall_ms; }));
+      point_j["runs"] = json::array();
+      for (const auto& r : runs) point_j["runs"].push_back(to_json(r));
+      point_j["median"] = median_json(runs);
+      points.push_back(move(point_j));
+    }
+    }
+  }
+  }
+  }
+  }
+  return points;
+}
+
+} /* END namespace sel::test */
+
+using namespace sel;
+using namespace sel::test;
+
+int main(int argc, char *argv[])
+{
+  vector<size_t> dbsizes{100};
+  vector<size_t> nrecords{1};
+  vector<size_t> num_fields{1};
+  vector<unsigned> modes{3};
+  vector<unsigned> sharings{1};
+  vector<unsigned> conversions{0};
+  size_t warmups = 1;
+  size_t repetitions = 5;
+  uint16_t port = 5676;
+  uint32_t nthreads = 2; // 2 is ABYs default
+  string report_filepath{"bench_sel.json"};
+  string csv_filepath;
+  string netem_spec;
+  string dataset_filepath;
+
+  cxxopts::Options options{"bench_sel",
+    "Benchmark SEL linkage with both parties in one process over loopback. "
+    "List options take comma separated values and span the benchmark grid."};
+  options.add_options()
+    ("n,dbsize", "Database sizes. Default 100", cxxopts::value(dbsizes))
+    ("N,nrecords", "Numbers of client records. Default 1", cxxopts::value(nrecords))
+    ("num-fields", "Numbers of generated fields per type. Default 1",
+        cxxopts::value(num_fields))
+    ("M,mode", "Field modes: (0) dkfz fields, ignoring --num-fields, (1) integer "
+        "fields, (2) bitfield fields, (3) combined fields. Default 3",
+        cxxopts::value(modes))
+    ("s,sharing", "Boolean sharings. 0: GMW, 1: YAO. Default 1", cxxopts::value(sharings))
+    ("c,conversion", "Whether to convert to arithmetic space for "
+        "multiplications. 0: no, 1: yes. Default 0", cxxopts::value(conversions))
+    ("w,warmups", "Unmeasured runs per grid point. Default 1", cxxopts::value(warmups))
+    ("repetitions", "Measured runs per grid point. Default 5", cxxopts::value(repetitions))
+    ("p,port", "First loopback port, each party pair uses its own. Default 5676",
+        cxxopts::value(port))
+    ("t,threads", "ABY threads per party. Default 2", cxxopts::value(nthreads))
+    ("netem", "Emulate the network between the parties: lan, wan or "
+        "latency=ms,jitter=ms,bandwidth=Mbit/s,packet=bytes,seed=n",
+        cxxopts::value(netem_spec))
+    ("dataset", "Link the first records of this snapshot from gen_dataset "
+        "instead of random fields. Replaces --num-fields and --mode",
+        cxxopts::value(dataset_filepath))
+    ("o,output", "JSON report file. Default bench_sel.json", cxxopts::value(report_filepath))
+    ("csv", "Additionally write one CSV row per measured run to this file",
+        cxxopts::value(csv_filepath))
+    ("v,verbose", "Set verbosity. May be specified multiple times to log on "
+      "info/debug/trace level. Default level is warning.")
+    ("h,help", "Print help");
+  auto op = options.parse(argc, argv);
+
+  if (op["help"].as<bool>()) {
+    cout << options.help() << endl;
+    return 0;
+  }
+
+  create_terminal_logger();
+  switch(op.count("verbose")){
+    case 0: spdlog::set_level(spdlog::level::warn); break;
+    case 1: spdlog::set_level(spdlog::level::info); break;
+    case 2: spdlog::set_level(spdlog::level::debug); break;
+    default: spdlog::set_level(spdlog::level::trace); break;
+  }
+  logger = get_logger(ComponentLogger::TEST);
+
+  if (repetitions == 0) {
+    cout << "Need at least one repetition" << endl;
+    return 1;
+  }
+  optional<Dataset> dataset;
+  if (!dataset_filepath.empty()) {
+    dataset = read_snapshot(dataset_filepath);
+    num_fields = {dataset->input.cfg.fields.size()};
+    modes = {static_cast<unsigned>(RunMode::dkfz)};
+  }
+  for (const auto mode : modes) {
+    if (!dataset && mode > 3) {
+      cout << "Wrong field mode " << mode << "! Use 0, 1, 2 or 3" << endl;
+      return 1;
+    }
+  }
+
+  optional<NetworkProfile> netem;
+  if (!netem_spec.empty()) netem = parse_network_profile(netem_spec);
+
+  ofstream csv_file;
+  if (!csv_filepath.empty()) {
+    csv_file.open(csv_filepath);
+    csv_file << csv_header;
+  }
+
+  const vector<bool> use_conversions(conversions.cbegin(), conversions.cend());
+  const auto points = run_grid(dbsizes, nrecords, num_fields, modes, sharings,
+      use_conversions, warmups, repetitions, port, nthreads, netem,
+      dataset ? &*dataset : nullptr, csv_filepath.empty() ? nullptr : &csv_file);
+
+  const json report{
+    {"parameters", {
+      {"warmups", warmups},
+      {"repetitions", repetitions},
+      {"abyThreads", nthreads},
+      {"bitLength", BitLen},
+      {"network", netem_spec.empty() ? "loopback" : netem_spec},
+      {"dataset", dataset_filepath.empty() ? "random" : dataset_filepath}
+    }},
+    {"points", points}
+  };
+  ofstream{report_filepath} << report.dump(2) << '\n';
+
+  return 0;
+}
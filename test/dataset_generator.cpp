@@ -0,0 +1,284 @@
+/**
+ \file    dataset_generator.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Synthetic dkfz datasets with realistic errors and duplicates
+*/
+
+#include "dataset_generator.h"
+#include "../include/util.h"
+#include "fmt/format.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace sel::test {
+
+namespace {
+constexpr size_t NumFirstNames = 2000;
+constexpr size_t NumLastNames = 8000;
+constexpr size_t NumPlaces = 1500;
+constexpr size_t BloomHashes = 15;
+// Probability that the birth name equals the last name
+constexpr double SameBirthName = 0.7;
+
+const vector<string> syllables{"an", "be", "ber", "bach", "da", "de", "dorf",
+  "el", "en", "er", "fa", "feld", "ga", "ha", "hau", "hei", "ins", "ja", "ka",
+  "kel", "ko", "la", "le", "li", "lin", "ma", "man", "mer", "mi", "na", "ne",
+  "no", "ol", "pa", "ra", "re", "ri", "ro", "sa", "sch", "se", "sen", "stein",
+  "ta", "te", "ti", "to", "un", "va", "ve", "wa", "we", "wig", "zi"};
+
+const string letters{"abcdefghijklmnopqrstuvwxyz"};
+
+uint64_t fnv1a(const char* data, size_t size) {
+  uint64_t h = 0xcbf29ce484222325;
+  for (size_t i = 0; i != size; ++i) {
+    h ^= static_cast<uint8_t>(data[i]);
+    h *= 0x100000001b3;
+  }
+  return h;
+}
+
+uint64_t splitmix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+} // namespace
+
+Bitmask bloom_encode(const string& name, size_t bitsize) {
+  string padded = " " + name + " ";
+  transform(padded.begin(), padded.end(), padded.begin(),
+      [](unsigned char c) { return tolower(c); });
+  Bitmask bm(bitbytes(bitsize), 0);
+  for (size_t i = 0; i + 1 < padded.size(); ++i) {
+    const auto h1 = fnv1a(padded.data() + i, 2);
+    const auto h2 = splitmix64(h1) | 1;
+    for (size_t k = 0; k != BloomHashes; ++k) {
+      const auto bit = (h1 + k * h2) % bitsize;
+      bm[bit/8] |= 1 << (bit%8);
+    }
+  }
+  return bm;
+}
+
+DatasetGenerator::DatasetGenerator(DatasetParams params_) :
+  params{move(params_)}, cfg{make_dkfz_cfg(Threshold, TThreshold)},
+  gen{params.seed} {
+  if (params.max_cluster_size == 0) {
+    throw invalid_argument("Maximum cluster size must be at least 1");
+  }
+  for (const auto& [field, rate] : params.empty_rates) {
+    if (!cfg.fields.count(field)) {
+      throw invalid_argument("Empty rate for unknown field " + field);
+    }
+  }
+
+  // Duplicates in the pools only make some names more frequent
+  for (size_t i = 0; i != NumFirstNames; ++i) first_names.push_back(random_name(2, 3));
+  for (size_t i = 0; i != NumLastNames; ++i) last_names.push_back(random_name(2, 4));
+  uniform_int_distribution<> random_plz{1067, 99899};
+  for (size_t i = 0; i != NumPlaces; ++i) {
+    places.push_back(random_name(2, 4));
+    place_plz.push_back(random_plz(gen));
+  }
+
+  // All name fields of the dkfz config share one bitsize
+  const auto bitsize = cfg.fields.at("vorname").bitsize;
+  for (const auto pool : {&first_names, &last_names, &places}) {
+    for (const auto& name : *pool) {
+      if (!bloom_cache.count(name)) bloom_cache.emplace(name, bloom_encode(name, bitsize));
+    }
+  }
+}
+
+string DatasetGenerator::random_name(size_t min_syllables, size_t max_syllables) {
+  const auto n = uniform_int_distribution<size_t>{min_syllables, max_syllables}(gen);
+  string name;
+  for (size_t i = 0; i != n; ++i) {
+    name += syllables[uniform_int_distribution<size_t>{0, syllables.size()-1}(gen)];
+  }
+  name[0] = toupper(name[0]);
+  return name;
+}
+
+// Cubic skew, so the first tenth of a pool covers half of the samples, like
+// frequent names do
+size_t DatasetGenerator::skewed_index(size_t size) {
+  const auto u = uniform_real_distribution<>{0., 1.}(gen);
+  return min(static_cast<size_t>(size * u * u * u), size - 1);
+}
+
+bool DatasetGenerator::chance(double p) {
+  return p > 0 && bernoulli_distribution{min(p, 1.)}(gen);
+}
+
+DatasetGenerator::Person DatasetGenerator::random_person() {
+  Person p;
+  p.vorname = skewed_index(first_names.size());
+  p.nachname = skewed_index(last_names.size());
+  p.geburtsname = chance(SameBirthName) ? p.nachname : skewed_index(last_names.size());
+  p.ort = skewed_index(places.size());
+  p.tag = uniform_int_distribution<>{1, 28}(gen);
+  p.monat = uniform_int_distribution<>{1, 12}(gen);
+  p.jahr = uniform_int_distribution<>{1920, 2018}(gen);
+  p.plz = place_plz[p.ort] + uniform_int_distribution<>{0, 99}(gen);
+  return p;
+}
+
+DatasetGenerator::Entry DatasetGenerator::clean_entry(const Person& p) const {
+  return {first_names[p.vorname], last_names[p.nachname],
+    last_names[p.geburtsname], places[p.ort], p.tag, p.monat, p.jahr, p.plz};
+}
+
+string DatasetGenerator::typo(string s) {
+  const auto pos = uniform_int_distribution<size_t>{0, s.size()-1}(gen);
+  const auto letter = letters[uniform_int_distribution<size_t>{0, letters.size()-1}(gen)];
+  switch (uniform_int_distribution<>{0, 3}(gen)) {
+    case 0: s[pos] = letter; break;
+    case 1: if (s.size() > 1) s.erase(pos, 1); break;
+    case 2: s.insert(pos, 1, letter); break;
+    default: if (pos + 1 < s.size()) swap(s[pos], s[pos+1]); break;
+  }
+  return s;
+}
+
+DatasetGenerator::Entry DatasetGenerator::noisy_entry(const Person& p) {
+  auto e = clean_entry(p);
+  for (auto name : {&e.vorname, &e.nachname, &e.geburtsname, &e.ort}) {
+    if (chance(params.typo_rate)) *name = typo(*name);
+  }
+  if (chance(params.swap_rate)) swap(e.vorname, e.nachname);
+
+  const auto date_error_rate = params.typo_rate / 2;
+  if (chance(date_error_rate)) {
+    switch (uniform_int_distribution<>{0, 2}(gen)) {
+      case 0: // Day and month mixed up
+        if (e.tag <= 12) swap(e.tag, e.monat);
+        else e.tag = uniform_int_distribution<>{1, 28}(gen);
+        break;
+      case 1: e.monat = uniform_int_distribution<>{1, 12}(gen); break;
+      default: e.jahr += chance(.5) ? 1 : -1; break;
+    }
+  }
+  if (chance(date_error_rate)) {
+    static constexpr int powers[] = {1, 10, 100, 1000, 10000};
+    const auto power = powers[uniform_int_distribution<>{0, 4}(gen)];
+    const auto digit = (e.plz / power) % 10;
+    const auto new_digit = (digit + uniform_int_distribution<>{1, 9}(gen)) % 10;
+    e.plz += (new_digit - digit) * power;
+  }
+  return e;
+}
+
+bool DatasetGenerator::empty(const FieldName& field) {
+  const auto rate = params.empty_rates.find(field);
+  return rate != params.empty_rates.cend() && chance(rate->second);
+}
+
+FieldEntry DatasetGenerator::encode_name(const FieldName& field, const string& name) {
+  if (empty(field)) return nullopt;
+  if (const auto cached = bloom_cache.find(name); cached != bloom_cache.cend()) {
+    return cached->second;
+  }
+  // Not a pool name, misspelled names are mostly unique and not cached
+  return bloom_encode(name, cfg.fields.at(field).bitsize);
+}
+
+FieldEntry DatasetGenerator::encode_int(const FieldName& field, int value) {
+  if (empty(field)) return nullopt;
+  Bitmask bm(bitbytes(cfg.fields.at(field).bitsize), 0);
+  ::memcpy(bm.data(), &value, min(bm.size(), sizeof(int)));
+  return bm;
+}
+
+Record DatasetGenerator::to_record(const Entry& e) {
+  Record r;
+  r.emplace("vorname", encode_name("vorname", e.vorname));
+  r.emplace("nachname", encode_name("nachname", e.nachname));
+  r.emplace("geburtsname", encode_name("geburtsname", e.geburtsname));
+  r.emplace("ort", encode_name("ort", e.ort));
+  r.emplace("geburtstag", encode_int("geburtstag", e.tag));
+  r.emplace("geburtsmonat", encode_int("geburtsmonat", e.monat));
+  r.emplace("geburtsjahr", encode_int("geburtsjahr", e.jahr));
+  if (empty("plz")) {
+    r.emplace("plz", nullopt);
+  } else {
+    const auto plz = fmt::format("{:05}", e.plz);
+    r.emplace("plz", Bitmask(plz.cbegin(), plz.cend()));
+  }
+  return r;
+}
+
+void DatasetGenerator::append(VRecord& columns, const Entry& e) {
+  for (auto& [name, entry] : to_record(e)) {
+    columns.at(name).emplace_back(move(entry));
+  }
+}
+
+Dataset DatasetGenerator::generate() {
+  // Database slots as (person, is copy) in clusters, shuffled afterwards so
+  // that duplicates are spread over the database
+  vector<Person> persons;
+  vector<pair<uint64_t, bool>> slots;
+  slots.reserve(params.database_size);
+  while (slots.size() < params.database_size) {
+    const uint64_t id = persons.size();
+    persons.emplace_back(random_person());
+    auto cluster_size = chance(params.duplicate_rate) && params.max_cluster_size > 1
+      ? uniform_int_distribution<size_t>{2, params.max_cluster_size}(gen) : 1;
+    cluster_size = min(cluster_size, params.database_size - slots.size());
+    for (size_t i = 0; i != cluster_size; ++i) slots.emplace_back(id, i != 0);
+  }
+  shuffle(slots.begin(), slots.end(), gen);
+
+  auto database = make_shared<VRecord>();
+  for (const auto& [name, field] : cfg.fields) {
+    database->emplace(name, VFieldEntry{}).first->second.reserve(params.database_size);
+  }
+  vector<uint64_t> database_entities;
+  database_entities.reserve(params.database_size);
+  for (const auto& [id, copy] : slots) {
+    const auto& p = persons[id];
+    append(*database, copy ? noisy_entry(p) : clean_entry(p));
+    database_entities.push_back(id);
+  }
+
+  auto records = make_unique<Records>();
+  records->reserve(params.num_records);
+  vector<uint64_t> record_entities;
+  record_entities.reserve(params.num_records);
+  uint64_t next_id = persons.size();
+  for (size_t i = 0; i != params.num_records; ++i) {
+    if (!persons.empty() && chance(params.match_rate)) {
+      const auto id = uniform_int_distribution<size_t>{0, persons.size()-1}(gen);
+      records->emplace_back(to_record(noisy_entry(persons[id])));
+      record_entities.push_back(id);
+    } else {
+      records->emplace_back(to_record(noisy_entry(random_person())));
+      record_entities.push_back(next_id++);
+    }
+  }
+
+  EpilinkServerInput server{database, params.num_records};
+  EpilinkClientInput client{move(records), params.database_size};
+  return {{cfg, move(client), move(server)},
+    move(database_entities), move(record_entities)};
+}
+
+} /* END namespace sel::test */
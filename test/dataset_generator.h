@@ -0,0 +1,110 @@
+/**
+ \file    dataset_generator.h
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Synthetic dkfz datasets with realistic errors and duplicates
+*/
+
+#ifndef SEL_TEST_DATASET_GENERATOR_H
+#define SEL_TEST_DATASET_GENERATOR_H
+#pragma once
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "dataset_snapshot.h"
+
+namespace sel::test {
+
+struct DatasetParams {
+  size_t database_size{1000};
+  size_t num_records{1};
+  // Fraction of client records that are noisy copies of a database person
+  double match_rate{0.5};
+  // Fraction of database persons with further noisy copies in the database
+  double duplicate_rate{0.05};
+  // Maximum number of database records of one person
+  size_t max_cluster_size{3};
+  // Probability of a typo per name and place, half of that per date and plz
+  double typo_rate{0.1};
+  // Probability of swapped first and last name in a noisy copy
+  double swap_rate{0.02};
+  // Probability of an empty field, by field name
+  std::map<FieldName, double> empty_rates{{"geburtsname", 0.5}, {"ort", 0.1}};
+  uint32_t seed{73};
+};
+
+/**
+ * Generates persons from synthetic name pools for the dkfz config and encodes
+ * names and places as 500 bit bigram bloom filters, similar to the
+ * Mainzelliste. Noisy copies get typos (substitution, deletion, insertion or
+ * transposition of a character), which flip a few bloom filter bits, and swapped
+ * first and last names, which the exchange group has to undo. Every database and
+ * client record is labeled with its person id as ground truth.
+ *
+ * Clean encodings of the pool names are computed up front, so only erroneous
+ * names are hashed during generation.
+ */
+class DatasetGenerator {
+public:
+  explicit DatasetGenerator(DatasetParams params);
+
+  Dataset generate();
+
+  static constexpr double Threshold = 0.9;
+  static constexpr double TThreshold = 0.7;
+
+private:
+  struct Person {
+    size_t vorname, nachname, geburtsname, ort; // pool indices
+    int tag, monat, jahr;
+    int plz;
+  };
+  // Person with possibly misspelled names and wrong numbers
+  struct Entry {
+    std::string vorname, nachname, geburtsname, ort;
+    int tag, monat, jahr, plz;
+  };
+
+  const DatasetParams params;
+  const EpilinkConfig cfg;
+  std::mt19937_64 gen;
+  std::vector<std::string> first_names, last_names, places;
+  std::vector<int> place_plz; // lowest plz of each place
+  std::map<std::string, Bitmask> bloom_cache;
+
+  std::string random_name(size_t min_syllables, size_t max_syllables);
+  size_t skewed_index(size_t size);
+  bool chance(double p);
+
+  Person random_person();
+  Entry clean_entry(const Person& p) const;
+  Entry noisy_entry(const Person& p);
+  std::string typo(std::string s);
+  void append(VRecord& columns, const Entry& e);
+  Record to_record(const Entry& e);
+  FieldEntry encode_name(const FieldName& field, const std::string& name);
+  FieldEntry encode_int(const FieldName& field, int value);
+  bool empty(const FieldName& field);
+};
+
+/**
+ * Bigram bloom filter of the lower case, space padded name with 15 hash
+ * functions by double hashing
+ */
+Bitmask bloom_encode(const std::string& name, size_t bitsize);
+
+} /* END namespace sel::test */
+
+#endif /* end of include guard: SEL_TEST_DATASET_GENERATOR_H */
@@ -0,0 +1,260 @@
+/**
+ \file    dataset_snapshot.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Binary columnar snapshots of linkage datasets with ground truth
+*/
+
+#include "dataset_snapshot.h"
+#include "../include/util.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace sel::test {
+
+namespace {
+constexpr char Magic[] = "SELSNAP1";
+constexpr size_t MagicSize = sizeof(Magic) - 1;
+
+class Writer {
+public:
+  explicit Writer(const filesystem::path& path) : out{path, ios::binary} {
+    if (!out) throw runtime_error("Cannot write snapshot " + path.string());
+  }
+
+  template <typename T>
+  void pod(const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void bytes(const void* data, size_t size) {
+    out.write(static_cast<const char*>(data), size);
+  }
+
+  template <typename Size>
+  void str(const string& s) {
+    pod(static_cast<Size>(s.size()));
+    bytes(s.data(), s.size());
+  }
+
+  // Column of n entries, entry(i) returns the i-th FieldEntry
+  template <typename Entry>
+  void column(size_t n, size_t entry_bytes, Entry entry) {
+    vector<uint8_t> presence(bitbytes(n), 0);
+    vector<uint8_t> data(n * entry_bytes, 0);
+    for (size_t i = 0; i != n; ++i) {
+      const FieldEntry& e = entry(i);
+      if (!e) continue;
+      if (e->size() != entry_bytes) {
+        throw runtime_error("Snapshot: entry size does not match field bitsize");
+      }
+      presence[i/8] |= 1 << (i%8);
+      memcpy(data.data() + i * entry_bytes, e->data(), entry_bytes);
+    }
+    bytes(presence.data(), presence.size());
+    bytes(data.data(), data.size());
+  }
+
+  void close() {
+    out.close();
+    if (!out) throw runtime_error("Writing snapshot failed");
+  }
+
+private:
+  ofstream out;
+};
+
+class Reader {
+public:
+  explicit Reader(const filesystem::path& path) {
+    ifstream in{path, ios::binary | ios::ate};
+    if (!in) throw runtime_error("Cannot read snapshot " + path.string());
+    buf.resize(in.tellg());
+    in.seekg(0);
+    in.read(buf.data(), buf.size());
+  }
+
+  const char* take(size_t size) {
+    if (size > buf.size() - pos) throw runtime_error("Snapshot is truncated");
+    const auto p = buf.data() + pos;
+    pos += size;
+    return p;
+  }
+
+  // Throws unless n items of size bytes are left, without overflowing n * size
+  void expect(uint64_t n, size_t size) const {
+    if (size && n > (buf.size() - pos) / size) throw runtime_error("Snapshot is truncated");
+  }
+
+  template <typename T>
+  T pod() {
+    T value;
+    memcpy(&value, take(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  template <typename Size>
+  string str() {
+    const auto size = pod<Size>();
+    return {take(size), size};
+  }
+
+  VFieldEntry column(size_t n, size_t entry_bytes) {
+    expect(n, entry_bytes);
+    const auto presence = reinterpret_cast<const uint8_t*>(take(bitbytes(n)));
+    const auto data = reinterpret_cast<const uint8_t*>(take(n * entry_bytes));
+    VFieldEntry entries;
+    entries.reserve(n);
+    for (size_t i = 0; i != n; ++i) {
+      if (presence[i/8] & (1 << (i%8))) {
+        const auto entry = data + i * entry_bytes;
+        entries.emplace_back(in_place, entry, entry + entry_bytes);
+      } else {
+        entries.emplace_back(nullopt);
+      }
+    }
+    return entries;
+  }
+
+  bool done() const { return pos == buf.size(); }
+
+private:
+  vector<char> buf;
+  size_t pos{0};
+};
+} // namespace
+
+void write_snapshot(const filesystem::path& path, const Dataset& dataset) {
+  const auto& cfg = dataset.input.cfg;
+  const auto& database = *dataset.input.server.database;
+  const auto& records = *dataset.input.client.records;
+  const uint64_t database_size = dataset.input.server.database_size;
+  const uint64_t num_records = dataset.input.client.num_records;
+  if (dataset.database_entities.size() != database_size
+      || dataset.record_entities.size() != num_records) {
+    throw invalid_argument("Snapshot: ground truth does not match the input sizes");
+  }
+
+  Writer w{path};
+  w.bytes(Magic, MagicSize);
+  w.pod(cfg.threshold);
+  w.pod(cfg.tthreshold);
+  w.pod(static_cast<uint32_t>(cfg.fields.size()));
+  for (const auto& [name, field] : cfg.fields) {
+    w.str<uint16_t>(name);
+    w.pod(field.weight);
+    w.pod(static_cast<uint8_t>(field.comparator));
+    w.pod(static_cast<uint8_t>(field.type));
+    w.pod(static_cast<uint32_t>(field.bitsize));
+  }
+  w.pod(static_cast<uint32_t>(cfg.exchange_groups.size()));
+  for (const auto& group : cfg.exchange_groups) {
+    w.pod(static_cast<uint32_t>(group.size()));
+    for (const auto& name : group) w.str<uint16_t>(name);
+  }
+
+  w.pod(database_size);
+  w.pod(num_records);
+  for (const auto& [name, field] : cfg.fields) {
+    const auto& col = database.at(name);
+    w.column(database_size, bitbytes(field.bitsize),
+        [&col](size_t i) -> const FieldEntry& { return col[i]; });
+  }
+  for (const auto& [name, field] : cfg.fields) {
+    w.column(num_records, bitbytes(field.bitsize),
+        [&records, &name = name](size_t i) -> const FieldEntry& {
+          return records[i].at(name); });
+  }
+  w.bytes(dataset.database_entities.data(), database_size * sizeof(uint64_t));
+  w.bytes(dataset.record_entities.data(), num_records * sizeof(uint64_t));
+  w.close();
+}
+
+Dataset read_snapshot(const filesystem::path& path) {
+  Reader r{path};
+  if (memcmp(r.take(MagicSize), Magic, MagicSize)) {
+    throw runtime_error(path.string() + " is not a SEL snapshot");
+  }
+  const auto threshold = r.pod<double>();
+  const auto tthreshold = r.pod<double>();
+  map<FieldName, FieldSpec> fields;
+  const auto num_fields = r.pod<uint32_t>();
+  for (uint32_t i = 0; i != num_fields; ++i) {
+    auto name = r.str<uint16_t>();
+    const auto weight = r.pod<double>();
+    const auto comparator_num = r.pod<uint8_t>();
+    const auto type_num = r.pod<uint8_t>();
+    if (comparator_num > static_cast<uint8_t>(FieldComparator::BINARY)
+        || type_num > static_cast<uint8_t>(FieldType::INTEGER)) {
+      throw runtime_error("Snapshot: invalid comparator or type of field " + name);
+    }
+    const auto comparator = static_cast<FieldComparator>(comparator_num);
+    const auto type = static_cast<FieldType>(type_num);
+    const auto bitsize = r.pod<uint32_t>();
+    fields.emplace(name, FieldSpec{name, weight, comparator, type, bitsize});
+  }
+  const auto num_groups = r.pod<uint32_t>();
+  r.expect(num_groups, sizeof(uint32_t));
+  vector<IndexSet> exchange_groups(num_groups);
+  for (auto& group : exchange_groups) {
+    const auto size = r.pod<uint32_t>();
+    for (uint32_t i = 0; i != size; ++i) group.insert(r.str<uint16_t>());
+  }
+  EpilinkConfig cfg{move(fields), move(exchange_groups), threshold, tthreshold};
+
+  const auto database_size = r.pod<uint64_t>();
+  const auto num_records = r.pod<uint64_t>();
+  // Sizes are checked before allocating, at least the entities have to follow
+  r.expect(database_size, sizeof(uint64_t));
+  r.expect(num_records, sizeof(uint64_t));
+  auto database = make_shared<VRecord>();
+  for (const auto& [name, field] : cfg.fields) {
+    database->emplace(name, r.column(database_size, bitbytes(field.bitsize)));
+  }
+  auto records = make_unique<Records>(num_records);
+  for (const auto& [name, field] : cfg.fields) {
+    auto col = r.column(num_records, bitbytes(field.bitsize));
+    for (size_t i = 0; i != num_records; ++i) {
+      (*records)[i].emplace(name, move(col[i]));
+    }
+  }
+  vector<uint64_t> database_entities(database_size), record_entities(num_records);
+  memcpy(database_entities.data(), r.take(database_size * sizeof(uint64_t)),
+      database_size * sizeof(uint64_t));
+  memcpy(record_entities.data(), r.take(num_records * sizeof(uint64_t)),
+      num_records * sizeof(uint64_t));
+  if (!r.done()) throw runtime_error("Snapshot has trailing data");
+
+  EpilinkServerInput server{database, num_records};
+  EpilinkClientInput client{move(records), database_size};
+  return {{move(cfg), move(client), move(server)},
+    move(database_entities), move(record_entities)};
+}
+
+EpilinkInput head(const EpilinkInput& in, size_t database_size, size_t num_records) {
+  if (database_size > in.server.database_size || num_records > in.client.num_records) {
+    throw invalid_argument("Dataset is smaller than the requested input");
+  }
+  auto database = make_shared<VRecord>();
+  for (const auto& [name, col] : *in.server.database) {
+    database->emplace(name, VFieldEntry(col.cbegin(), col.cbegin() + database_size));
+  }
+  auto records = make_unique<Records>(in.client.records->cbegin(),
+      in.client.records->cbegin() + num_records);
+  return {in.cfg, {move(records), database_size}, {database, num_records}};
+}
+
+} /* END namespace sel::test */
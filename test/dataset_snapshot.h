@@ -0,0 +1,63 @@
+/**
+ \file    dataset_snapshot.h
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Binary columnar snapshots of linkage datasets with ground truth
+*/
+
+#ifndef SEL_TEST_DATASET_SNAPSHOT_H
+#define SEL_TEST_DATASET_SNAPSHOT_H
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include "random_input_generator.h"
+
+namespace sel::test {
+
+/**
+ * Linkage input with ground truth. Client record i and database record j
+ * belong to the same person iff record_entities[i] == database_entities[j].
+ */
+struct Dataset {
+  EpilinkInput input;
+  std::vector<uint64_t> database_entities;
+  std::vector<uint64_t> record_entities;
+};
+
+/**
+ * Snapshot layout, numbers in host byte order:
+ *   "SELSNAP1"
+ *   config: threshold, tthreshold (double), #fields (u32), per field: name
+ *     (u16 length + bytes), weight (double), comparator, type (u8), bitsize
+ *     (u32), #exchange groups (u32), per group: #names (u32) + names
+ *   database size, #records (u64)
+ *   database columns, then record columns, in field name order: presence
+ *     bitmap of ceil(n/8) bytes, then n entries of bitbytes(bitsize) bytes,
+ *     zero for empty entries
+ *   database entities, record entities (n x u64)
+ * A column is read with one contiguous read, so loading is bounded by the
+ * allocation of the entries.
+ */
+void write_snapshot(const std::filesystem::path& path, const Dataset& dataset);
+Dataset read_snapshot(const std::filesystem::path& path);
+
+/**
+ * Copy of the first database_size database and num_records client records
+ */
+EpilinkInput head(const EpilinkInput& in, size_t database_size, size_t num_records);
+
+} /* END namespace sel::test */
+
+#endif /* end of include guard: SEL_TEST_DATASET_SNAPSHOT_H */
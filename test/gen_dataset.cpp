@@ -0,0 +1,118 @@
+/**
+ \file    gen_dataset.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Generates a synthetic dkfz dataset snapshot for benchmarks
+*/
+
+#include "cxxopts.hpp"
+#include "fmt/format.h"
+
+#include "../include/logger.h"
+#include "dataset_generator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <set>
+
+using namespace std;
+using fmt::print;
+
+namespace sel::test {
+
+/**
+ * Parses field=rate
+ */
+pair<FieldName, double> parse_empty_rate(const string& spec) {
+  const auto eq = spec.find('=');
+  if (eq == string::npos) {
+    throw invalid_argument("Empty rate '" + spec + "' is not of the form field=rate");
+  }
+  return {spec.substr(0, eq), stod(spec.substr(eq + 1))};
+}
+
+void print_summary(const Dataset& d) {
+  const set<uint64_t> persons(d.database_entities.cbegin(), d.database_entities.cend());
+  size_t matches = 0;
+  for (const auto e : d.record_entities) matches += persons.count(e);
+  print("Database: {} records of {} persons\n", d.database_entities.size(), persons.size());
+  print("Client: {} records, {} with a match in the database\n",
+      d.record_entities.size(), matches);
+  for (const auto& [name, col] : *d.input.server.database) {
+    const auto empty = count(col.cbegin(), col.cend(), nullopt);
+    print("  {:<14} {:5.1f}% empty\n", name, col.empty() ? 0. : 100. * empty / col.size());
+  }
+}
+
+} /* END namespace sel::test */
+
+using namespace sel;
+using namespace sel::test;
+
+int main(int argc, char *argv[])
+{
+  DatasetParams params;
+  vector<string> empty_rates;
+  string output_filepath{"dataset.sel"};
+
+  cxxopts::Options options{"gen_dataset",
+    "Generate synthetic dkfz records with bloom filter encoded names, typos, "
+    "swapped names, empty fields and duplicates, together with the true person "
+    "of every record, and write them as a binary snapshot for bench_sel --dataset"};
+  options.add_options()
+    ("n,dbsize", "Database size. Default 1000", cxxopts::value(params.database_size))
+    ("N,nrecords", "Number of client records. Default 1",
+        cxxopts::value(params.num_records))
+    ("match-rate", "Fraction of client records of persons in the database. "
+        "Default 0.5", cxxopts::value(params.match_rate))
+    ("duplicate-rate", "Fraction of database persons with several records. "
+        "Default 0.05", cxxopts::value(params.duplicate_rate))
+    ("max-cluster-size", "Maximum records per database person. Default 3",
+        cxxopts::value(params.max_cluster_size))
+    ("typo-rate", "Typo probability per name in copies of a person, half of it "
+        "for dates and plz. Default 0.1", cxxopts::value(params.typo_rate))
+    ("swap-rate", "Probability of swapped first and last names in copies of a "
+        "person. Default 0.02", cxxopts::value(params.swap_rate))
+    ("e,empty-rate", "Probability of an empty field as field=rate. May be given "
+        "multiple times. Default geburtsname=0.5,ort=0.1", cxxopts::value(empty_rates))
+    ("seed", "PRNG seed. Default 73", cxxopts::value(params.seed))
+    ("o,output", "Snapshot file. Default dataset.sel", cxxopts::value(output_filepath))
+    ("h,help", "Print help");
+  auto op = options.parse(argc, argv);
+
+  if (op["help"].as<bool>()) {
+    cout << options.help() << endl;
+    return 0;
+  }
+
+  create_terminal_logger();
+  spdlog::set_level(spdlog::level::warn);
+
+  if (!empty_rates.empty()) {
+    params.empty_rates.clear();
+    for (const auto& spec : empty_rates) params.empty_rates.emplace(parse_empty_rate(spec));
+  }
+
+  const auto start = chrono::steady_clock::now();
+  const auto dataset = DatasetGenerator{params}.generate();
+  const auto generated = chrono::steady_clock::now();
+  write_snapshot(output_filepath, dataset);
+  const auto written = chrono::steady_clock::now();
+
+  print_summary(dataset);
+  print("Generated in {:.2f} s, wrote {} in {:.2f} s\n",
+      chrono::duration<double>(generated - start).count(), output_filepath,
+      chrono::duration<double>(written - generated).count());
+
+  return 0;
+}
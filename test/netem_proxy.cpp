@@ -0,0 +1,293 @@
+/**
+ \file    netem_proxy.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief In-process TCP proxy emulating latency, jitter and bandwidth
+*/
+
+#include "netem_proxy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+namespace sel::test {
+
+namespace {
+// Emulated socket buffer per direction. Reading blocks while this much data
+// is in flight, so a fast sender is throttled to the emulated bandwidth.
+constexpr size_t MaxQueuedBytes = 4 << 20;
+// How long to wait for the target to listen, e.g. when the remote party of
+// test_sel is started later
+constexpr auto ConnectTimeout = chrono::seconds(30);
+
+void set_nodelay(int fd) {
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+int connect_to(const string& host, uint16_t port) {
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addrs;
+  if (const auto err = getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &addrs)) {
+    throw runtime_error("NetemProxy: cannot resolve "s + host + ": " + gai_strerror(err));
+  }
+  const auto deadline = Clock::now() + ConnectTimeout;
+  int fd = -1;
+  while (fd == -1 && Clock::now() < deadline) {
+    for (auto addr = addrs; addr; addr = addr->ai_next) {
+      fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+      if (fd == -1) continue;
+      if (connect(fd, addr->ai_addr, addr->ai_addrlen) == 0) break;
+      close(fd);
+      fd = -1;
+    }
+    if (fd == -1) this_thread::sleep_for(chrono::milliseconds(100));
+  }
+  freeaddrinfo(addrs);
+  if (fd == -1) {
+    throw runtime_error("NetemProxy: cannot connect to "s + host + ':' + to_string(port));
+  }
+  set_nodelay(fd);
+  return fd;
+}
+} // namespace
+
+NetworkProfile parse_network_profile(const string& spec) {
+  if (spec == "lan") return {0.1, 0, 1000};
+  if (spec == "wan") return {50, 2, 100};
+
+  NetworkProfile profile;
+  stringstream ss{spec};
+  string item;
+  while (getline(ss, item, ',')) {
+    const auto eq = item.find('=');
+    if (eq == string::npos) {
+      throw invalid_argument("Network profile: expected key=value, got " + item);
+    }
+    const auto key = item.substr(0, eq);
+    const auto value = item.substr(eq + 1);
+    if (key == "latency") profile.latency_ms = stod(value);
+    else if (key == "jitter") profile.jitter_ms = stod(value);
+    else if (key == "bandwidth") profile.bandwidth_mbit = stod(value);
+    else if (key == "packet") profile.packet_bytes = stoull(value);
+    else if (key == "seed") profile.seed = stoul(value);
+    else throw invalid_argument("Network profile: unknown key " + key);
+  }
+  if (profile.packet_bytes == 0) {
+    throw invalid_argument("Network profile: packet size must be positive");
+  }
+  return profile;
+}
+
+/**
+ * One direction of a connection. The reader assigns each packet its release
+ * time, the writer sends it when due.
+ */
+class NetemProxy::Link {
+public:
+  Link(int from, int to, const NetworkProfile& profile, uint32_t seed) :
+    from{from}, to{to}, profile{profile}, gen{seed},
+    jitter{-profile.jitter_ms, profile.jitter_ms},
+    reader{&Link::read_loop, this}, writer{&Link::write_loop, this} {}
+
+  ~Link() {
+    reader.join();
+    writer.join();
+  }
+
+private:
+  struct Packet {
+    Clock::time_point release;
+    vector<char> data;
+  };
+
+  const int from, to;
+  const NetworkProfile profile;
+  mt19937 gen;
+  uniform_real_distribution<double> jitter;
+  Clock::time_point link_free{}; // when the emulated wire is idle again
+  Clock::time_point last_release{};
+
+  mutex m;
+  condition_variable cv;
+  deque<Packet> packets;
+  size_t queued_bytes{0};
+  bool closed{false};
+
+  thread reader, writer;
+
+  Clock::duration transmission_time(size_t bytes) const {
+    if (profile.bandwidth_mbit <= 0) return {};
+    return chrono::duration_cast<Clock::duration>(
+        chrono::duration<double, micro>(bytes * 8 / profile.bandwidth_mbit));
+  }
+
+  Clock::time_point release_time(size_t bytes) {
+    link_free = max(link_free, Clock::now()) + transmission_time(bytes);
+    const auto delay_ms = max(0.0, profile.latency_ms
+        + (profile.jitter_ms > 0 ? jitter(gen) : 0.0));
+    const auto release = link_free + chrono::duration_cast<Clock::duration>(
+        chrono::duration<double, milli>(delay_ms));
+    // Jitter must not reorder packets
+    last_release = max(last_release, release);
+    return last_release;
+  }
+
+  void read_loop() {
+    vector<char> buf(max<size_t>(profile.packet_bytes, 1 << 16));
+    while (true) {
+      const auto n = recv(from, buf.data(), buf.size(), 0);
+      if (n <= 0) break;
+      unique_lock<mutex> lock(m);
+      cv.wait(lock, [this] { return queued_bytes < MaxQueuedBytes || closed; });
+      if (closed) break;
+      for (ssize_t off = 0; off < n; off += profile.packet_bytes) {
+        const auto len = min<size_t>(profile.packet_bytes, n - off);
+        packets.push_back({release_time(len), {buf.data() + off, buf.data() + off + len}});
+        queued_bytes += len;
+      }
+      cv.notify_all();
+    }
+    lock_guard<mutex> lock(m);
+    closed = true;
+    cv.notify_all();
+  }
+
+  void write_loop() {
+    unique_lock<mutex> lock(m);
+    while (true) {
+      cv.wait(lock, [this] { return !packets.empty() || closed; });
+      if (packets.empty()) break; // closed and drained
+      auto packet = move(packets.front());
+      packets.pop_front();
+      lock.unlock();
+      this_thread::sleep_until(packet.release);
+      bool sent = true;
+      for (size_t off = 0; sent && off != packet.data.size();) {
+        const auto n = send(to, packet.data.data() + off, packet.data.size() - off, MSG_NOSIGNAL);
+        sent = n > 0;
+        if (sent) off += n;
+      }
+      lock.lock();
+      queued_bytes -= packet.data.size();
+      cv.notify_all();
+      if (!sent) {
+        // Peer is gone, unblock the reader
+        closed = true;
+        shutdown(from, SHUT_RD);
+        return;
+      }
+    }
+    lock.unlock();
+    shutdown(to, SHUT_WR);
+  }
+};
+
+struct NetemProxy::Connection {
+  int local_fd, remote_fd;
+  unique_ptr<Link> outbound, inbound;
+
+  Connection(int local_fd, int remote_fd, const NetworkProfile& profile, uint32_t seed) :
+    local_fd{local_fd}, remote_fd{remote_fd},
+    outbound{make_unique<Link>(local_fd, remote_fd, profile, seed)},
+    inbound{make_unique<Link>(remote_fd, local_fd, profile, seed + 1)} {}
+
+  // Links only terminate on EOF, call shutdown_both() first to force it
+  ~Connection() {
+    outbound.reset();
+    inbound.reset();
+    close(local_fd);
+    close(remote_fd);
+  }
+
+  void shutdown_both() {
+    shutdown(local_fd, SHUT_RDWR);
+    shutdown(remote_fd, SHUT_RDWR);
+  }
+};
+
+NetemProxy::NetemProxy(const NetworkProfile& profile, string target_host,
+    uint16_t target_port) :
+  profile{profile}, target_host{move(target_host)}, target_port{target_port}
+{
+  listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_fd == -1) {
+    throw runtime_error("NetemProxy: cannot create socket: "s + strerror(errno));
+  }
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addrlen = sizeof(addr);
+  if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))
+      || listen(listen_fd, SOMAXCONN)
+      || getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addrlen)) {
+    const string err = strerror(errno);
+    close(listen_fd);
+    throw runtime_error("NetemProxy: cannot listen: " + err);
+  }
+  listen_port = ntohs(addr.sin_port);
+  acceptor = thread{&NetemProxy::accept_loop, this};
+}
+
+NetemProxy::~NetemProxy() {
+  stopping = true;
+  shutdown(listen_fd, SHUT_RDWR);
+  acceptor.join();
+  close(listen_fd);
+  lock_guard<mutex> lock(connections_mutex);
+  for (auto& connection : connections) connection->shutdown_both();
+  connections.clear();
+}
+
+void NetemProxy::accept_loop() {
+  uint32_t seed = profile.seed;
+  while (!stopping) {
+    const int local_fd = accept(listen_fd, nullptr, nullptr);
+    if (local_fd == -1) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    set_nodelay(local_fd);
+    int remote_fd;
+    try {
+      remote_fd = connect_to(target_host, target_port);
+    } catch (const exception&) {
+      close(local_fd);
+      continue;
+    }
+    lock_guard<mutex> lock(connections_mutex);
+    connections.emplace_back(make_unique<Connection>(local_fd, remote_fd, profile, seed));
+    seed += 2;
+  }
+}
+
+} /* END namespace sel::test */
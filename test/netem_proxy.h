@@ -0,0 +1,93 @@
+/**
+ \file    netem_proxy.h
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief In-process TCP proxy emulating latency, jitter and bandwidth
+*/
+
+#ifndef SEL_TEST_NETEM_PROXY_H
+#define SEL_TEST_NETEM_PROXY_H
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sel::test {
+
+/**
+ * Network properties of each direction of an emulated link
+ */
+struct NetworkProfile {
+  double latency_ms{0}; // one-way
+  double jitter_ms{0}; // uniformly distributed in [-jitter, jitter]
+  double bandwidth_mbit{0}; // 0 is unlimited
+  size_t packet_bytes{1460}; // data is paced in packets of this size
+  uint32_t seed{73}; // of the jitter PRNG
+};
+
+/**
+ * Parses a profile name or a comma separated list of key=value pairs with
+ * keys latency, jitter, bandwidth, packet and seed, e.g.
+ * "latency=20,jitter=1,bandwidth=100". Profiles:
+ *   lan - 0.1 ms, 1 Gbit/s
+ *   wan - 50 ms (100 ms round trip, as in change_network_delay.sh), 2 ms
+ *         jitter, 100 Mbit/s
+ */
+NetworkProfile parse_network_profile(const std::string& spec);
+
+/**
+ * Listens on a local port and forwards all connections to the target, delaying
+ * the data of both directions according to the profile. Point the connecting
+ * ABY party to port() instead of the target port.
+ *
+ * Data is forwarded in packets in order. A packet leaves when the emulated
+ * link finished transmitting it at the given bandwidth plus latency and
+ * jitter. Jitter is drawn from a PRNG seeded per connection and direction, so
+ * the delays are reproducible, and never reorders packets.
+ */
+class NetemProxy {
+public:
+  NetemProxy(const NetworkProfile& profile, std::string target_host,
+      uint16_t target_port);
+  ~NetemProxy();
+  NetemProxy(const NetemProxy&) = delete;
+  NetemProxy& operator=(const NetemProxy&) = delete;
+
+  // Local port on 127.0.0.1 the proxy listens on, chosen by the OS
+  uint16_t port() const { return listen_port; }
+
+private:
+  class Link;
+  struct Connection;
+
+  const NetworkProfile profile;
+  const std::string target_host;
+  const uint16_t target_port;
+  int listen_fd{-1};
+  uint16_t listen_port{0};
+  std::atomic<bool> stopping{false};
+  std::mutex connections_mutex;
+  std::vector<std::unique_ptr<Connection>> connections;
+  std::thread acceptor;
+
+  void accept_loop();
+};
+
+} /* END namespace sel::test */
+
+#endif /* end of include guard: SEL_TEST_NETEM_PROXY_H */
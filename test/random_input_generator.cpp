@@ -23,6 +23,52 @@ using namespace std;
 
 namespace sel::test {
 
+EpilinkConfig make_dkfz_cfg(double threshold, double tthreshold) {
+  return {
+    { // begin map<string, ML_Field>
+      { "vorname",
+        FieldSpec("vorname", 0.000235, 0.01, "dice", "bitmask", 500) },
+      { "nachname",
+        FieldSpec("nachname", 0.0000271, 0.008, "dice", "bitmask", 500) },
+      { "geburtsname",
+        FieldSpec("geburtsname", 0.0000271, 0.008, "dice", "bitmask", 500) },
+      { "geburtstag",
+        FieldSpec("geburtstag", 0.0333, 0.005, "binary", "integer", 5) },
+      { "geburtsmonat",
+        FieldSpec("geburtsmonat", 0.0833, 0.002, "binary", "integer", 4) },
+      { "geburtsjahr",
+        FieldSpec("geburtsjahr", 0.0286, 0.004, "binary", "integer", 11) },
+      { "plz",
+        FieldSpec("plz", 0.01, 0.04, "binary", "string", 40) },
+      { "ort",
+        FieldSpec("ort", 0.01, 0.04, "dice", "bitmask", 500) }
+    }, // end map<string, ML_Field>
+    { { "vorname", "nachname", "geburtsname" } }, // exchange groups
+    threshold, tthreshold
+  };
+}
+
+EpilinkConfig make_benchmark_cfg(size_t num_fields, RunMode mode,
+    double threshold, double tthreshold) {
+  if (mode == RunMode::dkfz) {
+    return make_dkfz_cfg(threshold, tthreshold);
+  }
+  map<string, FieldSpec> field_config;
+  for (size_t i = 0; i != num_fields; ++i){
+    string fieldname{"Field"+std::to_string(i)};
+    if (mode == RunMode::integer || mode == RunMode::combined){
+      field_config[fieldname] = FieldSpec(fieldname, 0.01, 0.04, "binary", "integer", 12);
+    }
+    if (mode == RunMode::bitmask || mode == RunMode::combined) {
+      if (mode == RunMode::combined)
+        fieldname += "b";
+      field_config[fieldname] = FieldSpec(fieldname, 0.01, 0.04, "dice", "bitmask", 500);
+    }
+  }
+  EpilinkConfig cfg(field_config,{},threshold, tthreshold);
+  return cfg;
+}
+
 RandomInputGenerator::RandomInputGenerator(const EpilinkConfig& cfg) :
   cfg{cfg} {}
 
@@ -31,6 +31,19 @@ struct EpilinkInput {
   EpilinkServerInput server;
 };
 
+// Configuration of the Mainzelliste fields as used at the DKFZ
+EpilinkConfig make_dkfz_cfg(double threshold, double tthreshold);
+
+enum class RunMode { dkfz = 0, integer = 1, bitmask = 2, combined = 3};
+
+/**
+ * Configuration of num_fields generic integer and/or bitmask fields, as used
+ * by the field benchmarks. Mode combined creates num_fields fields of each type,
+ * mode dkfz ignores num_fields and returns the dkfz configuration.
+ */
+EpilinkConfig make_benchmark_cfg(size_t num_fields, RunMode mode,
+    double threshold, double tthreshold);
+
 class RandomInputGenerator {
 public:
   RandomInputGenerator(const EpilinkConfig& cfg);
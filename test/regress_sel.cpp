@@ -0,0 +1,239 @@
+/**
+ \file    regress_sel.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Performance regression check of fixed scenarios against a baseline
+*/
+
+#include "cxxopts.hpp"
+#include "fmt/format.h"
+#include "nlohmann/json.hpp"
+
+#include "../include/logger.h"
+#include "bench_runner.h"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+using fmt::print;
+using nlohmann::json;
+
+namespace sel::test {
+
+shared_ptr<spdlog::logger> logger;
+
+constexpr double Threshold = 0.9;
+constexpr double TThreshold = 0.7;
+const filesystem::path CircDir = "../data/circ";
+
+/**
+ * Counters that only depend on the circuit, so they must match the baseline
+ * exactly. Any change, also an improvement, needs a baseline update.
+ */
+const vector<string> exact_metrics{"gates", "depth", "setupBytesSent",
+  "setupBytesReceived", "onlineBytesSent", "onlineBytesReceived"};
+
+struct Scenario {
+  string name;
+  EpilinkConfig cfg;
+  size_t dbsize;
+  BooleanSharing sharing = BooleanSharing::YAO;
+  bool use_conversion = false;
+  vector<FieldName> client_empty_fields = {};
+};
+
+EpilinkConfig make_exchange_cfg() {
+  const auto bitmask = make_benchmark_cfg(3, RunMode::bitmask, Threshold, TThreshold);
+  return {bitmask.fields, {{"Field0", "Field1", "Field2"}}, Threshold, TThreshold};
+}
+
+vector<Scenario> make_scenarios() {
+  const auto dkfz = make_dkfz_cfg(Threshold, TThreshold);
+  const auto integer = make_benchmark_cfg(4, RunMode::integer, Threshold, TThreshold);
+  const auto bitmask = make_benchmark_cfg(4, RunMode::bitmask, Threshold, TThreshold);
+  const auto exchange = make_exchange_cfg();
+
+  vector<Scenario> scenarios;
+  for (const size_t dbsize : {10, 100, 1000}) {
+    scenarios.push_back({fmt::format("dkfz-yao-n{}", dbsize), dkfz, dbsize,
+        BooleanSharing::YAO, false, {"ort"}});
+  }
+  scenarios.push_back({"dkfz-gmw-n100", dkfz, 100, BooleanSharing::GMW, false, {"ort"}});
+  scenarios.push_back({"dkfz-yao-conv-n100", dkfz, 100, BooleanSharing::YAO, true, {"ort"}});
+  for (const size_t dbsize : {100, 1000}) {
+    scenarios.push_back({fmt::format("integer4-yao-n{}", dbsize), integer, dbsize});
+    scenarios.push_back({fmt::format("bitmask4-yao-n{}", dbsize), bitmask, dbsize});
+    scenarios.push_back({fmt::format("exchange3-yao-n{}", dbsize), exchange, dbsize});
+  }
+  return scenarios;
+}
+
+json run_scenario(const Scenario& s, uint16_t port, size_t warmups, size_t repetitions) {
+  const CircuitConfig circ_cfg{s.cfg, CircDir, false, s.sharing, s.use_conversion};
+  RandomInputGenerator random_input(s.cfg);
+  random_input.set_client_empty_fields(s.client_empty_fields);
+  const auto in = random_input.generate(s.dbsize);
+
+  PartyPair parties{circ_cfg, port, 2};
+  for (size_t i = 0; i != warmups; ++i) parties.run_linkage(in);
+  vector<BenchRun> runs;
+  for (size_t i = 0; i != repetitions; ++i) {
+    runs.emplace_back(parties.run_linkage(in));
+  }
+
+  auto result = to_json(runs.front());
+  for (const auto& run : runs) {
+    const auto j = to_json(run);
+    for (const auto& metric : exact_metrics) {
+      if (j.at(metric) != result.at(metric)) {
+        logger->warn("{}: {} differs between repetitions: {} vs {}",
+            s.name, metric, j.at(metric).dump(), result.at(metric).dump());
+      }
+    }
+  }
+  result["wallMs"] = median(runs, [](auto& r){ return r.wall_ms; });
+  for (const auto& key : {"clientWallMs", "serverWallMs", "circuitBuildMs",
+      "setupMs", "onlineMs", "peakMemoryBytes"}) {
+    result.erase(key);
+  }
+  return result;
+}
+
+/**
+ * Prints the comparison of one scenario and returns whether it regressed
+ */
+bool compare(const string& name, const json& result, const json& baseline,
+    double wall_tolerance) {
+  bool regressed = false;
+  for (const auto& metric : exact_metrics) {
+    const auto current = result.at(metric).get<uint64_t>();
+    const auto expected = baseline.at(metric).get<uint64_t>();
+    const bool changed = current != expected;
+    regressed |= changed;
+    print("{:<22} {:<20} {:>14} {:>14} {}\n", name, metric, expected, current,
+        changed ? "CHANGED" : "ok");
+  }
+  // Wall times are only comparable on the machine the baseline was recorded on
+  if (wall_tolerance < 0 || !baseline.count("wallMs")) {
+    return regressed;
+  }
+  const auto wall = result.at("wallMs").get<double>();
+  const auto expected_wall = baseline.at("wallMs").get<double>();
+  const bool slower = wall > expected_wall * (1 + wall_tolerance);
+  regressed |= slower;
+  print("{:<22} {:<20} {:>14.1f} {:>14.1f} {}\n", name, "wallMs", expected_wall,
+      wall, slower ? "SLOWER" : "ok");
+  return regressed;
+}
+
+} /* END namespace sel::test */
+
+using namespace sel;
+using namespace sel::test;
+
+int main(int argc, char *argv[])
+{
+  string baseline_filepath{"../test/regression_baseline.json"};
+  string output_filepath;
+  double wall_tolerance = 0.25;
+  size_t warmups = 1;
+  size_t repetitions = 3;
+  uint16_t port = 5676;
+  bool update = false;
+
+  cxxopts::Options options{"regress_sel",
+    "Run fixed linkage scenarios with both parties in one process and compare "
+    "gates, depth and communication exactly and wall times within a tolerance "
+    "against a baseline. Exits with 1 on regression or scenarios missing from "
+    "the baseline."};
+  options.add_options()
+    ("b,baseline", "Baseline file. Default ../test/regression_baseline.json",
+        cxxopts::value(baseline_filepath))
+    ("u,update", "Write the results to the baseline file instead of comparing",
+        cxxopts::value(update))
+    ("o,output", "Additionally write the results to this file",
+        cxxopts::value(output_filepath))
+    ("wall-tolerance", "Allowed relative wall time increase. Default 0.25. "
+        "Negative values disable the wall time check, e.g., on machines other "
+        "than the one the baseline was recorded on. Baselines without wall times "
+        "are only checked for circuit counters.", cxxopts::value(wall_tolerance))
+    ("w,warmups", "Unmeasured runs per scenario. Default 1", cxxopts::value(warmups))
+    ("repetitions", "Measured runs per scenario. Default 3", cxxopts::value(repetitions))
+    ("p,port", "First loopback port, each scenario uses its own. Default 5676",
+        cxxopts::value(port))
+    ("v,verbose", "Set verbosity. May be specified multiple times to log on "
+      "info/debug/trace level. Default level is warning.")
+    ("h,help", "Print help");
+  auto op = options.parse(argc, argv);
+
+  if (op["help"].as<bool>()) {
+    cout << options.help() << endl;
+    return 0;
+  }
+
+  create_terminal_logger();
+  switch(op.count("verbose")){
+    case 0: spdlog::set_level(spdlog::level::warn); break;
+    case 1: spdlog::set_level(spdlog::level::info); break;
+    case 2: spdlog::set_level(spdlog::level::debug); break;
+    default: spdlog::set_level(spdlog::level::trace); break;
+  }
+  logger = get_logger(ComponentLogger::TEST);
+
+  if (repetitions == 0) {
+    cout << "Need at least one repetition" << endl;
+    return 1;
+  }
+
+  json baseline{{"scenarios", json::object()}};
+  if (!update) {
+    ifstream baseline_file{baseline_filepath};
+    if (!baseline_file) {
+      cout << "Cannot read baseline " << baseline_filepath << endl;
+      return 1;
+    }
+    baseline_file >> baseline;
+  }
+  const auto& expected = baseline.at("scenarios");
+
+  json results{{"scenarios", json::object()}};
+  bool regressed = false;
+  print("{:<22} {:<20} {:>14} {:>14}\n", "scenario", "metric", "baseline", "current");
+  for (const auto& scenario : make_scenarios()) {
+    const auto result = run_scenario(scenario, port++, warmups, repetitions);
+    results["scenarios"][scenario.name] = result;
+    if (update) {
+      print("{:<22} recorded\n", scenario.name);
+    } else if (expected.count(scenario.name)) {
+      regressed |= compare(scenario.name, result, expected.at(scenario.name),
+          wall_tolerance);
+    } else {
+      // A scenario without baseline can not be checked, which must not pass
+      regressed = true;
+      print("{:<22} MISSING, run with --update to record it\n", scenario.name);
+    }
+  }
+
+  if (update) {
+    ofstream{baseline_filepath} << results.dump(2) << '\n';
+  }
+  if (!output_filepath.empty()) {
+    ofstream{output_filepath} << results.dump(2) << '\n';
+  }
+
+  if (regressed) {
+    print("Performance regression against {}\n", baseline_filepath);
+  }
+  return regressed ? 1 : 0;
+}
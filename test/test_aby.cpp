@@ -3,12 +3,15 @@
 #include "../include/aby/Share.h"
 #include "../include/aby/gadgets.h"
 #include "../include/aby/quotient_folder.hpp"
+#include "../include/aby/gatecost.h"
 #include "abycore/aby/abyparty.h"
 #include "abycore/sharing/sharing.h"
 #include "cxxopts.hpp"
 #include <numeric>
 #include <algorithm>
 #include <random>
+#include <chrono>
+#include <fstream>
 #include <fmt/format.h>
 using fmt::print;
 
@@ -39,6 +42,7 @@ struct ABYTester {
   const B2AConverter to_arith_closure;
   const A2BConverter to_bool_closure;
   mt19937 gen;
+  sel::aby::GateCostAttribution costs;
 
   ABYTester(e_role role, e_sharing sharing, uint32_t nvals, uint32_t bitlen, uint32_t nthreads, bool _zeropad, uint_fast32_t random_seed) :
     role{role}, bitlen{bitlen}, nvals{nvals}, party{role, "127.0.0.1", 5676, LT, bitlen, nthreads},
@@ -48,7 +52,8 @@ struct ABYTester {
     zeropad{_zeropad},
     to_arith_closure{[this](auto x){return to_arith(x);}},
     to_bool_closure{[this](auto x){return to_bool(x);}},
-    gen(random_seed)
+    gen(random_seed),
+    costs{bc, cc, ac}
   {
     cout << "Testing ABY with role: " << get_role_name(role) <<
      " with sharing: " << get_sharing_name(sharing) << " nvals: " << nvals <<
@@ -360,6 +365,124 @@ struct ABYTester {
   }
 
 
+  /**
+   * Costs of one gadget, gates exclude the input and output gates
+   */
+  struct GadgetCost {
+    sel::aby::GateCounts gates;
+    double build_ms;
+    double setup_ms;
+    double online_ms;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+  };
+
+  static inline const vector<string> gadgets{"split_accumulate",
+    "split_select_target", "max_tie_bool", "max_tie_arith",
+    "quotient_folder_bool", "quotient_folder_arith"};
+
+  /**
+   * Builds the gadget on _nvals random inputs, runs it and resets the party
+   */
+  GadgetCost bench_gadget(const string& gadget, uint32_t _nvals) {
+    nvals = _nvals;
+    const auto start = chrono::steady_clock::now();
+    if (gadget == "split_accumulate") build_split_accumulate();
+    else if (gadget == "split_select_target") build_split_select_target();
+    else if (gadget == "max_tie_bool") build_max_tie<BoolShare>();
+    else if (gadget == "max_tie_arith") build_max_tie<ArithShare>();
+    else if (gadget == "quotient_folder_bool") build_quotient_folder<BoolShare>();
+    else if (gadget == "quotient_folder_arith") build_quotient_folder<ArithShare>();
+    else throw invalid_argument("Unknown gadget " + gadget);
+    const double build_ms = chrono::duration<double, milli>(
+        chrono::steady_clock::now() - start).count();
+
+    party.ExecCircuit();
+
+    GadgetCost cost{costs.get_stage_costs().at("gadget"), build_ms,
+      party.GetTiming(P_SETUP), party.GetTiming(P_ONLINE),
+      party.GetSentData(P_SETUP) + party.GetSentData(P_ONLINE),
+      party.GetReceivedData(P_SETUP) + party.GetReceivedData(P_ONLINE)};
+    party.Reset();
+    costs.reset();
+    return cost;
+  }
+
+  void build_split_accumulate() {
+    const auto data = make_random_vector(bitlen);
+    BoolShare in{bc, data.data(), bitlen, SERVER, nvals};
+    BoolShare res;
+    {
+      sel::aby::GateCostScope scope{&costs, "gadget"};
+      res = split_accumulate(in, op_max);
+    }
+    out(res, ALL);
+  }
+
+  void build_split_select_target() {
+    const auto data = make_random_vector(bitlen);
+    BoolShare selector{bc, data.data(), bitlen, SERVER, nvals};
+    BoolShare target = ascending_numbers_constant(bc, nvals);
+    {
+      sel::aby::GateCostScope scope{&costs, "gadget"};
+      split_select_target(selector, target, op_gt);
+    }
+    out(target, ALL);
+  }
+
+  // Numerators get 2/3 of the bits, denominators 1/3, as in test_quotient_folder
+  pair<size_t, size_t> quotient_bits() const {
+    const size_t num_bits = llround(2*((double)(bitlen)/3));
+    return {num_bits, bitlen - num_bits};
+  }
+
+  template <class MultShare>
+  Quotient<MultShare> make_random_quotient() {
+    const auto [num_bits, den_bits] = quotient_bits();
+    auto data_num = make_random_vector(num_bits);
+    auto data_den = make_random_vector(den_bits);
+    auto circ = circuit<MultShare>();
+    return {{circ, data_num.data(), bitlen, SERVER, nvals},
+      {circ, data_den.data(), bitlen, CLIENT, nvals}};
+  }
+
+  // Elementwise max_tie of two SIMD quotients, the step of every fold
+  template <class MultShare>
+  void build_max_tie() {
+    const auto a = make_random_quotient<MultShare>();
+    const auto b = make_random_quotient<MultShare>();
+    Quotient<MultShare> res;
+    {
+      sel::aby::GateCostScope scope{&costs, "gadget"};
+      if constexpr (std::is_same_v<MultShare, ArithShare>) {
+        res = max_tie({a, b}, to_bool_closure, to_arith_closure, quotient_bits().second);
+      } else {
+        res = max_tie({a, b});
+      }
+    }
+    out(res.num, ALL);
+    out(res.den, ALL);
+  }
+
+  template <class MultShare>
+  void build_quotient_folder() {
+    using QF = QuotientFolder<MultShare>;
+    auto inq = make_random_quotient<MultShare>();
+    vector<BoolShare> targets = {ascending_numbers_constant(bc, nvals)};
+    typename QF::Leaf res;
+    {
+      sel::aby::GateCostScope scope{&costs, "gadget"};
+      QF folder(move(inq), QF::FoldOp::MAX_TIE, move(targets));
+      if constexpr (std::is_same_v<MultShare, ArithShare>) {
+        folder.set_converters_and_den_bits(&to_bool_closure, &to_arith_closure,
+            quotient_bits().second);
+      }
+      res = folder.fold();
+    }
+    out(res.get_selector().num, ALL);
+    out(res.get_targets()[0], ALL);
+  }
+
   void test_add() {
     constexpr uint32_t _bitlen = 8;
     BoolShare a = (role==SERVER) ? BoolShare{bc, _bitlen} : BoolShare{bc, 43u, _bitlen, CLIENT};
@@ -381,6 +504,42 @@ struct ABYTester {
   }
 };
 
+/**
+ * Benchmarks all gadgets for nvals 1, 10, ..., max_nvals on both boolean
+ * sharings and the given bit widths. The arithmetic gadgets convert with the
+ * respective boolean sharing. ABY's arithmetic sharing only supports bit
+ * widths 8, 16, 32 and 64, so they are skipped for other widths.
+ */
+void benchmark_gadgets(e_role role, const vector<uint32_t>& bitlens,
+    uint32_t max_nvals, uint32_t nthreads, bool zeropad,
+    uint_fast32_t random_seed, const string& filepath) {
+  ofstream file{filepath};
+  const auto header = "gadget,sharing,bitlen,nvals,andGates,xorVals,mulGates,"
+    "conversions,gates,depth,buildMs,setupMs,onlineMs,bytesSent,bytesReceived\n";
+  file << header;
+  cout << header;
+  for (const auto sharing : {S_BOOL, S_YAO}) {
+    for (const auto bitlen : bitlens) {
+      ABYTester tester{role, sharing, 1, bitlen, nthreads, zeropad, random_seed};
+      const bool arith_bitlen = bitlen == 8 || bitlen == 16 || bitlen == 32 || bitlen == 64;
+      for (const auto& gadget : ABYTester::gadgets) {
+        if (!arith_bitlen && gadget.find("arith") != string::npos) continue;
+        for (uint64_t nvals = 1; nvals <= max_nvals; nvals *= 10) {
+          const auto c = tester.bench_gadget(gadget, nvals);
+          const auto row = fmt::format("{},{},{},{},{},{},{},{},{},{},{:.3f},{:.3f},{:.3f},{},{}\n",
+              gadget, get_sharing_name(sharing), bitlen, nvals,
+              c.gates.and_gates, c.gates.xor_vals, c.gates.mul_gates,
+              c.gates.b2a_gates + c.gates.a2y_gates + c.gates.b2y_gates,
+              c.gates.gates, c.gates.depth, c.build_ms, c.setup_ms, c.online_ms,
+              c.bytes_sent, c.bytes_received);
+          file << row << flush;
+          cout << row;
+        }
+      }
+    }
+  }
+}
+
 int main(int argc, char *argv[])
 {
   bool role_server = false;
@@ -390,6 +549,9 @@ int main(int argc, char *argv[])
   uint32_t nthreads = 1;
   bool zeropad = false;
   uint_fast32_t random_seed = 73;
+  string benchmark_filepath;
+  vector<uint32_t> bench_bitlens{8, 16, 24, 32};
+  uint32_t bench_max_nvals = 1000000;
 
   cxxopts::Options options{"test_aby", "Test ABY related components"};
   options.add_options()
@@ -399,6 +561,12 @@ int main(int argc, char *argv[])
     ("b,bitlen", "Bitlength", cxxopts::value(bitlen))
     ("z,zeropad", "Enable zeropadding before B2A conversion", cxxopts::value(zeropad))
     ("R,random-seed", "Random generator seed", cxxopts::value(random_seed))
+    ("B,benchmark-file", "Benchmark the gate costs of all gadgets and write "
+        "them as CSV to this file instead of running the test", cxxopts::value(benchmark_filepath))
+    ("bench-bitlens", "Bit widths to benchmark. Default 8,16,24,32",
+        cxxopts::value(bench_bitlens))
+    ("bench-max-nvals", "Benchmark nvals 1, 10, ... up to this. Default 10^6",
+        cxxopts::value(bench_max_nvals))
     ("h,help", "Print help");
   auto op = options.parse(argc, argv);
 
@@ -409,6 +577,12 @@ int main(int argc, char *argv[])
 
   e_role role = role_server ? SERVER : CLIENT;
 
+  if (!benchmark_filepath.empty()) {
+    benchmark_gadgets(role, bench_bitlens, bench_max_nvals, nthreads, zeropad,
+        random_seed, benchmark_filepath);
+    return 0;
+  }
+
   ABYTester tester{role, (e_sharing)sharing, nvals, bitlen, nthreads, zeropad, random_seed};
 
   //tester.test_split_select_target();
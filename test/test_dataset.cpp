@@ -0,0 +1,142 @@
+/**
+ \file    test_dataset.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Tests of the synthetic dataset generator and its snapshots
+*/
+
+#include <algorithm>
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include "../include/logger.h"
+#include "../include/util.h"
+#include "dataset_generator.h"
+
+using namespace std;
+
+namespace sel::test {
+
+const filesystem::path SnapshotPath{
+  filesystem::temp_directory_path() / "test_dataset.sel"};
+
+Dataset small_dataset() {
+  DatasetParams params;
+  params.database_size = 50;
+  params.num_records = 7;
+  params.duplicate_rate = 0.3;
+  return DatasetGenerator{params}.generate();
+}
+
+bool throws_on_read(const filesystem::path& path) {
+  try {
+    read_snapshot(path);
+  } catch (const runtime_error&) {
+    return true;
+  }
+  return false;
+}
+
+void test_bloom_encode() {
+  const auto bm = bloom_encode("Mueller", 500);
+  assert (bm.size() == bitbytes(500));
+  // 8 bigrams of " mueller " with 15 hash functions each
+  assert (hw(bm) > 0 && hw(bm) <= 8 * 15);
+  assert (bloom_encode("Mueller", 500) == bm);
+  assert (bloom_encode("MUELLER", 500) == bm);
+  assert (bloom_encode("Muller", 500) != bm);
+  assert (bloom_encode("", 500) != bm);
+}
+
+void test_generator_is_deterministic() {
+  const auto a = small_dataset();
+  const auto b = small_dataset();
+  assert (*a.input.server.database == *b.input.server.database);
+  assert (*a.input.client.records == *b.input.client.records);
+  assert (a.database_entities == b.database_entities);
+  assert (a.record_entities == b.record_entities);
+}
+
+void test_snapshot_roundtrip() {
+  const auto dataset = small_dataset();
+  write_snapshot(SnapshotPath, dataset);
+  const auto read = read_snapshot(SnapshotPath);
+
+  const auto& cfg = dataset.input.cfg;
+  assert (read.input.cfg.threshold == cfg.threshold);
+  assert (read.input.cfg.tthreshold == cfg.tthreshold);
+  assert (read.input.cfg.exchange_groups == cfg.exchange_groups);
+  assert (read.input.cfg.fields.size() == cfg.fields.size());
+  for (const auto& [name, field] : cfg.fields) {
+    const auto& read_field = read.input.cfg.fields.at(name);
+    assert (read_field.name == field.name);
+    assert (read_field.weight == field.weight);
+    assert (read_field.comparator == field.comparator);
+    assert (read_field.type == field.type);
+    assert (read_field.bitsize == field.bitsize);
+  }
+  assert (read.input.server.database_size == dataset.input.server.database_size);
+  assert (read.input.client.num_records == dataset.input.client.num_records);
+  assert (*read.input.server.database == *dataset.input.server.database);
+  assert (*read.input.client.records == *dataset.input.client.records);
+  assert (read.database_entities == dataset.database_entities);
+  assert (read.record_entities == dataset.record_entities);
+}
+
+void test_corrupt_snapshot() {
+  write_snapshot(SnapshotPath, small_dataset());
+  const auto size = filesystem::file_size(SnapshotPath);
+
+  filesystem::resize_file(SnapshotPath, size - 1);
+  assert (throws_on_read(SnapshotPath));
+
+  // Database size, found by the following number of records, overwritten with
+  // a size that overflows the column size computation
+  write_snapshot(SnapshotPath, small_dataset());
+  {
+    ifstream in{SnapshotPath, ios::binary};
+    vector<char> buf(size);
+    in.read(buf.data(), size);
+    const uint64_t sizes[] = {50, 7};
+    const auto pos = search(buf.cbegin(), buf.cend(),
+        reinterpret_cast<const char*>(sizes),
+        reinterpret_cast<const char*>(sizes) + sizeof(sizes));
+    assert (pos != buf.cend());
+    fstream out{SnapshotPath, ios::binary | ios::in | ios::out};
+    out.seekp(pos - buf.cbegin());
+    const uint64_t huge = numeric_limits<uint64_t>::max() / 2;
+    out.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+  }
+  assert (throws_on_read(SnapshotPath));
+
+  filesystem::remove(SnapshotPath);
+}
+
+} // namespace sel::test
+
+using namespace sel;
+using namespace sel::test;
+
+int main(int argc, char *argv[])
+{
+  create_terminal_logger();
+  spdlog::set_level(spdlog::level::warn);
+
+  test_bloom_encode();
+  test_generator_is_deterministic();
+  test_snapshot_roundtrip();
+  test_corrupt_snapshot();
+  return 0;
+}
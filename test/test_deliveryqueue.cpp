@@ -0,0 +1,139 @@
+/**
+ \file    test_deliveryqueue.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Tests of the delivery queue's journal and pending limit
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include "nlohmann/json.hpp"
+#include "../include/base64.h"
+#include "../include/deliveryqueue.h"
+#include "../include/logger.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace sel {
+
+const filesystem::path JournalPath{
+  filesystem::temp_directory_path() / "test_deliveryqueue.jsonl"};
+
+// Deliveries to it fail right away and are retried much later
+constexpr hours RetryBackoff{1};
+
+// URL of a port nobody listens on, so connections are refused
+string refusing_url() {
+  const int fd{socket(AF_INET, SOCK_STREAM, 0)};
+  assert (fd >= 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  assert (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+  socklen_t len{sizeof(addr)};
+  assert (getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0);
+  close(fd);
+  return "http://127.0.0.1:" + to_string(ntohs(addr.sin_port)) + "/";
+}
+
+Delivery delivery(const string& body, Delivery::Completion on_finished = nullptr) {
+  return {refusing_url(), body, {"Content-Type: application/json"},
+          "", {}, "test delivery", move(on_finished), nullptr};
+}
+
+// Bodies of the deliveries in the journal, as written
+vector<string> journaled_bodies() {
+  ifstream in{JournalPath};
+  vector<string> bodies;
+  string line;
+  while (getline(in, line)) {
+    const auto record = nlohmann::json::parse(line);
+    if (record.count("delivery")) {
+      bodies.emplace_back(record.at("delivery").at("body").get<string>());
+    }
+  }
+  return bodies;
+}
+
+void test_pending_limit() {
+  DeliveryQueue queue{"", 100, RetryBackoff, 2};
+  assert (queue.push(delivery("{}")));
+  assert (queue.push(delivery("{}")));
+  bool rejected{false};
+  assert (!queue.push(delivery("{}", [&rejected](bool delivered){ rejected = !delivered; })));
+  assert (rejected);
+  assert (queue.size() == 2);
+}
+
+void test_journal_replay() {
+  filesystem::remove(JournalPath);
+  {
+    DeliveryQueue queue{JournalPath, 100, RetryBackoff, 0};
+    assert (queue.push(delivery(R"({"result": 1})")));
+    assert (queue.push(delivery(R"({"result": 2})")));
+  }
+  {
+    DeliveryQueue queue{JournalPath, 100, RetryBackoff, 0};
+    assert (queue.size() == 2);
+  }
+  // The pending limit does not apply to resumed deliveries
+  DeliveryQueue queue{JournalPath, 100, RetryBackoff, 1};
+  assert (queue.size() == 2);
+  assert (!queue.push(delivery("{}")));
+}
+
+void test_binary_body_replay() {
+  filesystem::remove(JournalPath);
+  const auto cbor{nlohmann::json::to_cbor({{"result", {{"matches", 1}}},
+      {"bits", nlohmann::json::binary({0xff, 0x00, 0xfe, 0x80})}})};
+  const string body(cbor.begin(), cbor.end());
+  {
+    DeliveryQueue queue{JournalPath, 100, RetryBackoff, 0};
+    assert (queue.push(delivery(body)));
+  }
+  {
+    // Pushing makes the resumed queue rewrite the journal from what it read
+    DeliveryQueue queue{JournalPath, 100, RetryBackoff, 0};
+    assert (queue.size() == 1);
+    assert (queue.push(delivery("{}")));
+  }
+  const auto bodies{journaled_bodies()};
+  assert (bodies.size() == 2);
+  assert (bodies.front() == base64_encode(cbor.data(), cbor.size()));
+}
+
+} // namespace sel
+
+using namespace sel;
+
+int main(int argc, char *argv[])
+{
+  create_terminal_logger();
+  spdlog::set_level(spdlog::level::err);
+
+  test_pending_limit();
+  test_journal_replay();
+  test_binary_body_replay();
+  filesystem::remove(JournalPath);
+  return 0;
+}
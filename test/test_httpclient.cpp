@@ -0,0 +1,117 @@
+/**
+ \file    test_httpclient.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Tests of the outbound HTTP client against a silent listener
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cassert>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include "../include/httpclient.h"
+#include "../include/logger.h"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace sel {
+
+/**
+ * Listening socket that never accepts. Connections complete in the kernel's
+ * backlog, but requests are never answered.
+ */
+class SilentListener {
+public:
+  SilentListener() : m_fd{socket(AF_INET, SOCK_STREAM, 0)} {
+    assert (m_fd >= 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    assert (bind(m_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    assert (listen(m_fd, 16) == 0);
+    socklen_t len{sizeof(addr)};
+    assert (getsockname(m_fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0);
+    m_url = "http://127.0.0.1:" + to_string(ntohs(addr.sin_port)) + "/";
+  }
+  ~SilentListener() { close(m_fd); }
+
+  const string& url() const { return m_url; }
+
+private:
+  int m_fd;
+  string m_url;
+};
+
+// Runs a request and returns how long it took to fail
+milliseconds time_failed_request(const string& url) {
+  const auto start{steady_clock::now()};
+  try {
+    HttpClient::get().request(HttpMethod::GET, url, "", {});
+  } catch (const runtime_error&) {
+    return duration_cast<milliseconds>(steady_clock::now() - start);
+  }
+  assert (false && "request to silent listener succeeded");
+  return {};
+}
+
+void test_total_timeout(const SilentListener& listener) {
+  HttpClient::get().set_timeouts({milliseconds{1000}, milliseconds{300}, seconds{0}});
+  const auto elapsed{time_failed_request(listener.url())};
+  assert (elapsed >= milliseconds{300} && elapsed < seconds{5});
+}
+
+void test_low_speed_timeout(const SilentListener& listener) {
+  HttpClient::get().set_timeouts({milliseconds{1000}, milliseconds{0}, seconds{1}});
+  const auto elapsed{time_failed_request(listener.url())};
+  assert (elapsed >= seconds{1} && elapsed < seconds{10});
+}
+
+void test_request_on_loop_thread(const SilentListener& listener) {
+  auto& client{HttpClient::get()};
+  client.set_timeouts({milliseconds{1000}, milliseconds{100}, seconds{0}});
+  promise<bool> rejected;
+  auto result{rejected.get_future()};
+  client.async_request(HttpMethod::GET, listener.url(), "", {},
+      [&](SessionResponse, exception_ptr) {
+        try {
+          client.request(HttpMethod::GET, listener.url(), "", {});
+          rejected.set_value(false);
+        } catch (const logic_error&) {
+          rejected.set_value(true);
+        }
+      });
+  assert (result.wait_for(seconds{10}) == future_status::ready);
+  assert (result.get());
+}
+
+} // namespace sel
+
+using namespace sel;
+
+int main(int argc, char *argv[])
+{
+  create_terminal_logger();
+  spdlog::set_level(spdlog::level::err);
+
+  const SilentListener listener;
+  test_total_timeout(listener);
+  test_low_speed_timeout(listener);
+  test_request_on_loop_thread(listener);
+  return 0;
+}
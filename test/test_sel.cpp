@@ -7,9 +7,13 @@
 #include "../include/jsonutils.h"
 #include "../include/secure_epilinker.h"
 #include "../include/clear_epilinker.h"
+#include "../include/memory_model.h"
 #include "random_input_generator.h"
+#include "netem_proxy.h"
 
+#include <array>
 #include <filesystem>
+#include <fstream>
 
 using namespace std;
 using fmt::print, fmt::format;
@@ -65,50 +69,6 @@ map<string, FieldData> make_test_data() {
   return ret;
 }
 
-EpilinkConfig make_dkfz_cfg() {
-  return {
-    { // begin map<string, ML_Field>
-      { "vorname",
-        FieldSpec("vorname", 0.000235, 0.01, "dice", "bitmask", 500) },
-      { "nachname",
-        FieldSpec("nachname", 0.0000271, 0.008, "dice", "bitmask", 500) },
-      { "geburtsname",
-        FieldSpec("geburtsname", 0.0000271, 0.008, "dice", "bitmask", 500) },
-      { "geburtstag",
-        FieldSpec("geburtstag", 0.0333, 0.005, "binary", "integer", 5) },
-      { "geburtsmonat",
-        FieldSpec("geburtsmonat", 0.0833, 0.002, "binary", "integer", 4) },
-      { "geburtsjahr",
-        FieldSpec("geburtsjahr", 0.0286, 0.004, "binary", "integer", 11) },
-      { "plz",
-        FieldSpec("plz", 0.01, 0.04, "binary", "string", 40) },
-      { "ort",
-        FieldSpec("ort", 0.01, 0.04, "dice", "bitmask", 500) }
-    }, // end map<string, ML_Field>
-    { { "vorname", "nachname", "geburtsname" } }, // exchange groups
-    Threshold, TThreshold
-  };
-}
-
-enum class RunMode { dkfz = 0, integer = 1, bitmask = 2, combined = 3};
-
-EpilinkConfig make_benchmark_cfg(size_t num_fields, RunMode mode) {
-  map<string, FieldSpec> field_config;
-  for (size_t i = 0; i != num_fields; ++i){
-    string fieldname{"Field"+std::to_string(i)};
-    if (mode == RunMode::integer || mode == RunMode::combined){
-      field_config[fieldname] = FieldSpec(fieldname, 0.01, 0.04, "binary", "integer", 12);
-    }
-    if (mode == RunMode::bitmask || mode == RunMode::combined) {
-      if (mode == RunMode::combined)
-        fieldname += "b";
-      field_config[fieldname] = FieldSpec(fieldname, 0.01, 0.04, "dice", "bitmask", 500);
-    }
-  }
-  EpilinkConfig cfg(field_config,{},Threshold, TThreshold);
-  return cfg;
-}
-
 auto set_inputs(SecureEpilinker& linker,
     const EpilinkClientInput& in_client, const EpilinkServerInput& in_server) {
   logger->info("Calling set_{}_input()\n", run_both ? "both" : ((role==MPCRole::CLIENT) ? "client" : "server"));
@@ -261,13 +221,14 @@ EpilinkInput input_empty() {
 }
 
 EpilinkInput input_dkfz_random(size_t dbsize, size_t nrecords=1) {
-  RandomInputGenerator random_input(make_dkfz_cfg());
+  RandomInputGenerator random_input(make_dkfz_cfg(Threshold, TThreshold));
   random_input.set_client_empty_fields({"ort"});
   random_input.set_bitmask_density_shift(bitmask_density_shift);
   return random_input.generate(dbsize, nrecords);
 }
 EpilinkInput input_benchmark_random(size_t dbsize, size_t nrecords, size_t num_fields, RunMode mode) {
-  RandomInputGenerator random_input(make_benchmark_cfg(num_fields, mode));
+  RandomInputGenerator random_input(
+      make_benchmark_cfg(num_fields, mode, Threshold, TThreshold));
   random_input.set_bitmask_density_shift(bitmask_density_shift);
   return random_input.generate(dbsize, nrecords);
 }
@@ -522,6 +483,96 @@ void run_and_print_score_table(const EpilinkInput& in) {
   }
 }
 
+/**
+ * Peak resident memory since the last reset_peak_memory(), in bytes
+ */
+size_t peak_memory() {
+  ifstream status{"/proc/self/status"};
+  string line;
+  while (getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return stoull(line.substr(6)) << 10; // reported in kB
+    }
+  }
+  throw runtime_error("Can not read peak memory from /proc/self/status");
+}
+
+void reset_peak_memory() {
+  ofstream{"/proc/self/clear_refs"} << "5";
+}
+
+/**
+ * Solves the normal equations of the least squares problem x*a = y by
+ * Gaussian elimination
+ */
+template <size_t N>
+array<double, N> least_squares(const vector<array<double, N>>& xs, const vector<double>& ys) {
+  array<array<double, N+1>, N> m{};
+  for (size_t k = 0; k != xs.size(); ++k) {
+    for (size_t i = 0; i != N; ++i) {
+      for (size_t j = 0; j != N; ++j) m[i][j] += xs[k][i] * xs[k][j];
+      m[i][N] += xs[k][i] * ys[k];
+    }
+  }
+  for (size_t c = 0; c != N; ++c) {
+    size_t pivot = c;
+    for (size_t r = c+1; r != N; ++r) {
+      if (abs(m[r][c]) > abs(m[pivot][c])) pivot = r;
+    }
+    swap(m[c], m[pivot]);
+    if (m[c][c] == 0) continue; // class not covered by the samples
+    for (size_t r = 0; r != N; ++r) {
+      if (r == c) continue;
+      const double f = m[r][c] / m[c][c];
+      for (size_t j = c; j != N+1; ++j) m[r][j] -= f * m[c][j];
+    }
+  }
+  array<double, N> a{};
+  for (size_t i = 0; i != N; ++i) a[i] = m[i][i] ? m[i][N] / m[i][i] : 0;
+  return a;
+}
+
+/**
+ * Runs linkages of different shapes, field types and conversion settings and
+ * fits the bytes of peak memory per gate class of the MemoryModel. Both
+ * parties have to run the calibration. Prints the memoryModel entry for
+ * serverconf.json.
+ */
+void calibrate_memory(const SecureEpilinker::ABYConfig& aby_cfg, size_t num_fields) {
+  const vector<pair<size_t, size_t>> shapes{{1, 100}, {1, 1000}, {4, 500}, {8, 1000}, {16, 1000}};
+  vector<array<double, 4>> gates;
+  vector<double> bytes;
+  for (const uint8_t mode : {1, 2, 3}) {
+    for (const bool conversion : {false, true}) {
+      use_conversion = conversion;
+      for (const auto& [nrecords, dbsize] : shapes) {
+        const auto in = generate_modal_epilink_input(dbsize, nrecords, num_fields, mode);
+        const auto circ_cfg = make_circuit_config<CircUnit>(in.cfg);
+        const auto counts = count_comparison_gates(circ_cfg);
+        const double comparisons = nrecords * dbsize;
+        reset_peak_memory();
+        const auto baseline = peak_memory();
+        {
+          SecureEpilinker linker{aby_cfg, circ_cfg};
+          linker.connect();
+          run_sel_linkage(linker, in);
+          gates.push_back({1, counts.boolean * comparisons,
+              counts.arithmetic * comparisons, counts.conversion * comparisons});
+          bytes.emplace_back(peak_memory() - baseline);
+          linker.reset();
+        }
+        logger->info("mode={} conversion={} nrecords={} dbsize={}: {} MiB",
+            mode, conversion, nrecords, dbsize, bytes.back() / (1 << 20));
+      }
+    }
+  }
+  const auto coeffs = least_squares(gates, bytes);
+  print("\"memoryModel\": {{\"baseMB\": {}, \"booleanGateBytes\": {:.1f}, "
+      "\"arithmeticGateBytes\": {:.1f}, \"conversionBitBytes\": {:.1f}}}\n",
+      static_cast<size_t>(max(coeffs[0], 0.0)) >> 20, max(coeffs[1], 0.0),
+      max(coeffs[2], 0.0), max(coeffs[3], 0.0));
+}
+
 template <typename T>
 void print_toml(ostream& out, string field, T value) {
   print(out, "{} = {}\n", field, value);
@@ -543,6 +594,8 @@ int main(int argc, char *argv[])
   bool match_counting = false;
   uint8_t mode = 0;
   size_t num_fields = 1;
+  bool calibrate = false;
+  string netem_spec;
 #ifdef SEL_STATS
   string benchmark_filepath;
 #endif
@@ -566,6 +619,11 @@ int main(int argc, char *argv[])
     ("bm-density-shift", "Bitmask density shift during generation of random "
         "inputs: 0: equal number of 1s and 0s; >0: more 1s; <0: more 0s.",
         cxxopts::value(bitmask_density_shift))
+    ("netem", "Client only: connect to the server through an emulated network: "
+        "lan, wan or latency=ms,jitter=ms,bandwidth=Mbit/s,packet=bytes,seed=n",
+        cxxopts::value(netem_spec))
+    ("calibrate-memory", "Fit the memory model on runs of various sizes and print "
+        "it for serverconf.json. Uses --num-fields.", cxxopts::value(calibrate))
 #ifdef SEL_STATS
     ("B,benchmark-file", "Print benchmarking output to file.", cxxopts::value(benchmark_filepath))
 #endif
@@ -605,6 +663,19 @@ int main(int argc, char *argv[])
     role, server_host, 5676, nthreads
   };
 
+  unique_ptr<NetemProxy> proxy;
+  if (!netem_spec.empty() && role == MPCRole::CLIENT) {
+    proxy = make_unique<NetemProxy>(parse_network_profile(netem_spec),
+        server_host, aby_cfg.port);
+    aby_cfg.host = "127.0.0.1";
+    aby_cfg.port = proxy->port();
+  }
+
+  if (calibrate) {
+    calibrate_memory(aby_cfg, num_fields);
+    return 0;
+  }
+
   const auto circ_cfg = make_circuit_config<CircUnit>(in.cfg);
   SecureEpilinker linker{aby_cfg, circ_cfg};
   if(!only_local) linker.connect();
@@ -629,6 +700,7 @@ int main(int argc, char *argv[])
     auto stats = linker.get_stats_printer();
     stats.set_output(&bfile);
     stats.print_all();
+    stats.print_gate_costs(linker.get_gate_costs());
   }
 #endif
 
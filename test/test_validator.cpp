@@ -0,0 +1,82 @@
+/**
+ \file    test_validator.cpp
+ \copyright SEL - Secure EpiLinker
+      Copyright (C) 2018 Computational Biology & Simulation Group TU-Darmstadt
+      This program is free software: you can redistribute it and/or modify
+      it under the terms of the GNU Affero General Public License as published
+      by the Free Software Foundation, either version 3 of the License, or
+      (at your option) any later version.
+      This program is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+      GNU Affero General Public License for more details.
+      You should have received a copy of the GNU Affero General Public License
+      along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief Tests of the request schemas and the batch validator
+*/
+
+#include <cassert>
+#include <fstream>
+#include "nlohmann/json.hpp"
+#include "valijson/validation_results.hpp"
+#include "../include/validator.h"
+
+using namespace std;
+using nlohmann::json;
+
+namespace sel {
+
+const string SchemaDir = "../data/";
+
+json read_schema(const string& name) {
+  ifstream in{SchemaDir + name};
+  assert (in);
+  json schema;
+  in >> schema;
+  return schema;
+}
+
+json batch(json records) {
+  return {{"callback", {{"url", "https://localhost:8080/callback"}}},
+          {"records", move(records)}};
+}
+
+void test_linkrecords_with_ids() {
+  const BatchValidator validator{read_schema("linkrecords-schema.json")};
+  // Records as sent by the test scripts and database pages
+  const json records{
+    {{"fields", {{"vorname", "TG9yZW0="}, {"geburtsjahr", 1963}}}, {"id", "ID1"}},
+    {{"fields", {{"vorname", nullptr}}}, {"id", 2}},
+    {{"fields", json::object()}}};
+  assert (validator.validate_json(batch(records)).first);
+}
+
+void test_linkrecords_invalid_records() {
+  const BatchValidator validator{read_schema("linkrecords-schema.json")};
+  assert (!validator.validate_json(batch({{{"id", "ID1"}}})).first);
+  assert (!validator.validate_json(batch({{{"fields", json::object()}, {"unknown", 1}}})).first);
+  assert (!validator.validate_json(batch({{{"fields", json::object()}, {"id", true}}})).first);
+  // The envelope is still checked
+  auto no_callback = batch(json::array());
+  no_callback.erase("callback");
+  assert (!validator.validate_json(no_callback).first);
+}
+
+void test_linkrecord() {
+  const Validator validator{read_schema("linkrecord-schema.json")};
+  const json record{{"callback", {{"url", "https://localhost:8080/callback"}}},
+                    {"fields", {{"vorname", "TG9yZW0="}}}};
+  assert (validator.validate_json(record).first);
+}
+
+} // namespace sel
+
+using namespace sel;
+
+int main(int argc, char *argv[])
+{
+  test_linkrecords_with_ids();
+  test_linkrecords_invalid_records();
+  test_linkrecord();
+  return 0;
+}